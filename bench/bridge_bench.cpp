@@ -0,0 +1,774 @@
+// bridge_bench.cpp : Benchmarks of the exported v8_* functions without Go.
+//
+// The bridge is linked directly and the Go handlers are replaced by stubs, so
+// the numbers are the cost of the bridge and V8 alone. Comparing them with
+// the Go benchmarks of the same operations shows the share of cgo. The output
+// and flags follow Google Benchmark:
+//
+//   ./bridge_bench --benchmark_filter=Value_Call --benchmark_min_time=1
+//
+// Build with "make" in this directory, see the Makefile.
+
+#include "v8_c_bridge.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace {
+
+// --- Harness ---------------------------------------------------------------
+
+double CpuSeconds() {
+	timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double WallSeconds() {
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class State {
+public:
+	State(int64_t max_iterations, int64_t arg)
+		: max_iterations_(max_iterations), arg_(arg) {}
+
+	bool KeepRunning() {
+		if (iterations_ == 0) {
+			ResumeTiming();
+		}
+		if (iterations_ < max_iterations_) {
+			iterations_++;
+			return true;
+		}
+		PauseTiming();
+		return false;
+	}
+
+	void PauseTiming() {
+		wall_ += WallSeconds() - wall_start_;
+		cpu_ += CpuSeconds() - cpu_start_;
+	}
+
+	void ResumeTiming() {
+		wall_start_ = WallSeconds();
+		cpu_start_ = CpuSeconds();
+	}
+
+	int64_t range(int = 0) const { return arg_; }
+	int64_t iterations() const { return iterations_; }
+	void SetBytesProcessed(int64_t bytes) { bytes_ = bytes; }
+	void SkipWithError(const char* msg) {
+		error_ = msg;
+		max_iterations_ = iterations_;
+	}
+
+	double wall() const { return wall_; }
+	double cpu() const { return cpu_; }
+	int64_t bytes() const { return bytes_; }
+	const std::string& error() const { return error_; }
+
+private:
+	int64_t max_iterations_;
+	int64_t arg_;
+	int64_t iterations_ = 0;
+	int64_t bytes_ = 0;
+	double wall_ = 0, cpu_ = 0, wall_start_ = 0, cpu_start_ = 0;
+	std::string error_;
+};
+
+typedef void (*BenchmarkFunc)(State&);
+
+class Benchmark {
+public:
+	Benchmark(const char* name, BenchmarkFunc fn) : name_(name), fn_(fn) {}
+
+	Benchmark* Arg(int64_t arg) {
+		args_.push_back(arg);
+		return this;
+	}
+
+	// Returns one name per run, with the argument appended like Google
+	// Benchmark does.
+	std::vector<std::pair<std::string, int64_t>> Runs() const {
+		std::vector<std::pair<std::string, int64_t>> runs;
+		if (args_.empty()) {
+			runs.emplace_back(name_, 0);
+		}
+		for (int64_t arg : args_) {
+			runs.emplace_back(name_ + "/" + std::to_string(arg), arg);
+		}
+		return runs;
+	}
+
+	BenchmarkFunc fn() const { return fn_; }
+
+private:
+	std::string name_;
+	BenchmarkFunc fn_;
+	std::vector<int64_t> args_;
+};
+
+std::vector<Benchmark*>& Benchmarks() {
+	static std::vector<Benchmark*> benchmarks;
+	return benchmarks;
+}
+
+Benchmark* Register(const char* name, BenchmarkFunc fn) {
+	Benchmark* b = new Benchmark(name, fn);
+	Benchmarks().push_back(b);
+	return b;
+}
+
+#define BENCHMARK(fn) static Benchmark* bm_##fn = Register(#fn, fn)
+
+// Runs fn with a growing number of iterations until it takes min_time, like
+// Google Benchmark.
+State RunBenchmark(BenchmarkFunc fn, int64_t arg, double min_time) {
+	int64_t iterations = 1;
+	for (;;) {
+		State state(iterations, arg);
+		fn(state);
+		if (!state.error().empty() || state.wall() >= min_time || iterations >= 1000000000) {
+			return state;
+		}
+		double multiplier = state.wall() > 0 ? min_time * 1.4 / state.wall() : 10;
+		multiplier = std::min(std::max(multiplier, 2.0), 10.0);
+		iterations = int64_t(iterations * multiplier);
+	}
+}
+
+std::string FormatBytesPerSecond(double bytes) {
+	const char* units[] = { "", "k", "M", "G", "T" };
+	int unit = 0;
+	while (bytes >= 1024 && unit < 4) {
+		bytes /= 1024;
+		unit++;
+	}
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.4g%sB/s", bytes, units[unit]);
+	return buf;
+}
+
+// --- Fixtures --------------------------------------------------------------
+
+IsolatePtr iso;
+ContextPtr ctx;
+
+ValueTuple StubCallbackHandler(String id, CallerInfo info, int argc, ValueTuple* argv) {
+	// The Go handler wraps the arguments in values that are released by
+	// their finalizers.
+	for (int i = 0; i < argc; i++) {
+		v8_Value_Release(ctx, argv[i].Value);
+	}
+	return ValueTuple{};
+}
+
+ResolvedModule StubResolveModuleHandler(int go_context_id, String specifier, String referrer) {
+	ResolvedModule res = {};
+	const char* msg = "Imports are not supported by the benchmarks";
+	res.error_msg = String{ strdup(msg), int(strlen(msg)) };
+	return res;
+}
+
+ValueTuple StubAccessorHandler(int go_context_id, int handle, int field, ValueTuple* value) {
+	return ValueTuple{};
+}
+
+ValueTuple StubInterceptorHandler(int go_context_id, int handle, InterceptOp op, String name,
+	uint32_t index, ValueTuple* value, int* intercepted) {
+	*intercepted = 0;
+	return ValueTuple{};
+}
+
+void StubReleaseHandle(int handle) {}
+
+void Fail(const char* what, Error err) {
+	fprintf(stderr, "%s: %.*s\n", what, err.len, err.ptr);
+	exit(1);
+}
+
+PersistentValuePtr Check(const char* what, ValueTuple res) {
+	if (res.exception != nullptr) {
+		Fail(what, res.exception->Text);
+	}
+	if (res.error_msg.ptr != nullptr) {
+		Fail(what, res.error_msg);
+	}
+	return res.Value;
+}
+
+PersistentValuePtr Run(const char* code) {
+	return Check(code, v8_Context_Run(ctx, code, "bench.js"));
+}
+
+void Release(ValueTuple res) {
+	v8_Value_Release(ctx, res.Value);
+	if (res.error_msg.ptr != nullptr) {
+		v8_Free((void*)res.error_msg.ptr);
+	}
+	if (res.exception != nullptr) {
+		v8_Value_Release(ctx, res.exception->Value);
+		v8_Exception_Release(res.exception);
+	}
+}
+
+PersistentValuePtr CreateNumber(double n) {
+	ImmediateValue val = {};
+	val.Type = tFLOAT64;
+	val.Float64 = n;
+	return v8_Context_Create(ctx, val);
+}
+
+std::vector<PersistentValuePtr> CreateArgs(int64_t count) {
+	std::vector<PersistentValuePtr> args;
+	for (int64_t i = 0; i < count; i++) {
+		args.push_back(CreateNumber(double(i)));
+	}
+	return args;
+}
+
+void ReleaseAll(const std::vector<PersistentValuePtr>& values) {
+	for (PersistentValuePtr v : values) {
+		v8_Value_Release(ctx, v);
+	}
+}
+
+// --- Isolates and contexts -------------------------------------------------
+
+void BM_Isolate_New(State& state) {
+	while (state.KeepRunning()) {
+		IsolatePtr i = v8_Isolate_New(nullptr);
+		v8_Isolate_Release(i);
+	}
+}
+BENCHMARK(BM_Isolate_New);
+
+void BM_Isolate_NewSnapshot(State& state) {
+	StartupData data = v8_CreateSnapshotDataBlob(
+		"var config = { retries: 3 }; function lookup(k) { return config[k] }", 1, nullptr);
+	while (state.KeepRunning()) {
+		IsolatePtr i = v8_Isolate_New(&data);
+		v8_Isolate_Release(i);
+	}
+	v8_Free((void*)data.ptr);
+}
+BENCHMARK(BM_Isolate_NewSnapshot);
+
+void BM_Isolate_NewContext(State& state) {
+	while (state.KeepRunning()) {
+		v8_Context_Release(v8_Isolate_NewContext(iso, 1));
+	}
+}
+BENCHMARK(BM_Isolate_NewContext);
+
+void BM_Context_Recycle(State& state) {
+	ContextPtr c = v8_Isolate_NewContext(iso, 1);
+	while (state.KeepRunning()) {
+		v8_Context_Recycle(c);
+	}
+	v8_Context_Release(c);
+}
+BENCHMARK(BM_Context_Recycle);
+
+void BM_Isolate_GetHeapStatistics(State& state) {
+	while (state.KeepRunning()) {
+		v8_Isolate_GetHeapStatistics(iso);
+	}
+}
+BENCHMARK(BM_Isolate_GetHeapStatistics);
+
+void BM_Isolate_PumpMessageLoop(State& state) {
+	while (state.KeepRunning()) {
+		v8_Isolate_PumpMessageLoop(iso, 0);
+	}
+}
+BENCHMARK(BM_Isolate_PumpMessageLoop);
+
+// --- Scripts ---------------------------------------------------------------
+
+void BM_Context_Run(State& state) {
+	while (state.KeepRunning()) {
+		Release(v8_Context_Run(ctx, "1 + 1", "bench.js"));
+	}
+}
+BENCHMARK(BM_Context_Run);
+
+// Exceptions are captured with their stack trace, but not formatted.
+void BM_Context_RunThrow(State& state) {
+	while (state.KeepRunning()) {
+		Release(v8_Context_Run(ctx, "(function f() { throw new Error('nope') })()", "bench.js"));
+	}
+}
+BENCHMARK(BM_Context_RunThrow);
+
+void BM_Context_EvalModule(State& state) {
+	while (state.KeepRunning()) {
+		ContextPtr c = v8_Isolate_NewContext(iso, 1);
+		ValueTuple res = v8_Context_EvalModule(c, "bench.mjs", "export const answer = 42;");
+		v8_Value_Release(c, res.Value);
+		v8_Context_Release(c);
+	}
+}
+BENCHMARK(BM_Context_EvalModule);
+
+void BM_ScriptStream(State& state) {
+	std::string code;
+	for (int i = 0; i < 100; i++) {
+		code += "function f" + std::to_string(i) + "(x) { return x * " + std::to_string(i) + " }\n";
+	}
+	while (state.KeepRunning()) {
+		ScriptStreamPtr stream = v8_Context_StartStreaming(ctx);
+		v8_ScriptStream_Push(stream, code.data(), int(code.size()));
+		v8_ScriptStream_Close(stream);
+		v8_ScriptStream_Run(stream);
+		ScriptTuple script = v8_ScriptStream_Compile(ctx, stream, "bench-stream.js");
+		if (script.error_msg.ptr != nullptr) {
+			Fail("v8_ScriptStream_Compile", script.error_msg);
+		}
+		Release(v8_Script_Run(ctx, script.Script));
+		v8_Script_Release(iso, script.Script);
+	}
+	state.SetBytesProcessed(state.iterations() * int64_t(code.size()));
+}
+BENCHMARK(BM_ScriptStream);
+
+// --- Creating values -------------------------------------------------------
+
+void BM_Context_CreateNumber(State& state) {
+	while (state.KeepRunning()) {
+		v8_Value_Release(ctx, CreateNumber(1.5));
+	}
+}
+BENCHMARK(BM_Context_CreateNumber);
+
+void BM_Context_CreateString(State& state) {
+	std::string s(size_t(state.range(0)), 'x');
+	ImmediateValue val = {};
+	val.Type = tSTRING;
+	val.Mem = ByteArray{ s.data(), int(s.size()) };
+	while (state.KeepRunning()) {
+		v8_Value_Release(ctx, v8_Context_Create(ctx, val));
+	}
+	state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Context_CreateString)->Arg(16)->Arg(4 << 10)->Arg(1 << 20);
+
+void BM_Context_CreateExternalString(State& state) {
+	std::string s(size_t(state.range(0)), 'x');
+	ExternalStringPtr text = v8_ExternalString_New(s.data(), int(s.size()));
+	while (state.KeepRunning()) {
+		Release(v8_Context_CreateExternalString(ctx, text));
+	}
+	v8_ExternalString_Release(text);
+	state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Context_CreateExternalString)->Arg(16)->Arg(4 << 10)->Arg(1 << 20);
+
+void BM_Context_CreateArrayBuffer(State& state) {
+	std::vector<char> buf(size_t(state.range(0)), 7);
+	ImmediateValue val = {};
+	val.Type = tARRAYBUFFER;
+	val.Mem = ByteArray{ buf.data(), int(buf.size()) };
+	while (state.KeepRunning()) {
+		v8_Value_Release(ctx, v8_Context_Create(ctx, val));
+	}
+	state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Context_CreateArrayBuffer)->Arg(1 << 10)->Arg(64 << 10)->Arg(1 << 20);
+
+void BM_Context_CreateTypedArray(State& state) {
+	std::vector<double> data(size_t(state.range(0)), 1.5);
+	size_t bytes = data.size() * sizeof(double);
+	while (state.KeepRunning()) {
+		v8_Value_Release(ctx, v8_Context_CreateTypedArray(ctx, kFloat64Array,
+			reinterpret_cast<const char*>(data.data()), bytes));
+	}
+	state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_Context_CreateTypedArray)->Arg(1 << 10)->Arg(128 << 10);
+
+// An object with 10 properties, the way Create builds one from a Go struct.
+void BM_Context_CreateObject(State& state) {
+	ImmediateValue obj = {};
+	obj.Type = tOBJECT;
+	PersistentValuePtr field = CreateNumber(1);
+	while (state.KeepRunning()) {
+		PersistentValuePtr o = v8_Context_Create(ctx, obj);
+		for (int i = 0; i < 10; i++) {
+			char name[] = { 'f', char('0' + i), 0 };
+			Error err = v8_Value_Set(ctx, o, name, field);
+			if (err.ptr != nullptr) {
+				Fail("v8_Value_Set", err);
+			}
+		}
+		v8_Value_Release(ctx, o);
+	}
+	v8_Value_Release(ctx, field);
+}
+BENCHMARK(BM_Context_CreateObject);
+
+void BM_Context_Global(State& state) {
+	while (state.KeepRunning()) {
+		v8_Value_Release(ctx, v8_Context_Global(ctx));
+	}
+}
+BENCHMARK(BM_Context_Global);
+
+// --- Reading and writing values --------------------------------------------
+
+void BM_Value_Get(State& state) {
+	PersistentValuePtr obj = Run("({ name: 'bench', nested: { x: 1 } })");
+	while (state.KeepRunning()) {
+		Release(v8_Value_Get(ctx, obj, "name"));
+	}
+	v8_Value_Release(ctx, obj);
+}
+BENCHMARK(BM_Value_Get);
+
+void BM_Value_Set(State& state) {
+	PersistentValuePtr obj = Run("({})");
+	PersistentValuePtr val = CreateNumber(3);
+	while (state.KeepRunning()) {
+		Error err = v8_Value_Set(ctx, obj, "x", val);
+		if (err.ptr != nullptr) {
+			Fail("v8_Value_Set", err);
+		}
+	}
+	v8_Value_Release(ctx, val);
+	v8_Value_Release(ctx, obj);
+}
+BENCHMARK(BM_Value_Set);
+
+void BM_Value_GetIdx(State& state) {
+	PersistentValuePtr arr = Run("[1, 2, 3, 4]");
+	while (state.KeepRunning()) {
+		Release(v8_Value_GetIdx(ctx, arr, 2));
+	}
+	v8_Value_Release(ctx, arr);
+}
+BENCHMARK(BM_Value_GetIdx);
+
+void BM_Value_SetIdx(State& state) {
+	PersistentValuePtr arr = Run("[1, 2, 3, 4]");
+	PersistentValuePtr val = CreateNumber(3);
+	while (state.KeepRunning()) {
+		Error err = v8_Value_SetIdx(ctx, arr, 2, val);
+		if (err.ptr != nullptr) {
+			Fail("v8_Value_SetIdx", err);
+		}
+	}
+	v8_Value_Release(ctx, val);
+	v8_Value_Release(ctx, arr);
+}
+BENCHMARK(BM_Value_SetIdx);
+
+void BM_Value_GetRange(State& state) {
+	std::string code = "Array.from({length: " + std::to_string(state.range(0)) + "}, (_, i) => i / 2)";
+	PersistentValuePtr arr = Run(code.c_str());
+	int count = int(state.range(0));
+	while (state.KeepRunning()) {
+		ArrayRange range = v8_Value_GetRange(ctx, arr, 0, count, tFLOAT64);
+		if (range.error_msg.ptr != nullptr) {
+			Fail("v8_Value_GetRange", range.error_msg);
+		}
+		free(range.Float64s);
+	}
+	v8_Value_Release(ctx, arr);
+	state.SetBytesProcessed(state.iterations() * count * int64_t(sizeof(double)));
+}
+BENCHMARK(BM_Value_GetRange)->Arg(100)->Arg(10000);
+
+void BM_Value_GetOwnProperties(State& state) {
+	std::string code = "Object.fromEntries(Array.from({length: " + std::to_string(state.range(0)) +
+		"}, (_, i) => ['k' + i, i]))";
+	PersistentValuePtr obj = Run(code.c_str());
+	while (state.KeepRunning()) {
+		Properties props = v8_Value_GetOwnProperties(ctx, obj,
+			kPropertiesEnumerableOnly | kPropertiesWithValues);
+		if (props.error_msg.ptr != nullptr) {
+			Fail("v8_Value_GetOwnProperties", props.error_msg);
+		}
+		for (int i = 0; i < props.Length; i++) {
+			v8_Value_Release(ctx, props.Values[i].Value);
+		}
+		free(props.Keys);
+		free(props.Offsets);
+		free(props.Values);
+	}
+	v8_Value_Release(ctx, obj);
+}
+BENCHMARK(BM_Value_GetOwnProperties)->Arg(10)->Arg(1000);
+
+void BM_Value_String(State& state) {
+	PersistentValuePtr str = Run("'hello, world'");
+	while (state.KeepRunning()) {
+		String s = v8_Value_String(ctx, str);
+		v8_Free((void*)s.ptr);
+	}
+	v8_Value_Release(ctx, str);
+}
+BENCHMARK(BM_Value_String);
+
+void BM_Value_Float64(State& state) {
+	PersistentValuePtr num = Run("157.5");
+	while (state.KeepRunning()) {
+		v8_Value_Float64(ctx, num);
+	}
+	v8_Value_Release(ctx, num);
+}
+BENCHMARK(BM_Value_Float64);
+
+void BM_Value_Int64(State& state) {
+	PersistentValuePtr num = Run("157");
+	while (state.KeepRunning()) {
+		v8_Value_Int64(ctx, num);
+	}
+	v8_Value_Release(ctx, num);
+}
+BENCHMARK(BM_Value_Int64);
+
+void BM_Value_Bool(State& state) {
+	PersistentValuePtr b = Run("true");
+	while (state.KeepRunning()) {
+		v8_Value_Bool(ctx, b);
+	}
+	v8_Value_Release(ctx, b);
+}
+BENCHMARK(BM_Value_Bool);
+
+void BM_Value_BigInt64(State& state) {
+	PersistentValuePtr big = Run("2n ** 60n");
+	int lossless;
+	while (state.KeepRunning()) {
+		v8_Value_BigInt64(ctx, big, &lossless);
+	}
+	v8_Value_Release(ctx, big);
+}
+BENCHMARK(BM_Value_BigInt64);
+
+void BM_Value_Bytes(State& state) {
+	PersistentValuePtr buf = Run("new Uint8Array(4096).buffer");
+	while (state.KeepRunning()) {
+		v8_Value_Bytes(ctx, buf);
+	}
+	v8_Value_Release(ctx, buf);
+}
+BENCHMARK(BM_Value_Bytes);
+
+void BM_Value_PromiseInfo(State& state) {
+	PersistentValuePtr promise = Run("Promise.resolve(1)");
+	int promise_state;
+	while (state.KeepRunning()) {
+		Release(v8_Value_PromiseInfo(ctx, promise, &promise_state));
+	}
+	v8_Value_Release(ctx, promise);
+}
+BENCHMARK(BM_Value_PromiseInfo);
+
+// Creating and releasing the persistent handle of a value, which every value
+// returned to Go goes through.
+void BM_Value_Release(State& state) {
+	PersistentValuePtr obj = Run("({ x: 1 })");
+	while (state.KeepRunning()) {
+		v8_Value_Release(ctx, v8_Value_Get(ctx, obj, "x").Value);
+	}
+	v8_Value_Release(ctx, obj);
+}
+BENCHMARK(BM_Value_Release);
+
+// --- Calls -----------------------------------------------------------------
+
+void BM_Value_Call(State& state) {
+	PersistentValuePtr fn = Run("(function(...args) { return args.length })");
+	std::vector<PersistentValuePtr> args = CreateArgs(state.range(0));
+	while (state.KeepRunning()) {
+		Release(v8_Value_Call(ctx, fn, nullptr, int(args.size()), args.data()));
+	}
+	ReleaseAll(args);
+	v8_Value_Release(ctx, fn);
+}
+BENCHMARK(BM_Value_Call)->Arg(0)->Arg(1)->Arg(4)->Arg(16);
+
+void BM_PreparedCall_Call(State& state) {
+	PersistentValuePtr fn = Run("(function(...args) { return args.length })");
+	int nargs = int(state.range(0));
+	PreparedCallPtr call = v8_Context_PrepareCall(ctx, fn, nullptr, nargs);
+	CallArg* args = v8_PreparedCall_Args(call);
+	while (state.KeepRunning()) {
+		for (int i = 0; i < nargs; i++) {
+			args[i].Type = tFLOAT64;
+			args[i].Float64 = i;
+		}
+		Release(v8_PreparedCall_Call(ctx, call, 1));
+	}
+	v8_PreparedCall_Release(ctx, call);
+	v8_Value_Release(ctx, fn);
+}
+BENCHMARK(BM_PreparedCall_Call)->Arg(0)->Arg(1)->Arg(4)->Arg(16);
+
+void BM_Value_New(State& state) {
+	PersistentValuePtr cls = Run("(class { constructor(...args) { this.args = args } })");
+	std::vector<PersistentValuePtr> args = CreateArgs(state.range(0));
+	while (state.KeepRunning()) {
+		Release(v8_Value_New(ctx, cls, int(args.size()), args.data()));
+	}
+	ReleaseAll(args);
+	v8_Value_Release(ctx, cls);
+}
+BENCHMARK(BM_Value_New)->Arg(0)->Arg(1)->Arg(4)->Arg(16);
+
+// Calls from JS into the stub callback handler, 1000 per iteration so that
+// the cost of the call into the loop doesn't dominate.
+void CallbackLoop(State& state, int capture_caller) {
+	PersistentValuePtr cb = v8_Context_RegisterCallback(ctx, "cb", "1", capture_caller);
+	PersistentValuePtr global = v8_Context_Global(ctx);
+	Error err = v8_Value_Set(ctx, global, "cb", cb);
+	if (err.ptr != nullptr) {
+		Fail("v8_Value_Set", err);
+	}
+
+	std::string args;
+	for (int64_t i = 0; i < state.range(0); i++) {
+		args += (i > 0 ? ", " : "") + std::to_string(i);
+	}
+	std::string code = "(function() { for (let i = 0; i < 1000; i++) cb(" + args + ") })";
+	PersistentValuePtr loop = Run(code.c_str());
+	while (state.KeepRunning()) {
+		Release(v8_Value_Call(ctx, loop, nullptr, 0, nullptr));
+	}
+	v8_Value_Release(ctx, loop);
+	v8_Value_Release(ctx, global);
+	v8_Value_Release(ctx, cb);
+}
+
+void BM_Callback(State& state) {
+	CallbackLoop(state, 1);
+}
+BENCHMARK(BM_Callback)->Arg(0)->Arg(1)->Arg(4)->Arg(16);
+
+// Without looking up the caller of every call.
+void BM_CallbackFast(State& state) {
+	CallbackLoop(state, 0);
+}
+BENCHMARK(BM_CallbackFast)->Arg(0)->Arg(1)->Arg(4)->Arg(16);
+
+// --- Wrapped and intercepted objects ---------------------------------------
+
+void BM_Context_Wrap(State& state) {
+	const char names[] = "abc";
+	int offsets[] = { 0, 1, 2, 3 };
+	char methods[] = { 0, 0, 1 };
+	int tmpl = v8_Isolate_NewStructTemplate(iso, names, offsets, methods, 3);
+	while (state.KeepRunning()) {
+		v8_Value_Release(ctx, v8_Context_Wrap(ctx, tmpl, 1));
+	}
+}
+BENCHMARK(BM_Context_Wrap);
+
+// Reads a property of a wrapped object through the stub accessor handler.
+void BM_WrappedGet(State& state) {
+	const char names[] = "a";
+	int offsets[] = { 0, 1 };
+	char methods[] = { 0 };
+	int tmpl = v8_Isolate_NewStructTemplate(iso, names, offsets, methods, 1);
+	PersistentValuePtr obj = v8_Context_Wrap(ctx, tmpl, 1);
+	while (state.KeepRunning()) {
+		Release(v8_Value_Get(ctx, obj, "a"));
+	}
+	v8_Value_Release(ctx, obj);
+}
+BENCHMARK(BM_WrappedGet);
+
+void BM_InterceptedGet(State& state) {
+	PersistentValuePtr obj = v8_Context_NewInterceptedObject(ctx, kInterceptNamed | kInterceptIndexed, 1);
+	while (state.KeepRunning()) {
+		Release(v8_Value_Get(ctx, obj, "a"));
+	}
+	v8_Value_Release(ctx, obj);
+}
+BENCHMARK(BM_InterceptedGet);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+	std::string filter = ".";
+	double min_time = 0.5;
+	bool list = false;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg.compare(0, 19, "--benchmark_filter=") == 0) {
+			filter = arg.substr(19);
+		} else if (arg.compare(0, 21, "--benchmark_min_time=") == 0) {
+			min_time = atof(arg.c_str() + 21);
+		} else if (arg == "--benchmark_list_tests") {
+			list = true;
+		} else {
+			fprintf(stderr, "usage: %s [--benchmark_filter=<regex>] [--benchmark_min_time=<seconds>] "
+				"[--benchmark_list_tests]\n", argv[0]);
+			return 1;
+		}
+	}
+	std::regex re(filter);
+
+	std::vector<std::pair<std::string, int64_t>> runs;
+	std::vector<BenchmarkFunc> fns;
+	size_t width = 10;
+	for (Benchmark* b : Benchmarks()) {
+		for (auto& run : b->Runs()) {
+			if (std::regex_search(run.first, re)) {
+				runs.push_back(run);
+				fns.push_back(b->fn());
+				width = std::max(width, run.first.size());
+			}
+		}
+	}
+	if (list) {
+		for (auto& run : runs) {
+			printf("%s\n", run.first.c_str());
+		}
+		return 0;
+	}
+
+	v8_Init(StubCallbackHandler, nullptr, 0, 0, nullptr);
+	v8_SetModuleResolveHandler(StubResolveModuleHandler);
+	v8_SetWrapHandlers(StubAccessorHandler, StubInterceptorHandler, StubReleaseHandle);
+	iso = v8_Isolate_New(nullptr);
+	ctx = v8_Isolate_NewContext(iso, 1);
+
+	std::string rule(width + 44, '-');
+	printf("V8 %d.%d.%d.%d\n%s\n", version.Major, version.Minor, version.Build, version.Patch,
+		rule.c_str());
+	printf("%-*s %13s %15s %12s\n", int(width), "Benchmark", "Time", "CPU", "Iterations");
+	printf("%s\n", rule.c_str());
+	for (size_t i = 0; i < runs.size(); i++) {
+		State state = RunBenchmark(fns[i], runs[i].second, min_time);
+		printf("%-*s ", int(width), runs[i].first.c_str());
+		if (!state.error().empty()) {
+			printf("ERROR OCCURRED: '%s'\n", state.error().c_str());
+			continue;
+		}
+		double n = double(std::max<int64_t>(state.iterations(), 1));
+		printf("%10.0f ns %12.0f ns %12lld", state.wall() / n * 1e9, state.cpu() / n * 1e9,
+			(long long)state.iterations());
+		if (state.bytes() > 0 && state.wall() > 0) {
+			printf(" bytes_per_second=%s", FormatBytesPerSecond(state.bytes() / state.wall()).c_str());
+		}
+		printf("\n");
+		fflush(stdout);
+	}
+
+	v8_Context_Release(ctx);
+	v8_Isolate_Release(iso);
+	return 0;
+}
@@ -1,6 +1,15 @@
 package v8
 
-import "testing"
+import (
+	"encoding/json"
+	"fmt"
+	"io"
+	"reflect"
+	"runtime"
+	"strings"
+	"sync"
+	"testing"
+)
 
 func BenchmarkGetValue(b *testing.B) {
 
@@ -18,6 +27,7 @@ func BenchmarkGetValue(b *testing.B) {
 
 	glob := ctx.Global()
 
+	b.ReportAllocs()
 	b.ResetTimer()
 	for n := 0; n < b.N; n++ {
 		if _, err := glob.Get("hello"); err != nil {
@@ -38,6 +48,7 @@ func BenchmarkGetNumberValue(b *testing.B) {
 	if err != nil {
 		b.Fatal(err)
 	}
+	b.ReportAllocs()
 	b.ResetTimer()
 	for n := 0; n < b.N; n += 2 {
 		if res := val.Int64(); res != 157 {
@@ -58,6 +69,7 @@ func BenchmarkContextCreate(b *testing.B) {
 
 	ctx := iso.NewContext()
 
+	b.ReportAllocs()
 	b.ResetTimer()
 	for n := 0; n < b.N; n++ {
 		if _, err := ctx.Create(map[string]interface{}{}); err != nil {
@@ -76,6 +88,7 @@ func BenchmarkEval(b *testing.B) {
 
 	script := `"hello"`
 
+	b.ReportAllocs()
 	b.ResetTimer()
 	for n := 0; n < b.N; n++ {
 		if _, err := ctx.Eval(script, "bench-eval.js"); err != nil {
@@ -98,6 +111,7 @@ func BenchmarkCallback(b *testing.B) {
 
 	script := `cb()`
 
+	b.ReportAllocs()
 	b.ResetTimer()
 	for n := 0; n < b.N; n++ {
 		if _, err := ctx.Eval(script, "bench-cb.js"); err != nil {
@@ -105,3 +119,875 @@ func BenchmarkCallback(b *testing.B) {
 		}
 	}
 }
+
+// BenchmarkEvalWithMessagePump runs an allocation-heavy script that compiles
+// a fresh function on every iteration, with and without pumping the isolate's
+// message loop. With pumping, the results of concurrent marking and
+// off-thread compilation are picked up promptly, so the difference grows with
+// the number of cores available to V8's worker pool.
+func BenchmarkEvalWithMessagePump(b *testing.B) {
+	script := `(function() {
+		var garbage = [];
+		for (var i = 0; i < 1000; i++) {
+			garbage.push({ index: i, label: "item-" + i, values: [i, i * 2, i * 3] });
+		}
+		return new Function("x", "return x * " + garbage.length)(2);
+	})()`
+
+	for _, pump := range []bool{false, true} {
+		name := "NoPump"
+		if pump {
+			name = "Pump"
+		}
+		b.Run(name, func(b *testing.B) {
+			iso, err := NewIsolate()
+			if err != nil {
+				b.Fatal(err)
+			}
+			ctx := iso.NewContext()
+
+			b.ReportAllocs()
+			b.ResetTimer()
+			for n := 0; n < b.N; n++ {
+				if _, err := ctx.Eval(script, "bench-pump.js"); err != nil {
+					b.Fatal(err)
+				}
+				if pump {
+					iso.PumpMessageLoop(0)
+				}
+			}
+		})
+	}
+}
+
+// BenchmarkContextCycle measures a context-per-request pattern: get a context
+// with a global set up from the isolate's template, evaluate a script and
+// throw the context away, either by releasing it or by recycling it.
+func BenchmarkContextCycle(b *testing.B) {
+	iso, err := NewIsolate()
+	if err != nil {
+		b.Fatal(err)
+	}
+	if err := iso.SetGlobal("version", "1.0"); err != nil {
+		b.Fatal(err)
+	}
+
+	script := `var request = { version: version }; request.version`
+
+	b.Run("NewRelease", func(b *testing.B) {
+		b.ReportAllocs()
+		for n := 0; n < b.N; n++ {
+			ctx := iso.NewContext()
+			if _, err := ctx.Eval(script, "bench-cycle.js"); err != nil {
+				b.Fatal(err)
+			}
+			ctx.Release()
+		}
+	})
+
+	b.Run("Recycle", func(b *testing.B) {
+		b.ReportAllocs()
+		ctx := iso.NewContext()
+		for n := 0; n < b.N; n++ {
+			if _, err := ctx.Eval(script, "bench-cycle.js"); err != nil {
+				b.Fatal(err)
+			}
+			if err := ctx.Recycle(); err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+}
+
+// BenchmarkFloat64ArrayRead reads a Float64Array of 1M elements into Go,
+// element by element and through the typed view.
+func BenchmarkFloat64ArrayRead(b *testing.B) {
+	iso, err := NewIsolate()
+	if err != nil {
+		b.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	const size = 1 << 20
+	arr, err := ctx.Eval(`new Float64Array(1 << 20).map((_, i) => i / 2)`, "bench-typed.js")
+	if err != nil {
+		b.Fatal(err)
+	}
+
+	b.Run("GetIndex", func(b *testing.B) {
+		b.ReportAllocs()
+		b.SetBytes(size * 8)
+		for n := 0; n < b.N; n++ {
+			sum := 0.0
+			for i := 0; i < size; i++ {
+				v, err := arr.GetIndex(i)
+				if err != nil {
+					b.Fatal(err)
+				}
+				sum += v.Float64()
+			}
+		}
+	})
+
+	b.Run("View", func(b *testing.B) {
+		b.ReportAllocs()
+		b.SetBytes(size * 8)
+		for n := 0; n < b.N; n++ {
+			view, err := arr.Float64s()
+			if err != nil {
+				b.Fatal(err)
+			}
+			sum := 0.0
+			for _, v := range view {
+				sum += v
+			}
+		}
+	})
+}
+
+// BenchmarkReadIntoSlice reads an array of 10k numbers into a Go slice, which
+// is done with a single range read.
+func BenchmarkReadIntoSlice(b *testing.B) {
+	iso, err := NewIsolate()
+	if err != nil {
+		b.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	arr, err := ctx.Eval(`Array.from({length: 10000}, (_, i) => i * 1.5)`, "bench-range.js")
+	if err != nil {
+		b.Fatal(err)
+	}
+
+	b.ReportAllocs()
+	b.ResetTimer()
+	for n := 0; n < b.N; n++ {
+		var nums []float64
+		if err := ReadInto(&nums, arr, 1); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+// BenchmarkReadIntoMap reads an object with 1k properties into a Go map, which
+// fetches all keys and values in a single call.
+func BenchmarkReadIntoMap(b *testing.B) {
+	iso, err := NewIsolate()
+	if err != nil {
+		b.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	obj, err := ctx.Eval(`Object.fromEntries(Array.from({length: 1000}, (_, i) => ["k" + i, i]))`, "bench-props.js")
+	if err != nil {
+		b.Fatal(err)
+	}
+
+	b.ReportAllocs()
+	b.ResetTimer()
+	for n := 0; n < b.N; n++ {
+		var m map[string]float64
+		if err := ReadInto(&m, obj, 1); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+type wideStruct struct {
+	F00, F01, F02, F03, F04, F05, F06, F07, F08, F09 float64
+	F10, F11, F12, F13, F14, F15, F16, F17, F18, F19 string
+	F20, F21, F22, F23, F24, F25, F26, F27, F28, F29 bool
+	F30, F31, F32, F33, F34, F35, F36, F37, F38, F39 float64
+	F40, F41, F42, F43, F44, F45, F46, F47, F48, F49 string
+	F50, F51, F52, F53, F54, F55, F56, F57, F58, F59 int
+}
+
+// BenchmarkCreateWideStruct and BenchmarkWrapWideStruct pass a struct with 60
+// fields to a script that reads two of them.
+func BenchmarkCreateWideStruct(b *testing.B) {
+	benchmarkWideStruct(b, func(ctx *Context, s *wideStruct) (*Value, error) {
+		return ctx.Create(s)
+	})
+}
+
+func BenchmarkWrapWideStruct(b *testing.B) {
+	benchmarkWideStruct(b, func(ctx *Context, s *wideStruct) (*Value, error) {
+		return ctx.Wrap(s)
+	})
+}
+
+func benchmarkWideStruct(b *testing.B, toJS func(*Context, *wideStruct) (*Value, error)) {
+	iso, err := NewIsolate()
+	if err != nil {
+		b.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	fn, err := ctx.Eval(`(s) => s.F00 + s.F59`, "bench-wide.js")
+	if err != nil {
+		b.Fatal(err)
+	}
+	s := &wideStruct{F00: 1, F59: 2}
+
+	b.ReportAllocs()
+	b.ResetTimer()
+	for n := 0; n < b.N; n++ {
+		v, err := toJS(ctx, s)
+		if err != nil {
+			b.Fatal(err)
+		}
+		if _, err := fn.Call(nil, v); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+// BenchmarkCreateLargeMap and BenchmarkViewLargeMap pass a map with 100k
+// entries to a script that looks up one of them.
+func BenchmarkCreateLargeMap(b *testing.B) {
+	benchmarkLargeMap(b, (*Context).Create)
+}
+
+func BenchmarkViewLargeMap(b *testing.B) {
+	benchmarkLargeMap(b, (*Context).CreateView)
+}
+
+func benchmarkLargeMap(b *testing.B, toJS func(*Context, interface{}) (*Value, error)) {
+	iso, err := NewIsolate()
+	if err != nil {
+		b.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	fn, err := ctx.Eval(`(m) => m.k500`, "bench-map.js")
+	if err != nil {
+		b.Fatal(err)
+	}
+	m := make(map[string]float64, 100000)
+	for i := 0; i < 100000; i++ {
+		m[fmt.Sprintf("k%d", i)] = float64(i)
+	}
+
+	b.ReportAllocs()
+	b.ResetTimer()
+	for n := 0; n < b.N; n++ {
+		v, err := toJS(ctx, m)
+		if err != nil {
+			b.Fatal(err)
+		}
+		if _, err := fn.Call(nil, v); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+// BenchmarkCreateLargeString and BenchmarkCreateExternalString pass a 1MB
+// text to a script.
+func BenchmarkCreateLargeString(b *testing.B) {
+	benchmarkLargeString(b, func(ctx *Context, text string, _ *ExternalString) (*Value, error) {
+		return ctx.Create(text)
+	})
+}
+
+func BenchmarkCreateExternalString(b *testing.B) {
+	benchmarkLargeString(b, func(ctx *Context, _ string, es *ExternalString) (*Value, error) {
+		return ctx.CreateExternalString(es)
+	})
+}
+
+func benchmarkLargeString(b *testing.B, toJS func(*Context, string, *ExternalString) (*Value, error)) {
+	iso, err := NewIsolate()
+	if err != nil {
+		b.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	fn, err := ctx.Eval(`(s) => s.length`, "bench-string.js")
+	if err != nil {
+		b.Fatal(err)
+	}
+	text := strings.Repeat("<p>Some template text</p>\n", 1<<20/26)
+	es := NewExternalString(text)
+	defer es.Release()
+
+	b.SetBytes(int64(len(text)))
+	b.ReportAllocs()
+	b.ResetTimer()
+	for n := 0; n < b.N; n++ {
+		v, err := toJS(ctx, text, es)
+		if err != nil {
+			b.Fatal(err)
+		}
+		if _, err := fn.Call(nil, v); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+// BenchmarkRuntime runs a CPU-bound script on runtimes of increasing size;
+// ns/op should drop nearly linearly with the number of isolates, up to the
+// number of cores.
+func BenchmarkRuntime(b *testing.B) {
+	counts := []int{1, 2, 4}
+	if n := runtime.NumCPU(); n > 4 {
+		counts = append(counts, n)
+	}
+	for _, isolates := range counts {
+		b.Run(fmt.Sprintf("isolates=%d", isolates), func(b *testing.B) {
+			rt, err := NewRuntime(RuntimeOptions{
+				Isolates: isolates,
+				Setup: func(ctx *Context) error {
+					_, err := ctx.Eval(`function work() {
+						let x = 0;
+						for (let i = 0; i < 10000; i++) x = (x + i * i) % 1000003;
+						return x;
+					}`, "bench-runtime.js")
+					return err
+				},
+			})
+			if err != nil {
+				b.Fatal(err)
+			}
+			defer rt.Close()
+
+			var wg sync.WaitGroup
+			wg.Add(b.N)
+			b.ReportAllocs()
+			b.ResetTimer()
+			for n := 0; n < b.N; n++ {
+				err := rt.Submit(func(ctx *Context) {
+					defer wg.Done()
+					if _, err := ctx.Eval(`work()`, "job.js"); err != nil {
+						b.Error(err)
+					}
+				})
+				if err != nil {
+					b.Fatal(err)
+				}
+			}
+			wg.Wait()
+			b.StopTimer()
+
+			var stolen uint64
+			for _, s := range rt.Stats() {
+				stolen += s.Stolen
+			}
+			b.ReportMetric(float64(stolen)/float64(b.N), "stolen/op")
+		})
+	}
+}
+
+// The benchmarks below cover each kind of crossing between Go and V8, with
+// allocations reported so that regressions show up in benchstat output.
+
+type benchItem struct {
+	ID    int
+	Label string
+	Price float64
+}
+
+type benchOrder struct {
+	Customer struct {
+		Name  string
+		Email string
+	}
+	Tags     []string
+	Items    []benchItem
+	Totals   map[string]float64
+	Shipping *benchItem
+}
+
+func newBenchOrder(items int) *benchOrder {
+	o := &benchOrder{Tags: []string{"express", "gift"}, Totals: map[string]float64{}}
+	o.Customer.Name = "Ada"
+	o.Customer.Email = "ada@example.com"
+	for i := 0; i < items; i++ {
+		o.Items = append(o.Items, benchItem{i, fmt.Sprintf("item-%d", i), float64(i) * 1.25})
+	}
+	o.Totals["net"], o.Totals["tax"] = 100, 20
+	o.Shipping = &benchItem{-1, "shipping", 4.5}
+	return o
+}
+
+func newBenchContext(b *testing.B) *Context {
+	iso, err := NewIsolate()
+	if err != nil {
+		b.Fatal(err)
+	}
+	return iso.NewContext()
+}
+
+func benchCollections() map[string]interface{} {
+	large := make([]float64, 100000)
+	for i := range large {
+		large[i] = float64(i) / 3
+	}
+	m := make(map[string]int, 1000)
+	for i := 0; i < 1000; i++ {
+		m[fmt.Sprintf("key%d", i)] = i
+	}
+	return map[string]interface{}{
+		"NestedStruct": newBenchOrder(20),
+		"Map":          m,
+		"LargeSlice":   large,
+	}
+}
+
+var benchCollectionNames = []string{"NestedStruct", "Map", "LargeSlice"}
+
+func BenchmarkCreate(b *testing.B) {
+	ctx := newBenchContext(b)
+	vals := benchCollections()
+	for _, name := range benchCollectionNames {
+		val := vals[name]
+		b.Run(name, func(b *testing.B) {
+			b.ReportAllocs()
+			for n := 0; n < b.N; n++ {
+				v, err := ctx.Create(val)
+				if err != nil {
+					b.Fatal(err)
+				}
+				v.release()
+			}
+		})
+	}
+}
+
+func BenchmarkReadInto(b *testing.B) {
+	ctx := newBenchContext(b)
+	vals := benchCollections()
+	for _, name := range benchCollectionNames {
+		val := vals[name]
+		b.Run(name, func(b *testing.B) {
+			v, err := ctx.Create(val)
+			if err != nil {
+				b.Fatal(err)
+			}
+			typ := reflect.TypeOf(val)
+			if typ.Kind() == reflect.Ptr {
+				typ = typ.Elem()
+			}
+			b.ReportAllocs()
+			b.ResetTimer()
+			for n := 0; n < b.N; n++ {
+				if err := ReadInto(reflect.New(typ).Interface(), v, 4); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+func BenchmarkMarshalJSON(b *testing.B) {
+	ctx := newBenchContext(b)
+	v, err := ctx.Create(newBenchOrder(100))
+	if err != nil {
+		b.Fatal(err)
+	}
+	data, err := v.MarshalJSON()
+	if err != nil {
+		b.Fatal(err)
+	}
+
+	b.ReportAllocs()
+	b.SetBytes(int64(len(data)))
+	b.ResetTimer()
+	for n := 0; n < b.N; n++ {
+		if _, err := v.MarshalJSON(); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+func BenchmarkParseJson(b *testing.B) {
+	ctx := newBenchContext(b)
+	data, err := json.Marshal(newBenchOrder(100))
+	if err != nil {
+		b.Fatal(err)
+	}
+	str := string(data)
+
+	b.ReportAllocs()
+	b.SetBytes(int64(len(data)))
+	b.ResetTimer()
+	for n := 0; n < b.N; n++ {
+		v, err := ctx.ParseJson(str)
+		if err != nil {
+			b.Fatal(err)
+		}
+		v.release()
+	}
+}
+
+var benchArgCounts = []int{0, 1, 4, 16}
+
+func benchArgs(b *testing.B, ctx *Context, count int) []*Value {
+	args := make([]*Value, count)
+	for i := range args {
+		var err error
+		if args[i], err = ctx.Create(i); err != nil {
+			b.Fatal(err)
+		}
+	}
+	return args
+}
+
+// BenchmarkCallbackArgs calls a Go callback from a JS loop, so that the cost
+// of converting the arguments isn't hidden by the cost of Eval.
+func BenchmarkCallbackArgs(b *testing.B) {
+	ctx := newBenchContext(b)
+	ctx.Global().Set("cb", ctx.Bind("cb", func(in CallbackArgs) (*Value, error) {
+		return nil, nil
+	}))
+	for _, count := range benchArgCounts {
+		b.Run(fmt.Sprintf("args=%d", count), func(b *testing.B) {
+			list := make([]string, count)
+			for i := range list {
+				list[i] = fmt.Sprint(i)
+			}
+			loop, err := ctx.Eval(fmt.Sprintf(`(function(n) { for (let i = 0; i < n; i++) cb(%s) })`,
+				strings.Join(list, ", ")), "bench-cb-args.js")
+			if err != nil {
+				b.Fatal(err)
+			}
+			iterations, err := ctx.Create(b.N)
+			if err != nil {
+				b.Fatal(err)
+			}
+			b.ReportAllocs()
+			b.ResetTimer()
+			if _, err := loop.Call(nil, iterations); err != nil {
+				b.Fatal(err)
+			}
+		})
+	}
+}
+
+// BenchmarkCallbackCaller compares the cost of looking up the caller of every
+// call (Bind) with functions that skip it (BindWithOptions), and those that
+// look it up on demand.
+func BenchmarkCallbackCaller(b *testing.B) {
+	ctx := newBenchContext(b)
+	noop := func(in CallbackArgs) (*Value, error) {
+		return nil, nil
+	}
+	callers := map[string]*Value{
+		"Bind": ctx.Bind("cb", noop),
+		"Fast": ctx.BindWithOptions("cb", noop, BindOptions{}),
+		"Lazy": ctx.BindWithOptions("cb", noop, BindOptions{CaptureCaller: true}),
+		"LazyUsed": ctx.BindWithOptions("cb", func(in CallbackArgs) (*Value, error) {
+			in.CallerLoc()
+			return nil, nil
+		}, BindOptions{CaptureCaller: true}),
+	}
+	loop, err := ctx.Eval(`(function(cb, n) { for (let i = 0; i < n; i++) cb() })`, "bench-cb-caller.js")
+	if err != nil {
+		b.Fatal(err)
+	}
+	for _, name := range []string{"Bind", "Fast", "Lazy", "LazyUsed"} {
+		b.Run(name, func(b *testing.B) {
+			iterations, err := ctx.Create(b.N)
+			if err != nil {
+				b.Fatal(err)
+			}
+			b.ReportAllocs()
+			b.ResetTimer()
+			if _, err := loop.Call(nil, callers[name], iterations); err != nil {
+				b.Fatal(err)
+			}
+		})
+	}
+}
+
+func BenchmarkCall(b *testing.B) {
+	ctx := newBenchContext(b)
+	fn, err := ctx.Eval(`(function(...args) { return args.length })`, "bench-call.js")
+	if err != nil {
+		b.Fatal(err)
+	}
+	for _, count := range benchArgCounts {
+		b.Run(fmt.Sprintf("args=%d", count), func(b *testing.B) {
+			args := benchArgs(b, ctx, count)
+			b.ReportAllocs()
+			b.ResetTimer()
+			for n := 0; n < b.N; n++ {
+				v, err := fn.Call(nil, args...)
+				if err != nil {
+					b.Fatal(err)
+				}
+				v.release()
+			}
+		})
+	}
+}
+
+// BenchmarkPreparedCall is BenchmarkCall with a PreparedCall, setting every
+// argument before each call like an event handler would.
+func BenchmarkPreparedCall(b *testing.B) {
+	ctx := newBenchContext(b)
+	fn, err := ctx.Eval(`(function(...args) { return args.length })`, "bench-call.js")
+	if err != nil {
+		b.Fatal(err)
+	}
+	for _, count := range benchArgCounts {
+		b.Run(fmt.Sprintf("args=%d", count), func(b *testing.B) {
+			call, err := fn.Prepare(nil, count)
+			if err != nil {
+				b.Fatal(err)
+			}
+			defer call.Release()
+			b.ReportAllocs()
+			b.ResetTimer()
+			for n := 0; n < b.N; n++ {
+				for i := 0; i < count; i++ {
+					call.SetFloat64(i, float64(n))
+				}
+				if err := call.Invoke(); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+func BenchmarkNew(b *testing.B) {
+	ctx := newBenchContext(b)
+	cls, err := ctx.Eval(`(class { constructor(...args) { this.args = args } })`, "bench-new.js")
+	if err != nil {
+		b.Fatal(err)
+	}
+	for _, count := range benchArgCounts {
+		b.Run(fmt.Sprintf("args=%d", count), func(b *testing.B) {
+			args := benchArgs(b, ctx, count)
+			b.ReportAllocs()
+			b.ResetTimer()
+			for n := 0; n < b.N; n++ {
+				v, err := cls.New(args...)
+				if err != nil {
+					b.Fatal(err)
+				}
+				v.release()
+			}
+		})
+	}
+}
+
+// BenchmarkArrayBuffer copies byte slices into ArrayBuffers and back.
+func BenchmarkArrayBuffer(b *testing.B) {
+	ctx := newBenchContext(b)
+	for _, size := range []int{1 << 10, 64 << 10, 1 << 20} {
+		buf := make([]byte, size)
+		for i := range buf {
+			buf[i] = byte(i)
+		}
+		b.Run(fmt.Sprintf("In/%dK", size>>10), func(b *testing.B) {
+			b.ReportAllocs()
+			b.SetBytes(int64(size))
+			for n := 0; n < b.N; n++ {
+				v, _, err := ctx.createWithTags(reflect.ValueOf(buf), []string{"arraybuffer"})
+				if err != nil {
+					b.Fatal(err)
+				}
+				v.release()
+			}
+		})
+		b.Run(fmt.Sprintf("Out/%dK", size>>10), func(b *testing.B) {
+			v, _, err := ctx.createWithTags(reflect.ValueOf(buf), []string{"arraybuffer"})
+			if err != nil {
+				b.Fatal(err)
+			}
+			b.ReportAllocs()
+			b.SetBytes(int64(size))
+			b.ResetTimer()
+			for n := 0; n < b.N; n++ {
+				if len(v.Bytes()) != size {
+					b.Fatal("Wrong size")
+				}
+			}
+		})
+	}
+}
+
+func BenchmarkNewIsolate(b *testing.B) {
+	snapshot, err := CreateSnapshot(`var config = { retries: 3, hosts: ["a", "b"] };
+		function lookup(host) { return config.hosts.indexOf(host) }`, true, nil)
+	if err != nil {
+		b.Fatal(err)
+	}
+
+	b.Run("Plain", func(b *testing.B) {
+		b.ReportAllocs()
+		for n := 0; n < b.N; n++ {
+			iso, err := NewIsolate()
+			if err != nil {
+				b.Fatal(err)
+			}
+			iso.NewContext().release()
+			iso.release()
+		}
+	})
+	b.Run("Snapshot", func(b *testing.B) {
+		b.ReportAllocs()
+		for n := 0; n < b.N; n++ {
+			iso, err := NewIsolateWithSnapshot(snapshot)
+			if err != nil {
+				b.Fatal(err)
+			}
+			iso.NewContext().release()
+			iso.release()
+		}
+	})
+}
+
+// BenchmarkValueChurn creates short-lived values and leaves their release to
+// the finalizers, as most code does, compared to releasing them explicitly.
+func BenchmarkValueChurn(b *testing.B) {
+	ctx := newBenchContext(b)
+	obj, err := ctx.Eval(`({ name: "churn" })`, "bench-churn.js")
+	if err != nil {
+		b.Fatal(err)
+	}
+
+	b.Run("Finalizer", func(b *testing.B) {
+		b.ReportAllocs()
+		for n := 0; n < b.N; n++ {
+			if _, err := obj.Get("name"); err != nil {
+				b.Fatal(err)
+			}
+			if n%1024 == 1023 {
+				runtime.GC()
+			}
+		}
+		runtime.GC()
+	})
+	b.Run("Release", func(b *testing.B) {
+		b.ReportAllocs()
+		for n := 0; n < b.N; n++ {
+			v, err := obj.Get("name")
+			if err != nil {
+				b.Fatal(err)
+			}
+			v.release()
+		}
+	})
+}
+
+// BenchmarkParallelIsolates evaluates a script on one isolate per goroutine,
+// which shows how well independent isolates scale across cores.
+func BenchmarkParallelIsolates(b *testing.B) {
+	b.ReportAllocs()
+	b.RunParallel(func(pb *testing.PB) {
+		iso, err := NewIsolate()
+		if err != nil {
+			b.Error(err)
+			return
+		}
+		defer iso.release()
+		ctx := iso.NewContext()
+		defer ctx.release()
+
+		for pb.Next() {
+			v, err := ctx.Eval(`JSON.stringify({ list: [1, 2, 3].map(x => x * 2) })`, "bench-parallel.js")
+			if err != nil {
+				b.Error(err)
+				return
+			}
+			v.release()
+		}
+	})
+}
+
+// BenchmarkBridgeStats measures the overhead of collecting bridge statistics
+// on a cheap call.
+func BenchmarkBridgeStats(b *testing.B) {
+	ctx := newBenchContext(b)
+	obj, err := ctx.Eval(`({ name: "stats" })`, "bench-stats.js")
+	if err != nil {
+		b.Fatal(err)
+	}
+	for _, enabled := range []bool{false, true} {
+		b.Run(fmt.Sprintf("enabled=%v", enabled), func(b *testing.B) {
+			ctx.iso.EnableBridgeStats(enabled)
+			defer ctx.iso.EnableBridgeStats(false)
+			b.ReportAllocs()
+			for n := 0; n < b.N; n++ {
+				v, err := obj.Get("name")
+				if err != nil {
+					b.Fatal(err)
+				}
+				v.release()
+			}
+		})
+	}
+}
+
+// BenchmarkScope reads 1k elements of an array, leaving the values to their
+// finalizers or releasing them with a scope. Both collect garbage after each
+// iteration so that the cost of the finalizers is included.
+func BenchmarkScope(b *testing.B) {
+	ctx := newBenchContext(b)
+	arr, err := ctx.Eval(`Array.from({length: 1000}, (_, i) => i)`, "bench-scope.js")
+	if err != nil {
+		b.Fatal(err)
+	}
+	read := func(b *testing.B) {
+		for i := 0; i < 1000; i++ {
+			if _, err := arr.GetIndex(i); err != nil {
+				b.Fatal(err)
+			}
+		}
+	}
+
+	b.Run("Finalizer", func(b *testing.B) {
+		b.ReportAllocs()
+		for n := 0; n < b.N; n++ {
+			read(b)
+			runtime.GC()
+		}
+	})
+	b.Run("Scope", func(b *testing.B) {
+		b.ReportAllocs()
+		for n := 0; n < b.N; n++ {
+			ctx.Scope(func(*Scope) { read(b) })
+			runtime.GC()
+		}
+	})
+}
+
+// BenchmarkConsole logs 100 lines per iteration to a console of Go callbacks,
+// like the one of v8console.Config.Inject, and to the native console.
+func BenchmarkConsole(b *testing.B) {
+	const script = `for (let i = 0; i < 100; i++) console.log("line", i, true)`
+	run := func(b *testing.B, ctx *Context) {
+		b.ReportAllocs()
+		b.ResetTimer()
+		for n := 0; n < b.N; n++ {
+			if _, err := ctx.Eval(script, "bench-console.js"); err != nil {
+				b.Fatal(err)
+			}
+		}
+	}
+
+	b.Run("Callback", func(b *testing.B) {
+		ctx := newBenchContext(b)
+		console, _ := ctx.Create(map[string]interface{}{
+			"log": func(in CallbackArgs) (*Value, error) {
+				vals := make([]interface{}, len(in.Args))
+				for i, arg := range in.Args {
+					vals[i] = arg
+				}
+				fmt.Fprintln(io.Discard, vals...)
+				return nil, nil
+			},
+		})
+		ctx.Global().Set("console", console)
+		run(b, ctx)
+	})
+	b.Run("Native", func(b *testing.B) {
+		ctx := newBenchContext(b)
+		if _, err := ctx.InjectConsole(ConsoleOptions{Stdout: io.Discard}); err != nil {
+			b.Fatal(err)
+		}
+		run(b, ctx)
+	})
+}
@@ -0,0 +1,232 @@
+package main
+
+import (
+	"flag"
+	"fmt"
+	"io"
+	"io/ioutil"
+	"log"
+	"math"
+	"os"
+	"runtime"
+	"runtime/pprof"
+	"sort"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	v8 "github.com/jviksne/v8go"
+	"github.com/jviksne/v8go/v8console"
+)
+
+var (
+	benchRuns     = flag.Int("bench", 0, "benchmark mode: run the last file, or -func, this many times and report statistics")
+	benchIsolates = flag.Int("isolates", runtime.GOMAXPROCS(0), "number of isolates running the benchmark")
+	benchFunc     = flag.String("func", "", "global function to call in every benchmark run, after loading all files")
+	benchWarmup   = flag.Int("warmup", 0, "number of runs before the benchmark that aren't measured")
+	benchQuiet    = flag.Bool("quiet", false, "discard the console output of the benchmark")
+	cpuProfile    = flag.String("cpuprofile", "", "write a CPU profile of the benchmark to this file")
+)
+
+// benchmark runs the benchmark on a v8.Runtime, which is how services run
+// scripts: the files are loaded into the context of each isolate, then every
+// run is a job of the runtime that evaluates the last file or calls the
+// function.
+type benchmark struct {
+	rt       *v8.Runtime
+	isolates []*v8.Isolate
+	// consoles are the buffered consoles of the contexts, which -func runs
+	// have to flush: unlike Eval, Call doesn't write out the console output.
+	consoles map[*v8.Context]*v8.Console
+	run      func(ctx *v8.Context) error
+}
+
+func runBenchmark(filenames []string, snapshot *v8.Snapshot) {
+	if len(filenames) == 0 {
+		log.Fatal("-bench needs a file to run")
+	}
+	setup := filenames
+	var source string
+	if *benchFunc == "" {
+		setup = filenames[:len(filenames)-1]
+		data, err := ioutil.ReadFile(filenames[len(filenames)-1])
+		failOnError(err)
+		source = string(data)
+	}
+	sources := make([][]byte, len(setup))
+	for i, filename := range setup {
+		data, err := ioutil.ReadFile(filename)
+		failOnError(err)
+		sources[i] = data
+	}
+
+	var stdout, stderr io.Writer = os.Stdout, os.Stderr
+	if *benchQuiet {
+		stdout, stderr = ioutil.Discard, ioutil.Discard
+	}
+	console := v8console.Config{"", stdout, stderr, true}
+
+	b := &benchmark{consoles: map[*v8.Context]*v8.Console{}}
+	var mu sync.Mutex
+	rt, err := v8.NewRuntime(v8.RuntimeOptions{
+		Isolates: *benchIsolates,
+		Snapshot: snapshot,
+		Setup: func(ctx *v8.Context) error {
+			buffered := console.InjectBuffered(ctx, v8console.BufferOptions{})
+			for i, data := range sources {
+				if _, err := ctx.Eval(string(data), setup[i]); err != nil {
+					return err
+				}
+			}
+			mu.Lock()
+			b.isolates = append(b.isolates, ctx.Isolate())
+			b.consoles[ctx] = buffered
+			mu.Unlock()
+			return nil
+		},
+	})
+	failOnError(err)
+	defer rt.Close()
+	b.rt = rt
+
+	if *benchFunc != "" {
+		name := *benchFunc
+		b.run = func(ctx *v8.Context) (err error) {
+			ctx.Scope(func(*v8.Scope) {
+				var fn *v8.Value
+				if fn, err = ctx.Global().Get(name); err == nil {
+					_, err = fn.Call(nil)
+				}
+			})
+			mu.Lock()
+			buffered := b.consoles[ctx]
+			mu.Unlock()
+			if flushErr := buffered.Flush(); err == nil {
+				err = flushErr
+			}
+			return err
+		}
+	} else {
+		filename := filenames[len(filenames)-1]
+		b.run = func(ctx *v8.Context) (err error) {
+			ctx.Scope(func(*v8.Scope) {
+				_, err = ctx.Eval(source, filename)
+			})
+			return err
+		}
+	}
+
+	if _, _, err := b.measure(*benchWarmup); err != nil {
+		log.Fatalf("Warmup failed: %v", err)
+	}
+
+	if *cpuProfile != "" {
+		f, err := os.Create(*cpuProfile)
+		failOnError(err)
+		defer f.Close()
+		failOnError(pprof.StartCPUProfile(f))
+	}
+	var before, after runtime.MemStats
+	runtime.ReadMemStats(&before)
+	start := time.Now()
+	latencies, errors, firstErr := b.measure(*benchRuns)
+	elapsed := time.Since(start)
+	runtime.ReadMemStats(&after)
+	if *cpuProfile != "" {
+		pprof.StopCPUProfile()
+	}
+
+	w := os.Stdout
+	if errors > 0 {
+		fmt.Fprintf(w, "errors:      %d, the first: %v\n", errors, firstErr)
+	}
+	b.report(w, latencies, elapsed, &before, &after)
+}
+
+// measure runs the benchmark n times and returns the duration of each run,
+// the number of runs that failed and the first error.
+func (b *benchmark) measure(n int) ([]time.Duration, int64, error) {
+	latencies := make([]time.Duration, n)
+	var errors int64
+	var firstErr atomic.Value
+	var wg sync.WaitGroup
+	wg.Add(n)
+	for i := range latencies {
+		i := i
+		err := b.rt.Submit(func(ctx *v8.Context) {
+			defer wg.Done()
+			start := time.Now()
+			err := b.run(ctx)
+			latencies[i] = time.Since(start)
+			if err != nil && atomic.AddInt64(&errors, 1) == 1 {
+				firstErr.Store(err)
+			}
+		})
+		failOnError(err)
+	}
+	wg.Wait()
+	if errors == 0 {
+		return latencies, 0, nil
+	}
+	return latencies, errors, firstErr.Load().(error)
+}
+
+func (b *benchmark) report(w io.Writer, latencies []time.Duration, elapsed time.Duration,
+	before, after *runtime.MemStats) {
+	n := len(latencies)
+	fmt.Fprintf(w, "runs:        %d on %d isolates in %v\n", n, len(b.isolates), elapsed)
+	if n == 0 {
+		return
+	}
+	fmt.Fprintf(w, "throughput:  %.1f runs/s\n", float64(n)/elapsed.Seconds())
+
+	var total time.Duration
+	for _, l := range latencies {
+		total += l
+	}
+	sort.Slice(latencies, func(i, j int) bool { return latencies[i] < latencies[j] })
+	fmt.Fprintf(w, "latency:     mean %v", total/time.Duration(n))
+	for _, p := range []float64{50, 90, 99, 99.9} {
+		fmt.Fprintf(w, ", p%v %v", p, percentile(latencies, p))
+	}
+	fmt.Fprintf(w, ", max %v\n", latencies[n-1])
+
+	fmt.Fprintf(w, "go gc:       %d collections, %v paused, %s and %d allocs per run\n",
+		after.NumGC-before.NumGC, time.Duration(after.PauseTotalNs-before.PauseTotalNs),
+		formatBytes((after.TotalAlloc-before.TotalAlloc)/uint64(n)), (after.Mallocs-before.Mallocs)/uint64(n))
+
+	// The runs are done, so reading the heaps doesn't wait for the isolates.
+	for i, iso := range b.isolates {
+		hs := iso.GetHeapStatistics()
+		fmt.Fprintf(w, "v8 heap %d:   %s used of %s (limit %s), %s malloced (peak %s)\n", i,
+			formatBytes(hs.UsedHeapSize), formatBytes(hs.TotalHeapSize), formatBytes(hs.HeapSizeLimit),
+			formatBytes(hs.MallocedMemory), formatBytes(hs.PeakMallocedMemory))
+	}
+	for i, s := range b.rt.Stats() {
+		fmt.Fprintf(w, "isolate %d:   %d runs (%d stolen), %.0f%% busy\n", i, s.Executed, s.Stolen,
+			100*s.Utilization)
+	}
+}
+
+// percentile returns the p-th percentile of the sorted latencies, by the
+// nearest-rank method.
+func percentile(sorted []time.Duration, p float64) time.Duration {
+	rank := int(math.Ceil(p / 100 * float64(len(sorted))))
+	if rank < 1 {
+		rank = 1
+	}
+	return sorted[rank-1]
+}
+
+func formatBytes(n uint64) string {
+	const unit = 1024
+	if n < unit {
+		return fmt.Sprintf("%d B", n)
+	}
+	div, exp := uint64(unit), 0
+	for m := n / unit; m >= unit; m /= unit {
+		div *= unit
+		exp++
+	}
+	return fmt.Sprintf("%.1f %ciB", float64(n)/float64(div), "KMGTPE"[exp])
+}
@@ -12,6 +12,18 @@
 //   console.error:             write args to stderr in scary red
 //
 // Sooo... you can run your JS and print to the screen.
+//
+// With -bench N, it measures a script instead: the files are loaded into each
+// of -isolates isolates of a v8.Runtime, the way services run scripts, and the
+// last file, or the global function named by -func, is run N times. It then
+// reports the throughput, latency percentiles, Go garbage collections and the
+// heap statistics of the isolates, e.g.
+//
+//   v8-runjs -bench 10000 -warmup 100 -quiet -func render lib.js app.js
+//
+// -cpuprofile writes a CPU profile of the runs for go tool pprof, and
+// -snapshot creates the isolates from a snapshot file written by
+// Snapshot.WriteFile, in either mode.
 package main
 
 import (
@@ -32,10 +44,30 @@ const (
 	kRED   = "\033[91m"
 )
 
+var snapshotFile = flag.String("snapshot", "", "create the isolates from this snapshot file")
+
 func main() {
 	flag.Parse()
 	v8.Init("")
-	isol, err := v8.NewIsolate()
+
+	var snapshot *v8.Snapshot
+	if *snapshotFile != "" {
+		var err error
+		snapshot, err = v8.LoadSnapshotFile(*snapshotFile)
+		failOnError(err)
+	}
+	if *benchRuns > 0 {
+		runBenchmark(flag.Args(), snapshot)
+		return
+	}
+
+	var isol *v8.Isolate
+	var err error
+	if snapshot != nil {
+		isol, err = v8.NewIsolateWithSnapshot(snapshot)
+	} else {
+		isol, err = v8.NewIsolate()
+	}
 	if err != nil {
 		log.Fatal(err)
 	}
@@ -58,6 +58,7 @@ const (
 	KindSharedArrayBuffer
 	KindProxy
 	KindWebAssemblyCompiledModule
+	KindBigInt
 
 	kNumKinds
 )
@@ -110,6 +111,7 @@ var kindStrings = [kNumKinds]string{
 	"SharedArrayBuffer",
 	"Proxy",
 	"WebAssemblyCompiledModule",
+	"BigInt",
 }
 
 func (k Kind) String() string {
@@ -15,9 +15,10 @@ func TestKindString(t *testing.T) {
 		{KindNativeError, "NativeError"},
 		{KindRegExp, "RegExp"},
 		{KindWebAssemblyCompiledModule, "WebAssemblyCompiledModule"},
+		{KindBigInt, "BigInt"},
 
 		// Verify that we have N kinds and they are stringified reasonably.
-		{kNumKinds, "NoSuchKind:47"},
+		{kNumKinds, "NoSuchKind:48"},
 	}
 	for _, test := range testcases {
 		if test.kind.String() != test.str {
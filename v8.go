@@ -24,6 +24,7 @@ import "C"
 import (
 	"errors"
 	"fmt"
+	"reflect"
 	"runtime"
 	"strconv"
 	"strings"
@@ -49,6 +50,9 @@ type CallbackArgs struct {
 	Caller  Loc
 	Args    []*Value
 	Context *Context
+
+	// Set if the caller is looked up by CallerLoc, see BindOptions.
+	lazyCaller bool
 }
 
 // Arg returns the specified argument or "undefined" if it doesn't exist.
@@ -60,6 +64,27 @@ func (c *CallbackArgs) Arg(n int) *Value {
 	return undef
 }
 
+// CallerLoc returns the script location that javascript is calling from, like
+// Caller. Functions created by BindWithOptions leave Caller empty; with
+// BindOptions.CaptureCaller, CallerLoc looks the caller up the first time it
+// is called, which must be on the callback's goroutine before the callback
+// returns. Otherwise the location is empty.
+func (c *CallbackArgs) CallerLoc() Loc {
+	if c.lazyCaller {
+		c.lazyCaller = false
+		caller := C.v8_Isolate_CurrentCaller(c.Context.iso.ptr)
+		c.Caller = Loc{
+			Funcname: C.GoStringN(caller.Funcname.ptr, caller.Funcname.len),
+			Filename: C.GoStringN(caller.Filename.ptr, caller.Filename.len),
+			Line:     int(caller.Line),
+			Column:   int(caller.Column),
+		}
+		C.v8_Free(unsafe.Pointer(caller.Funcname.ptr))
+		C.v8_Free(unsafe.Pointer(caller.Filename.ptr))
+	}
+	return c.Caller
+}
+
 // Loc defines a script location.
 type Loc struct {
 	Funcname, Filename string
@@ -102,12 +127,54 @@ func (s PromiseState) String() string {
 var v8InitOnce sync.Once
 var isInit int32 = 0
 
+// InitOptions configure the V8 platform that is shared by all isolates in the
+// process.
+type InitOptions struct {
+	// ThreadPoolSize is the number of background worker threads V8 uses for
+	// concurrent marking, off-thread compilation and similar tasks. Zero lets
+	// V8 pick a size based on the number of cores.
+	ThreadPoolSize int
+	// IdleTasks enables V8's idle tasks (e.g. idle-time GC). They are only run
+	// when the isolate's message loop is pumped, see Isolate.PumpMessageLoop.
+	IdleTasks bool
+	// SnapshotFile is a file written by Snapshot.WriteFile that is used as the
+	// default snapshot for new isolates. The file is mapped read-only and
+	// shared by all isolates instead of being copied into each of them. If it
+	// can't be loaded, InitWithOptions returns the error and new isolates
+	// start from V8's built-in snapshot.
+	SnapshotFile string
+}
+
 func Init(icuDataFile string) {
+	InitWithOptions(icuDataFile, InitOptions{})
+}
+
+// initErr is the error of the first InitWithOptions, returned by all calls.
+var initErr error
+
+// InitWithOptions initializes V8 with the specified platform options. Like
+// Init, only the first call has any effect. V8 is initialized even if an
+// error is returned, which only tells that the snapshot file couldn't be
+// loaded.
+func InitWithOptions(icuDataFile string, opts InitOptions) error {
 	//C.v8_Init(unsafe.Pointer(goCallbackHandler))
 	v8InitOnce.Do(func() {
-		C.initWithGoCallbackHanlder(C.CString(icuDataFile))
+		idleTasks := C.int(0)
+		if opts.IdleTasks {
+			idleTasks = 1
+		}
+		var snapshotFile *C.char
+		if opts.SnapshotFile != "" {
+			snapshotFile = C.CString(opts.SnapshotFile)
+		}
+		err := C.initWithGoCallbackHanlder(C.CString(icuDataFile), C.int(opts.ThreadPoolSize), idleTasks, snapshotFile)
+		if err.ptr != nil {
+			defer C.free(unsafe.Pointer(err.ptr))
+			initErr = fmt.Errorf("%s: %s", opts.SnapshotFile, C.GoStringN(err.ptr, err.len))
+		}
 		atomic.StoreInt32(&isInit, 1)
 	}) // defined in v8_go.h, implemented in v8_go.cc, references goCallbackHandler function implemented in this file.
+	return initErr
 }
 
 func IsInit() bool {
@@ -119,16 +186,21 @@ func IsInit() bool {
 
 // Snapshot contains the stored VM state that can be used to quickly recreate a
 // new VM at that particular state.
-type Snapshot struct{ data C.StartupData }
+type Snapshot struct {
+	data C.StartupData
+	// mapped snapshots point into a file mapping that lives for the rest of
+	// the process.
+	mapped bool
+}
 
 func newSnapshot(data C.StartupData) *Snapshot {
-	s := &Snapshot{data}
+	s := &Snapshot{data: data}
 	runtime.SetFinalizer(s, (*Snapshot).release)
 	return s
 }
 
 func (s *Snapshot) release() {
-	if s.data.ptr != nil {
+	if s.data.ptr != nil && !s.mapped {
 		//C.free(unsafe.Pointer(s.data.ptr))
 		C.v8_Free(unsafe.Pointer(s.data.ptr))
 	}
@@ -142,6 +214,39 @@ func (s *Snapshot) Export() []byte {
 	return []byte(C.GoStringN(s.data.ptr, s.data.len))
 }
 
+// WriteFile writes the snapshot to a file that can be loaded with
+// LoadSnapshotFile or InitOptions.SnapshotFile. The file is only valid for the
+// V8 version that wrote it.
+func (s *Snapshot) WriteFile(path string) error {
+	pathCstr := C.CString(path)
+	defer C.free(unsafe.Pointer(pathCstr))
+	err := C.v8_Snapshot_WriteFile(pathCstr, s.data)
+	runtime.KeepAlive(s)
+	if err.ptr != nil {
+		defer C.free(unsafe.Pointer(err.ptr))
+		return errors.New(C.GoStringN(err.ptr, err.len))
+	}
+	return nil
+}
+
+// LoadSnapshotFile loads a snapshot written by Snapshot.WriteFile. Unlike
+// RestoreSnapshotFromExport the data is not copied: the file is mapped
+// read-only once per process and shared by every isolate created from it.
+// The file must not be modified while the process is running.
+func LoadSnapshotFile(path string) (*Snapshot, error) {
+	if !IsInit() {
+		return nil, fmt.Errorf("V8 not init")
+	}
+	pathCstr := C.CString(path)
+	defer C.free(unsafe.Pointer(pathCstr))
+	var data C.StartupData
+	if err := C.v8_Snapshot_MapFile(pathCstr, &data); err.ptr != nil {
+		defer C.free(unsafe.Pointer(err.ptr))
+		return nil, fmt.Errorf("%s: %s", path, C.GoStringN(err.ptr, err.len))
+	}
+	return &Snapshot{data: data, mapped: true}, nil
+}
+
 // RestoreSnapshotFromExport creates a Snapshot from a byte slice that should
 // have previous come from Snapshot.Export().
 func RestoreSnapshotFromExport(data []byte) *Snapshot {
@@ -188,12 +293,98 @@ func CreateSnapshot(js string, includeCompiledFnCode bool, startupData *Snapshot
 
 }
 
+// CreateSnapshotWithContexts creates a new Snapshot that, in addition to the
+// default context, contains one context for each of the setup functions.
+// Each setup function is called with a fresh context that it can modify with
+// the usual Eval, Create, Set, etc. calls. The context passed to setups[i]
+// can later be recreated with Isolate.NewContextFromSnapshot(i) on an isolate
+// created from the returned snapshot.
+//
+// Go callbacks can only be part of the snapshot if they are bound with
+// Context.BindRegistered, since the callbacks themselves are not serialized:
+// the same names must be registered with RegisterCallback in every process
+// that uses the snapshot. Values obtained during setup must not be used
+// after the setup function returns.
+func CreateSnapshotWithContexts(includeCompiledFnCode bool, startupData *Snapshot, setups ...func(ctx *Context) error) (*Snapshot, error) {
+	if !IsInit() {
+		return nil, fmt.Errorf("V8 not init")
+	}
+
+	// The snapshot creator's isolate is entered on this thread until the
+	// snapshot is created.
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+
+	var creator C.SnapshotCreatorPtr
+	if startupData != nil {
+		creator = C.v8_SnapshotCreator_New(&startupData.data)
+	} else {
+		creator = C.v8_SnapshotCreator_New(nil)
+	}
+	// The isolate is owned by the creator, so it has no finalizer.
+	iso := &Isolate{ptr: C.v8_SnapshotCreator_Isolate(creator), s: startupData}
+
+	var setupErr error
+	contexts := make([]*Context, 0, len(setups))
+	for i, setup := range setups {
+		ctx := iso.newContext(func(id int) C.ContextPtr {
+			return C.v8_Isolate_NewContext(iso.ptr, C.int(id))
+		})
+		ctx.inSnapshotCreator = true
+		contexts = append(contexts, ctx)
+
+		if setupErr = setup(ctx); setupErr != nil {
+			setupErr = fmt.Errorf("snapshot context %d: %v", i, setupErr)
+			break
+		}
+		C.v8_SnapshotCreator_AddContext(creator, ctx.ptr)
+	}
+
+	// All handles to the contexts must be gone before the blob is created:
+	// those held by Go, then the contexts themselves.
+	for _, ctx := range contexts {
+		for _, release := range ctx.snapshotHandles {
+			release()
+		}
+		ctx.snapshotHandles = nil
+		ctx.release()
+	}
+
+	data := C.v8_SnapshotCreator_Create(creator, boolToInt(includeCompiledFnCode))
+	if setupErr != nil {
+		C.v8_Free(unsafe.Pointer(data.ptr))
+		return nil, setupErr
+	}
+	return newSnapshot(data), nil
+}
+
+func boolToInt(b bool) C.int {
+	if b {
+		return 1
+	}
+	return 0
+}
+
 // Isolate represents a single-threaded V8 engine instance.  It can run multiple
 // independent Contexts and V8 values can be freely shared between the Contexts,
 // however only one context will ever execute at a time.
 type Isolate struct {
 	ptr C.IsolatePtr
 	s   *Snapshot // make sure not to be advanced GC
+
+	pumpMutex sync.Mutex
+	pump      *messagePump
+
+	structTemplatesMutex sync.Mutex
+	structTemplates      map[reflect.Type]*structTemplate
+}
+
+// messagePump periodically runs the platform tasks of an isolate in the
+// background. It only references the isolate pointer so that it doesn't keep
+// the Isolate from being GC'd.
+type messagePump struct {
+	stop chan struct{}
+	done chan struct{}
 }
 
 // NewIsolate creates a new V8 Isolate.
@@ -221,27 +412,177 @@ func NewIsolateWithSnapshot(s *Snapshot) (*Isolate, error) {
 
 // NewContext creates a new, clean V8 Context within this Isolate.
 func (i *Isolate) NewContext() *Context {
-	ctx := &Context{
-		iso:       i,
-		ptr:       C.v8_Isolate_NewContext(i.ptr),
-		callbacks: map[int]callbackInfo{},
+	ctx := i.newContext(func(id int) C.ContextPtr {
+		return C.v8_Isolate_NewContext(i.ptr, C.int(id))
+	})
+	runtime.SetFinalizer(ctx, (*Context).release)
+	return ctx
+}
+
+// NewContextFromSnapshot creates a new Context from the context at the
+// specified index of the snapshot this isolate was created with (see
+// CreateSnapshotWithContexts), including any callbacks bound with
+// BindRegistered.
+func (i *Isolate) NewContextFromSnapshot(index int) (*Context, error) {
+	ctx := i.newContext(func(id int) C.ContextPtr {
+		return C.v8_Isolate_NewContextFromSnapshot(i.ptr, C.int(index), C.int(id))
+	})
+	if ctx.ptr == nil {
+		return nil, fmt.Errorf("no context #%d in snapshot", index)
 	}
+	runtime.SetFinalizer(ctx, (*Context).release)
+	return ctx, nil
+}
 
+func (i *Isolate) newContext(create func(id int) C.ContextPtr) *Context {
 	contextsMutex.Lock()
 	nextContextId++
-	ctx.id = nextContextId
+	id := nextContextId
 	contextsMutex.Unlock()
 
-	runtime.SetFinalizer(ctx, (*Context).release)
+	return &Context{
+		id:        id,
+		iso:       i,
+		ptr:       create(id),
+		callbacks: map[int]callbackInfo{},
+	}
+}
 
-	return ctx
+// SetGlobal sets a property of the global template that is shared by all
+// contexts created with NewContext or recycled with Context.Recycle after the
+// call. Building the global object from a cached template is cheaper than
+// setting the property on every new context. Only primitive values (nil,
+// bools, numbers and strings) are supported.
+func (i *Isolate) SetGlobal(name string, value interface{}) error {
+	var imm C.ImmediateValue
+	switch val := reflect.ValueOf(value); val.Kind() {
+	case reflect.Invalid:
+		imm.Type = C.tUNDEFINED
+	case reflect.Bool:
+		imm.Type = C.tBOOL
+		if val.Bool() {
+			imm.Bool = 1
+		}
+	case reflect.Int, reflect.Int8, reflect.Int16, reflect.Int32, reflect.Int64,
+		reflect.Uint, reflect.Uint8, reflect.Uint16, reflect.Uint32, reflect.Uint64,
+		reflect.Float32, reflect.Float64:
+		imm.Type = C.tFLOAT64
+		imm.Float64 = C.double(val.Convert(float64Type).Float())
+	case reflect.String:
+		gostr := val.String()
+		imm.Type = C.tSTRING
+		imm.Mem = C.ByteArray{ptr: C.CString(gostr), len: C.int(len(gostr))}
+		defer C.free(unsafe.Pointer(imm.Mem.ptr))
+	default:
+		return fmt.Errorf("Global template values must be primitive, got %T", value)
+	}
+
+	nameStr := C.CString(name)
+	defer C.free(unsafe.Pointer(nameStr))
+	if err := C.v8_Isolate_SetGlobalValue(i.ptr, nameStr, imm); err.ptr != nil {
+		defer C.free(unsafe.Pointer(err.ptr))
+		return errors.New(C.GoStringN(err.ptr, err.len))
+	}
+	return nil
+}
+
+// BindGlobal adds a function to the global template (see SetGlobal) that
+// calls the callback registered as registeredName with RegisterCallback.
+func (i *Isolate) BindGlobal(name, registeredName string) error {
+	registeredCallbacksMutex.RLock()
+	_, ok := registeredCallbacks[registeredName]
+	registeredCallbacksMutex.RUnlock()
+	if !ok {
+		return fmt.Errorf("No callback registered as %q", registeredName)
+	}
+
+	nameStr := C.CString(name)
+	defer C.free(unsafe.Pointer(nameStr))
+	cbIdStr := C.CString("@" + registeredName)
+	defer C.free(unsafe.Pointer(cbIdStr))
+	C.v8_Isolate_SetGlobalCallback(i.ptr, nameStr, cbIdStr)
+	return nil
 }
 
 // Terminate will interrupt all operation in this Isolate, interrupting any
 // Contexts that are executing.  This may be called from any goroutine at any
 // time.
 func (i *Isolate) Terminate() { C.v8_Isolate_Terminate(i.ptr) }
+
+// PumpMessageLoop runs the foreground tasks that V8 has posted for this
+// isolate, such as finalizing concurrently compiled functions or GC steps,
+// and returns true if any task was run. If idle tasks were enabled in
+// InitWithOptions, they are given idleTime to run as well.
+//
+// V8 never runs these tasks on its own, so embedders that don't use
+// StartMessagePump should call this regularly, e.g. between requests.
+func (i *Isolate) PumpMessageLoop(idleTime time.Duration) bool {
+	return C.v8_Isolate_PumpMessageLoop(i.ptr, C.double(idleTime.Seconds())) > 0
+}
+
+// defaultMessagePumpInterval is the interval of StartMessagePump if it is
+// given none.
+const defaultMessagePumpInterval = 10 * time.Millisecond
+
+// StartMessagePump starts a goroutine that calls PumpMessageLoop every
+// interval until StopMessagePump is called or the isolate is released. Each
+// pump competes for the isolate lock with the other operations on this
+// isolate, so the interval should not be too small; if it is not positive,
+// 10ms is used. Calling StartMessagePump on an isolate that already has a
+// running pump restarts it with the new interval.
+func (i *Isolate) StartMessagePump(interval time.Duration, idleTime time.Duration) {
+	if interval <= 0 {
+		interval = defaultMessagePumpInterval
+	}
+
+	// The mutex is held from stopping the old pump until the new one is
+	// registered, so that concurrent calls can't leave two pumps running.
+	i.pumpMutex.Lock()
+	defer i.pumpMutex.Unlock()
+	i.stopMessagePumpLocked()
+	if i.ptr == nil {
+		return
+	}
+
+	pump := &messagePump{make(chan struct{}), make(chan struct{})}
+	ptr := i.ptr
+	go func() {
+		defer close(pump.done)
+		ticker := time.NewTicker(interval)
+		defer ticker.Stop()
+		for {
+			select {
+			case <-pump.stop:
+				return
+			case <-ticker.C:
+				C.v8_Isolate_PumpMessageLoop(ptr, C.double(idleTime.Seconds()))
+			}
+		}
+	}()
+	i.pump = pump
+}
+
+// StopMessagePump stops the background pump started by StartMessagePump and
+// waits until it is no longer running. It is a no-op if no pump is running.
+func (i *Isolate) StopMessagePump() {
+	i.pumpMutex.Lock()
+	i.stopMessagePumpLocked()
+	i.pumpMutex.Unlock()
+}
+
+// stopMessagePumpLocked is StopMessagePump with pumpMutex held. The pump
+// doesn't take the mutex, so waiting for it with the mutex held is fine.
+func (i *Isolate) stopMessagePumpLocked() {
+	if pump := i.pump; pump != nil {
+		i.pump = nil
+		close(pump.stop)
+		<-pump.done
+	}
+}
+
 func (i *Isolate) release() {
+	// The pump must be gone before the isolate is disposed.
+	i.StopMessagePump()
 	C.v8_Isolate_Release(i.ptr)
 	i.ptr = nil
 	runtime.SetFinalizer(i, nil)
@@ -265,16 +606,61 @@ type Context struct {
 	id  int
 	iso *Isolate
 	ptr C.ContextPtr
+	// releaseMutex is held for writing while release frees ptr and clears
+	// it. Code that frees resources of the context and can run concurrently
+	// with Release, such as finalizers, holds it for reading and re-checks
+	// ptr, so that it never passes a context that has been freed.
+	releaseMutex sync.RWMutex
 
 	callbacks      map[int]callbackInfo
 	nextCallbackId int
+
+	moduleResolver ModuleResolver
+
+	// Contexts of a snapshot creator are discarded along with their isolate,
+	// so neither they nor their values have finalizers. Instead the handles
+	// created during setup are released before the blob is created, since
+	// the snapshot creator checks that none are left.
+	inSnapshotCreator bool
+	snapshotHandles   []func()
+
+	// The innermost scope, which owns the values created in the context.
+	scope *Scope
+
+	// The native console, see InjectConsole.
+	console *Console
+}
+
+// errContextReleased is returned by calls on a released context that don't
+// reach the bridge, which returns the same message.
+var errContextReleased = errors.New("Context has been released")
+
+// releasedContext is the context of released values. Its ptr is nil, so their
+// methods fail with the released context error instead of dereferencing nil.
+var releasedContext = &Context{id: -1, iso: &Isolate{}}
+
+// checkReleased fails if one of the values, whose handles are passed to the
+// bridge, has been released on its own or along with its context. nil values
+// are skipped.
+func checkReleased(values ...*Value) error {
+	for _, v := range values {
+		if v != nil && (v.ptr == nil || v.ctx.ptr == nil) {
+			return errContextReleased
+		}
+	}
+	return nil
 }
+
 type callbackInfo struct {
 	Callback
-	name string
+	name       string
+	lazyCaller bool
 }
 
 func (ctx *Context) split(ret C.ValueTuple) (*Value, error) {
+	if ret.exception != nil {
+		return nil, ctx.newJSError(ret.exception)
+	}
 	return ctx.newValue(ret.Value, ret.Kinds), ctx.iso.convertErrorMsg(ret.error_msg)
 }
 
@@ -288,6 +674,7 @@ func (ctx *Context) Eval(jsCode, filename string) (*Value, error) {
 	decRef(ctx)
 	C.free(unsafe.Pointer(js_code_cstr))
 	C.free(unsafe.Pointer(filename_cstr))
+	ctx.flushConsole()
 	return ctx.split(ret)
 }
 
@@ -310,29 +697,118 @@ func (ctx *Context) Eval(jsCode, filename string) (*Value, error) {
 // more memory each time. Normally this isn't a problem, but many many Bind's
 // on a Context can gradually consume memory.
 func (ctx *Context) Bind(name string, cb Callback) *Value {
+	return ctx.bind(name, callbackInfo{Callback: cb, name: name}, true)
+}
+
+// BindOptions configure BindWithOptions.
+type BindOptions struct {
+	// CaptureCaller lets the callback look up its caller with
+	// CallbackArgs.CallerLoc.
+	CaptureCaller bool
+}
+
+// BindWithOptions is like Bind, but the function doesn't fill in
+// CallbackArgs.Caller. Bind walks the script's stack on every call to do so,
+// which is a large part of the cost of a short callback; most callbacks don't
+// need the caller, and those that do can look it up when they need it with
+// CaptureCaller.
+func (ctx *Context) BindWithOptions(name string, cb Callback, opts BindOptions) *Value {
+	return ctx.bind(name, callbackInfo{Callback: cb, name: name, lazyCaller: opts.CaptureCaller}, false)
+}
+
+func (ctx *Context) bind(name string, info callbackInfo, captureCaller bool) *Value {
 	ctx.nextCallbackId++
 	id := ctx.nextCallbackId
-	ctx.callbacks[id] = callbackInfo{cb, name}
+	ctx.callbacks[id] = info
 	cbIdStr := C.CString(fmt.Sprintf("%d:%d", ctx.id, id))
 	defer C.free(unsafe.Pointer(cbIdStr))
 	nameStr := C.CString(name)
 	defer C.free(unsafe.Pointer(nameStr))
 	return ctx.newValue(
-		C.v8_Context_RegisterCallback(ctx.ptr, nameStr, cbIdStr),
+		C.v8_Context_RegisterCallback(ctx.ptr, nameStr, cbIdStr, boolToInt(captureCaller)),
 		unionKindFunction,
 	)
 }
 
+// BindRegistered creates a V8 function value that calls the callback that is
+// registered under name with RegisterCallback. Unlike functions created by
+// Bind, these functions survive being serialized into a snapshot, see
+// CreateSnapshotWithContexts. The callback is looked up when the function is
+// called.
+func (ctx *Context) BindRegistered(name string) (*Value, error) {
+	registeredCallbacksMutex.RLock()
+	_, ok := registeredCallbacks[name]
+	registeredCallbacksMutex.RUnlock()
+	if !ok {
+		return nil, fmt.Errorf("No callback registered as %q", name)
+	}
+
+	cbIdStr := C.CString("@" + name)
+	defer C.free(unsafe.Pointer(cbIdStr))
+	nameStr := C.CString(name)
+	defer C.free(unsafe.Pointer(nameStr))
+	return ctx.newValue(
+		C.v8_Context_RegisterCallback(ctx.ptr, nameStr, cbIdStr, 1),
+		unionKindFunction,
+	), nil
+}
+
 // Global returns the JS global object for this context, with properties like
 // Object, Array, JSON, etc.
 func (ctx *Context) Global() *Value {
 	return ctx.newValue(C.v8_Context_Global(ctx.ptr), C.KindMask(KindObject))
 }
+
+// Recycle replaces the context's state with a fresh global built from the
+// isolate's global template, which is much cheaper than releasing the context
+// and creating a new one. Values obtained before the call stay valid but
+// refer to the old global's objects, and functions created with Bind stop
+// working; functions created with BindRegistered or BindGlobal keep working.
+// Contexts created from a snapshot are recycled into plain contexts, and a
+// console set up with InjectConsole has to be injected again. Recycling a
+// released context fails.
+func (ctx *Context) Recycle() error {
+	ctx.flushConsole()
+	ctx.releaseMutex.RLock()
+	errmsg := C.v8_Context_Recycle(ctx.ptr)
+	ctx.releaseMutex.RUnlock()
+	if errmsg.ptr == nil {
+		// Keep nextCallbackId so that stale functions can't call new callbacks.
+		ctx.callbacks = map[int]callbackInfo{}
+	}
+	return ctx.iso.convertErrorMsg(errmsg)
+}
+
+// Release frees the context immediately instead of waiting for the garbage
+// collector, along with all of its values that haven't been released yet. The
+// context and its values must not be used afterwards; if they are, calls fail
+// with an error or return zero values.
+func (ctx *Context) Release() {
+	ctx.release()
+}
+
+// Isolate returns the isolate of the context, or nil once the context has been
+// released.
+func (ctx *Context) Isolate() *Isolate {
+	return ctx.iso
+}
+
+// LiveValues returns the number of values of the context that are still held
+// by Go, i.e. that haven't been released or garbage collected yet. A number
+// that keeps growing in a long-lived context points to a leak.
+func (ctx *Context) LiveValues() int {
+	return int(C.v8_Context_LiveValues(ctx.ptr))
+}
+
 func (ctx *Context) release() {
+	ctx.flushConsole()
+	ctx.console = nil
+	ctx.releaseMutex.Lock()
 	if ctx.ptr != nil {
 		C.v8_Context_Release(ctx.ptr)
 	}
 	ctx.ptr = nil
+	ctx.releaseMutex.Unlock()
 
 	contextsMutex.Lock()
 	delete(contexts, ctx.id)
@@ -344,14 +820,24 @@ func (ctx *Context) release() {
 
 // Terminate will interrupt any processing going on in the context.  This may
 // be called from any goroutine.
-func (ctx *Context) Terminate() { ctx.iso.Terminate() }
+func (ctx *Context) Terminate() {
+	if iso := ctx.iso; iso != nil {
+		iso.Terminate()
+	}
+}
 func (ctx *Context) newValue(ptr C.PersistentValuePtr, kinds C.KindMask) *Value {
 	if ptr == nil {
 		return nil
 	}
 
-	val := &Value{ctx, ptr, kindMask(kinds)}
-	runtime.SetFinalizer(val, (*Value).release)
+	val := &Value{ctx: ctx, ptr: ptr, kindMask: kindMask(kinds)}
+	if ctx.scope != nil {
+		ctx.scope.add(val)
+	} else if ctx.inSnapshotCreator {
+		ctx.snapshotHandles = append(ctx.snapshotHandles, val.release)
+	} else {
+		runtime.SetFinalizer(val, (*Value).release)
+	}
 	return val
 }
 
@@ -378,6 +864,10 @@ type Value struct {
 	ctx      *Context
 	ptr      C.PersistentValuePtr
 	kindMask kindMask
+
+	// The scope owning the value, and its index in the scope.
+	scope *Scope
+	slot  int
 }
 
 // Bytes returns a byte slice extracted from this value when the value
@@ -401,12 +891,28 @@ func (v *Value) Float64() float64 {
 	return float64(C.v8_Value_Float64(v.ctx.ptr, v.ptr))
 }
 
-// Int64 returns this Value as an int64. If this value is not a number,
-// then 0 will be returned.
+// Int64 returns this Value as an int64. If this value is not a number or a
+// BigInt, then 0 will be returned.
 func (v *Value) Int64() int64 {
 	return int64(C.v8_Value_Int64(v.ctx.ptr, v.ptr))
 }
 
+// BigInt64 returns this BigInt, or number that is an integer, as an int64.
+// lossless is false if the value doesn't fit, in which case it is truncated,
+// or if it isn't an integer.
+func (v *Value) BigInt64() (i int64, lossless bool) {
+	var ok C.int
+	i = int64(C.v8_Value_BigInt64(v.ctx.ptr, v.ptr, &ok))
+	return i, ok == 1
+}
+
+// BigUint64 is like BigInt64 for a uint64.
+func (v *Value) BigUint64() (u uint64, lossless bool) {
+	var ok C.int
+	u = uint64(C.v8_Value_BigUint64(v.ctx.ptr, v.ptr, &ok))
+	return u, ok == 1
+}
+
 // Bool returns this Value as a boolean. If the underlying value is not a
 // boolean, it will be coerced to a boolean using Javascript's coercion rules.
 func (v *Value) Bool() bool {
@@ -454,7 +960,10 @@ func (v *Value) String() string {
 // Get a field from the object.  If this value is not an object, this will fail.
 func (v *Value) Get(name string) (*Value, error) {
 	name_cstr := C.CString(name)
+	// Getters may call back into Go, e.g. those of wrapped structs.
+	addRef(v.ctx)
 	ret := C.v8_Value_Get(v.ctx.ptr, v.ptr, name_cstr)
+	decRef(v.ctx)
 	C.free(unsafe.Pointer(name_cstr))
 	return v.ctx.split(ret)
 }
@@ -462,14 +971,23 @@ func (v *Value) Get(name string) (*Value, error) {
 // Get the value at the specified index.  If this value is not an object or an
 // array, this will fail.
 func (v *Value) GetIndex(idx int) (*Value, error) {
-	return v.ctx.split(C.v8_Value_GetIdx(v.ctx.ptr, v.ptr, C.int(idx)))
+	// Getters and interceptors may call back into Go.
+	addRef(v.ctx)
+	ret := C.v8_Value_GetIdx(v.ctx.ptr, v.ptr, C.int(idx))
+	decRef(v.ctx)
+	return v.ctx.split(ret)
 }
 
 // Set a field on the object.  If this value is not an object, this
 // will fail.
 func (v *Value) Set(name string, value *Value) error {
+	if err := checkReleased(value); err != nil {
+		return err
+	}
 	name_cstr := C.CString(name)
+	addRef(v.ctx)
 	errmsg := C.v8_Value_Set(v.ctx.ptr, v.ptr, name_cstr, value.ptr)
+	decRef(v.ctx)
 	C.free(unsafe.Pointer(name_cstr))
 	return v.ctx.iso.convertErrorMsg(errmsg)
 }
@@ -477,13 +995,23 @@ func (v *Value) Set(name string, value *Value) error {
 // SetIndex sets the object's value at the specified index.  If this value is
 // not an object or an array, this will fail.
 func (v *Value) SetIndex(idx int, value *Value) error {
-	return v.ctx.iso.convertErrorMsg(
-		C.v8_Value_SetIdx(v.ctx.ptr, v.ptr, C.int(idx), value.ptr))
+	if err := checkReleased(value); err != nil {
+		return err
+	}
+	addRef(v.ctx)
+	errmsg := C.v8_Value_SetIdx(v.ctx.ptr, v.ptr, C.int(idx), value.ptr)
+	decRef(v.ctx)
+	return v.ctx.iso.convertErrorMsg(errmsg)
 }
 
 // Call this value as a function.  If this value is not a function, this will
 // fail.
 func (v *Value) Call(this *Value, args ...*Value) (*Value, error) {
+	if err := checkReleased(this); err != nil {
+		return nil, err
+	} else if err := checkReleased(args...); err != nil {
+		return nil, err
+	}
 	// always allocate at least one so &argPtrs[0] works.
 	argPtrs := make([]C.PersistentValuePtr, len(args)+1)
 	for i := range args {
@@ -508,6 +1036,9 @@ func (v *Value) IsKind(k Kind) bool {
 // New creates a new instance of an object using this value as its constructor.
 // If this value is not a function, this will fail.
 func (v *Value) New(args ...*Value) (*Value, error) {
+	if err := checkReleased(args...); err != nil {
+		return nil, err
+	}
 	// always allocate at least one so &argPtrs[0] works.
 	argPtrs := make([]C.PersistentValuePtr, len(args)+1)
 	for i := range args {
@@ -519,41 +1050,88 @@ func (v *Value) New(args ...*Value) (*Value, error) {
 	return v.ctx.split(result)
 }
 
-// GetObjKeys calls Object.keys() on the object and returns
-// the keys as a Go slice
+// GetObjKeys returns the keys of the object like Object.keys(), i.e. its
+// own enumerable string keys.
 func (value *Value) GetObjKeys() ([]string, error) {
 
 	if value == nil {
 		return nil, nil
 	}
 
-	obj, err := value.ctx.Global().Get("Object")
-	if err != nil {
-		return nil, err
-	}
-
-	keysFn, err := obj.Get("keys")
-	if err != nil {
-		return nil, err
-	}
+	return value.GetOwnPropertyNames(PropertiesEnumerableOnly)
+}
 
-	keysVal, err := keysFn.Call(value.ctx.Global(), value)
-	if err != nil {
-		return nil, err
-	}
+// PropertyFlags select the properties returned by GetOwnPropertyNames and
+// GetOwnProperties.
+type PropertyFlags int
 
-	var keys []string
-	err = ReadInto(&keys, keysVal, 1)
+const (
+	// PropertiesEnumerableOnly skips non-enumerable properties.
+	PropertiesEnumerableOnly PropertyFlags = C.kPropertiesEnumerableOnly
+	// PropertiesIncludeSymbols includes symbol keys, which are returned as
+	// "Symbol(description)".
+	PropertiesIncludeSymbols PropertyFlags = C.kPropertiesIncludeSymbols
+)
 
+// GetOwnPropertyNames returns the keys of the object's own properties in a
+// single call. Integer keys are returned as strings.
+func (v *Value) GetOwnPropertyNames(flags PropertyFlags) ([]string, error) {
+	keys, _, err := v.getOwnProperties(int(flags))
 	return keys, err
+}
 
+// GetOwnProperties returns the keys of the object's own properties along with
+// their values, all in a single call.
+func (v *Value) GetOwnProperties(flags PropertyFlags) ([]string, []*Value, error) {
+	return v.getOwnProperties(int(flags) | C.kPropertiesWithValues)
+}
+
+func (v *Value) getOwnProperties(flags int) ([]string, []*Value, error) {
+	addRef(v.ctx)
+	props := C.v8_Value_GetOwnProperties(v.ctx.ptr, v.ptr, C.int(flags))
+	decRef(v.ctx)
+	if err := v.ctx.iso.convertErrorMsg(props.error_msg); err != nil {
+		return nil, nil, err
+	}
+	defer C.free(unsafe.Pointer(props.Keys))
+	defer C.free(unsafe.Pointer(props.Offsets))
+
+	n := int(props.Length)
+	offsets := (*[1 << 30]C.int)(unsafe.Pointer(props.Offsets))[: n+1 : n+1]
+	all := C.GoStringN(props.Keys, offsets[n])
+	keys := make([]string, n)
+	for i := range keys {
+		keys[i] = all[offsets[i]:offsets[i+1]]
+	}
+
+	if props.Values == nil {
+		return keys, nil, nil
+	}
+	defer C.free(unsafe.Pointer(props.Values))
+	values := make([]*Value, n)
+	if n > 0 {
+		tuples := (*[1 << 30]C.ValueTuple)(unsafe.Pointer(props.Values))[:n:n]
+		for i, t := range tuples {
+			values[i] = v.ctx.newValue(t.Value, t.Kinds)
+		}
+	}
+	return keys, values, nil
 }
 
 func (v *Value) release() {
+	if v.scope != nil {
+		v.scope.forget(v)
+	}
 	if v.ptr != nil {
-		C.v8_Value_Release(v.ctx.ptr, v.ptr)
+		// Values of a released context were released along with it.
+		ctx := v.ctx
+		ctx.releaseMutex.RLock()
+		if ctx.ptr != nil {
+			C.v8_Value_Release(ctx.ptr, v.ptr)
+		}
+		ctx.releaseMutex.RUnlock()
 	}
-	v.ctx = nil
+	v.ctx = releasedContext
 	v.ptr = nil
 	runtime.SetFinalizer(v, nil)
 }
@@ -602,6 +1180,21 @@ func (v *Value) MarshalJSON() ([]byte, error) {
 // we call into V8 and remove when we're done. Specifically, we'll use a ref
 // count just in case somebody gets cute and calls back into V8 from a callback.
 //
+// Callbacks that are bound by name (see BindRegistered) are looked up in a
+// process-wide registry, since functions restored from a snapshot only carry
+// the name of their callback.
+var registeredCallbacks = map[string]Callback{}
+var registeredCallbacksMutex sync.RWMutex
+
+// RegisterCallback registers cb under name so that it can be bound with
+// Context.BindRegistered. Registering a name again replaces the callback
+// for all functions bound to that name.
+func RegisterCallback(name string, cb Callback) {
+	registeredCallbacksMutex.Lock()
+	registeredCallbacks[name] = cb
+	registeredCallbacksMutex.Unlock()
+}
+
 var contexts = map[int]*refCount{}
 var contextsMutex sync.RWMutex
 var nextContextId int
@@ -649,7 +1242,6 @@ func goCallbackHandler(
 	cbId := C.GoStringN(cbIdStr.ptr, cbIdStr.len)
 	parts := strings.SplitN(cbId, ":", 2)
 	ctxId, _ := strconv.Atoi(parts[0])
-	callbackId, _ := strconv.Atoi(parts[1])
 
 	contextsMutex.RLock()
 	ref := contexts[ctxId]
@@ -660,10 +1252,22 @@ func goCallbackHandler(
 	ctx := ref.ptr
 	contextsMutex.RUnlock()
 
-	info := ctx.callbacks[int(callbackId)]
+	var info callbackInfo
+	if strings.HasPrefix(parts[1], "@") {
+		name := parts[1][1:]
+		registeredCallbacksMutex.RLock()
+		info = callbackInfo{Callback: registeredCallbacks[name], name: name}
+		registeredCallbacksMutex.RUnlock()
+	} else if strings.HasPrefix(parts[1], "#") {
+		info = wrappedMethod(parts[1][1:])
+	} else {
+		callbackId, _ := strconv.Atoi(parts[1])
+		info = ctx.callbacks[callbackId]
+	}
 	if info.Callback == nil {
-		// Everything is bad -- this should never happen.
-		panic(fmt.Errorf("No such registered callback: %s", info.name))
+		// Functions bound before the context was recycled end up here.
+		errmsg := fmt.Sprintf("No such callback: %s", parts[1])
+		return C.ValueTuple{error_msg: C.Error{ptr: C.CString(errmsg), len: C.int(len(errmsg))}}
 	}
 
 	// Convert array of args into a slice.  See:
@@ -687,20 +1291,29 @@ func goCallbackHandler(
 		}
 	}()
 
-	res, err := info.Callback(CallbackArgs{caller_loc, args, ctx})
+	res, err := info.Callback(CallbackArgs{
+		Caller:     caller_loc,
+		Args:       args,
+		Context:    ctx,
+		lazyCaller: info.lazyCaller,
+	})
 
 	if err != nil {
 		errmsg := err.Error()
 		e := C.Error{ptr: C.CString(errmsg), len: C.int(len(errmsg))}
-		return C.ValueTuple{nil, 0, e}
+		return C.ValueTuple{error_msg: e}
 	}
 
 	if res == nil {
 		return C.ValueTuple{}
-	} else if res.ctx.iso.ptr != ctx.iso.ptr {
+	} else if res.ptr == nil {
+		errmsg := fmt.Sprintf("Callback %s returned a released value.", info.name)
+		e := C.Error{ptr: C.CString(errmsg), len: C.int(len(errmsg))}
+		return C.ValueTuple{error_msg: e}
+	} else if res.ctx.iso != ctx.iso {
 		errmsg := fmt.Sprintf("Callback %s returned a value from another isolate.", info.name)
 		e := C.Error{ptr: C.CString(errmsg), len: C.int(len(errmsg))}
-		return C.ValueTuple{nil, 0, e}
+		return C.ValueTuple{error_msg: e}
 	}
 
 	return C.ValueTuple{Value: res.ptr}
@@ -742,3 +1355,9 @@ func (i *Isolate) GetHeapStatistics() HeapStatistics {
 func (i *Isolate) SendLowMemoryNotification() {
 	C.v8_Isolate_LowMemoryNotification(i.ptr)
 }
+
+// LiveValues returns the number of values of all contexts of the isolate that
+// are still held by Go, see Context.LiveValues.
+func (i *Isolate) LiveValues() int {
+	return int(C.v8_Isolate_LiveValues(i.ptr))
+}
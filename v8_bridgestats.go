@@ -0,0 +1,185 @@
+package v8
+
+// #include <stdlib.h>
+// #include "v8_c_bridge.h"
+import "C"
+
+import "time"
+
+// NOTE! These names must be in the order of the BridgeEntry enum in
+// v8_c_bridge.h.
+var bridgeEntryNames = [C.kNumBridgeEntries]string{
+	C.kStatIsolateNewContext:             "v8_Isolate_NewContext",
+	C.kStatIsolateNewContextFromSnapshot: "v8_Isolate_NewContextFromSnapshot",
+	C.kStatIsolateSetGlobalValue:         "v8_Isolate_SetGlobalValue",
+	C.kStatIsolateSetGlobalCallback:      "v8_Isolate_SetGlobalCallback",
+	C.kStatIsolateNewStructTemplate:      "v8_Isolate_NewStructTemplate",
+	C.kStatIsolateGetHeapStatistics:      "v8_Isolate_GetHeapStatistics",
+	C.kStatIsolateLowMemoryNotification:  "v8_Isolate_LowMemoryNotification",
+	C.kStatIsolatePumpMessageLoop:        "v8_Isolate_PumpMessageLoop",
+	C.kStatIsolateGetModuleCacheStats:    "v8_Isolate_GetModuleCacheStats",
+	C.kStatIsolateClearModuleCache:       "v8_Isolate_ClearModuleCache",
+	C.kStatIsolateTerminate:              "v8_Isolate_Terminate",
+	C.kStatIsolateLiveValues:             "v8_Isolate_LiveValues",
+	C.kStatIsolateCurrentCaller:          "v8_Isolate_CurrentCaller",
+	C.kStatSnapshotCreatorAddContext:     "v8_SnapshotCreator_AddContext",
+	C.kStatContextRun:                    "v8_Context_Run",
+	C.kStatContextEvalModule:             "v8_Context_EvalModule",
+	C.kStatContextStartStreaming:         "v8_Context_StartStreaming",
+	C.kStatScriptStreamPush:              "v8_ScriptStream_Push",
+	C.kStatScriptStreamClose:             "v8_ScriptStream_Close",
+	C.kStatScriptStreamRun:               "v8_ScriptStream_Run",
+	C.kStatScriptStreamCompile:           "v8_ScriptStream_Compile",
+	C.kStatScriptStreamRelease:           "v8_ScriptStream_Release",
+	C.kStatScriptRun:                     "v8_Script_Run",
+	C.kStatScriptRelease:                 "v8_Script_Release",
+	C.kStatContextCompileWasm:            "v8_Context_CompileWasm",
+	C.kStatContextInstantiateWasm:        "v8_Context_InstantiateWasm",
+	C.kStatContextRegisterCallback:       "v8_Context_RegisterCallback",
+	C.kStatContextWrap:                   "v8_Context_Wrap",
+	C.kStatContextNewInterceptedObject:   "v8_Context_NewInterceptedObject",
+	C.kStatContextGlobal:                 "v8_Context_Global",
+	C.kStatContextRelease:                "v8_Context_Release",
+	C.kStatContextRecycle:                "v8_Context_Recycle",
+	C.kStatContextCreate:                 "v8_Context_Create",
+	C.kStatContextCreateTypedArray:       "v8_Context_CreateTypedArray",
+	C.kStatContextCreateExternalString:   "v8_Context_CreateExternalString",
+	C.kStatContextInjectConsole:          "v8_Context_InjectConsole",
+	C.kStatContextReadConsole:            "v8_Context_ReadConsole",
+	C.kStatContextConsoleStats:           "v8_Context_ConsoleStats",
+	C.kStatContextLiveValues:             "v8_Context_LiveValues",
+	C.kStatValueGetOwnProperties:         "v8_Value_GetOwnProperties",
+	C.kStatValueGet:                      "v8_Value_Get",
+	C.kStatValueSet:                      "v8_Value_Set",
+	C.kStatValueGetIdx:                   "v8_Value_GetIdx",
+	C.kStatValueSetIdx:                   "v8_Value_SetIdx",
+	C.kStatValueGetRange:                 "v8_Value_GetRange",
+	C.kStatValueSetRange:                 "v8_Value_SetRange",
+	C.kStatValueCall:                     "v8_Value_Call",
+	C.kStatValueNew:                      "v8_Value_New",
+	C.kStatContextPrepareCall:            "v8_Context_PrepareCall",
+	C.kStatPreparedCallCall:              "v8_PreparedCall_Call",
+	C.kStatPreparedCallRelease:           "v8_PreparedCall_Release",
+	C.kStatValueRelease:                  "v8_Value_Release",
+	C.kStatValueReleaseAll:               "v8_Value_ReleaseAll",
+	C.kStatValueString:                   "v8_Value_String",
+	C.kStatValueFloat64:                  "v8_Value_Float64",
+	C.kStatValueInt64:                    "v8_Value_Int64",
+	C.kStatValueBool:                     "v8_Value_Bool",
+	C.kStatValueBigInt64:                 "v8_Value_BigInt64",
+	C.kStatValueBigUint64:                "v8_Value_BigUint64",
+	C.kStatValueBytes:                    "v8_Value_Bytes",
+	C.kStatValuePromiseInfo:              "v8_Value_PromiseInfo",
+	C.kStatGoCallback:                    "go_callback",
+	C.kStatGoAccessor:                    "go_accessor",
+	C.kStatGoInterceptor:                 "go_interceptor",
+	C.kStatGoConsoleFlush:                "go_console_flush",
+}
+
+// BridgeHistogramBuckets is the number of buckets of a latency histogram, see
+// BridgeCallStats.
+const BridgeHistogramBuckets = C.kBridgeHistogramBuckets
+
+// BridgeStats are the statistics of the calls between Go and an isolate, see
+// Isolate.EnableBridgeStats.
+type BridgeStats struct {
+	Enabled bool
+	// HandlesCreated and HandlesReleased count the handles of values that
+	// were returned to Go and released again, e.g. by Value finalizers.
+	HandlesCreated, HandlesReleased uint64
+	// Calls holds the statistics of each function of the C bridge that has
+	// been called, by name. "go_callback", "go_accessor", "go_interceptor"
+	// and "go_console_flush" are the calls from scripts into Go functions,
+	// wrapped structs, intercepted objects and native consoles.
+	Calls map[string]BridgeCallStats
+}
+
+// BridgeCallStats are the statistics of a function of the C bridge.
+type BridgeCallStats struct {
+	Calls uint64
+	// Total is the time spent in the calls, including waiting for the isolate
+	// lock and nested calls, such as Go callbacks made by a script.
+	Total time.Duration
+	// Bytes counts the bytes of strings, buffers and arrays copied between
+	// Go and V8.
+	Bytes uint64
+	// Histogram[i] counts the calls that took less than
+	// BridgeHistogramBound(i), and at least BridgeHistogramBound(i-1).
+	Histogram [BridgeHistogramBuckets]uint64
+}
+
+// BridgeHistogramBound returns the upper bound of bucket i of a latency
+// histogram. The last bucket also counts longer calls.
+func BridgeHistogramBound(i int) time.Duration {
+	return time.Duration(1) << uint(i+1)
+}
+
+// Mean returns the average duration of a call.
+func (s BridgeCallStats) Mean() time.Duration {
+	if s.Calls == 0 {
+		return 0
+	}
+	return s.Total / time.Duration(s.Calls)
+}
+
+// Percentile returns the upper bound of the histogram bucket that contains
+// the given percentile (0-100) of the calls.
+func (s BridgeCallStats) Percentile(p float64) time.Duration {
+	var total uint64
+	for _, n := range s.Histogram {
+		total += n
+	}
+	if total == 0 {
+		return 0
+	}
+	target := uint64(float64(total) * p / 100)
+	var seen uint64
+	for i, n := range s.Histogram {
+		seen += n
+		if seen > target || seen == total {
+			return BridgeHistogramBound(i)
+		}
+	}
+	return BridgeHistogramBound(BridgeHistogramBuckets - 1)
+}
+
+// EnableBridgeStats switches the collection of bridge statistics for the
+// isolate on or off; it is off by default. Collecting them costs tens of
+// nanoseconds per call. Statistics collected earlier are kept while it is
+// off.
+func (i *Isolate) EnableBridgeStats(enabled bool) {
+	var e C.int
+	if enabled {
+		e = 1
+	}
+	C.v8_Isolate_SetBridgeStats(i.ptr, e)
+}
+
+// BridgeStats returns a snapshot of the isolate's bridge statistics, which
+// are cumulative over the lifetime of the isolate.
+func (i *Isolate) BridgeStats() BridgeStats {
+	var out C.BridgeStats
+	C.v8_Isolate_GetBridgeStats(i.ptr, &out)
+
+	stats := BridgeStats{
+		Enabled:         out.Enabled != 0,
+		HandlesCreated:  uint64(out.HandlesCreated),
+		HandlesReleased: uint64(out.HandlesReleased),
+		Calls:           map[string]BridgeCallStats{},
+	}
+	for n, entry := range out.Entries {
+		if entry.Calls == 0 {
+			continue
+		}
+		call := BridgeCallStats{
+			Calls: uint64(entry.Calls),
+			Total: time.Duration(entry.Nanos),
+			Bytes: uint64(entry.Bytes),
+		}
+		for b, count := range entry.Histogram {
+			call.Histogram[b] = uint64(count)
+		}
+		stats.Calls[bridgeEntryNames[n]] = call
+	}
+	return stats
+}
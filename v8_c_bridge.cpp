@@ -8,20 +8,39 @@
 //TODO: check all places where ToLocalChecked() is present without real checks
 
 #include "pch.h"
+#ifdef _WIN32
 #include "framework.h"
-#include "v8_c_bridge.h"
 #include "resource.h"
+#endif
+#include "v8_c_bridge.h"
 
 #include "libplatform/libplatform.h"
 #include "v8.h"
 
+#include <algorithm>
+#include <climits>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <string>
 #include <sstream>
 #include <stdio.h>
 #include <iostream>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <map>
+#include <set>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #define ISOLATE_SCOPE(iso) \
   v8::Isolate* isolate = (iso);                                                               \
@@ -38,12 +57,272 @@
 // We only need one, it's stateless.
 auto allocator = v8::ArrayBuffer::Allocator::NewDefaultAllocator();
 
+struct Value;
+class ConsoleBuffer;
+
 typedef struct {
 	v8::Persistent<v8::Context> ptr;
 	v8::Isolate* isolate;
+	int go_context_id;
+	// Modules evaluated in this context by name, and their names by identity
+	// hash so that the referrer of an import can be named.
+	std::map<std::string, v8::Global<v8::Module>> modules;
+	std::multimap<int, std::string> module_names;
+	// The handles of the values that Go holds for this context, which are
+	// released along with it.
+	Value* values;
+	int live_values;
+	// The native console, see v8_Context_InjectConsole.
+	ConsoleBuffer* console;
 } Context;
 
-typedef v8::Persistent<v8::Value> Value;
+// Embedder data slot of every context holding the id of the Go context that
+// callbacks bound by name ("@name") are dispatched to. Slot 0 is left to the
+// inspector.
+const int kGoContextIdIndex = 1;
+
+extern "C" V8CBRIDGE_API void go_callback(const v8::FunctionCallbackInfo<v8::Value>& args);
+extern "C" V8CBRIDGE_API void go_callback_fast(const v8::FunctionCallbackInfo<v8::Value>& args);
+void ConsoleLog(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+// Native functions that snapshotted objects may reference. This must be the
+// same for the snapshot creator and every isolate created from a snapshot.
+intptr_t external_references[] = {
+	reinterpret_cast<intptr_t>(go_callback),
+	reinterpret_cast<intptr_t>(go_callback_fast),
+	reinterpret_cast<intptr_t>(ConsoleLog),
+	0,
+};
+
+// The handle of a value returned to Go. It is linked into the list of its
+// owner, the context that the Go value belongs to, see NewValue.
+struct Value : public v8::Persistent<v8::Value> {
+	template <class T>
+	Value(v8::Isolate* isolate, v8::Local<T> value)
+		: v8::Persistent<v8::Value>(isolate, value), owner(nullptr), prev(nullptr), next(nullptr) {}
+
+	Context* owner;
+	Value* prev;
+	Value* next;
+};
+typedef v8::Persistent<v8::Script> Script;
+
+// A call prepared by v8_Context_PrepareCall. The function and receiver are
+// values of the context, so they are released along with it. argv holds the
+// arguments of a call, it is only kept to avoid allocating it every time.
+typedef struct {
+	Value* func;
+	Value* self;
+	std::vector<CallArg> args;
+	std::vector<v8::Local<v8::Value>> argv;
+} PreparedCall;
+
+// ScriptStream receives the source of a script chunk by chunk and hands it to
+// V8's parser, which calls GetMoreData from a background thread.
+class ScriptStream : public v8::ScriptCompiler::ExternalSourceStream {
+public:
+	// Push queues a chunk. A UTF-8 sequence that is cut off at the end of the
+	// chunk is held back until the next one, since V8 only copes with
+	// characters that are split across two chunks.
+	void Push(const char* data, int len) {
+		std::lock_guard<std::mutex> lock(mtx_);
+		source_.append(data, len);
+		pending_.append(data, len);
+
+		size_t complete = pending_.size();
+		for (size_t i = 1; i <= 3 && i <= pending_.size(); i++) {
+			unsigned char c = pending_[pending_.size() - i];
+			if ((c & 0xC0) == 0x80) {
+				continue; // continuation byte, keep looking for the lead byte
+			}
+			size_t seq_len = (c >= 0xF0) ? 4 : (c >= 0xE0) ? 3 : (c >= 0xC0) ? 2 : 1;
+			if (seq_len > i) {
+				complete = pending_.size() - i;
+			}
+			break;
+		}
+		ready_.append(pending_, 0, complete);
+		pending_.erase(0, complete);
+		cond_.notify_one();
+	}
+
+	void Close() {
+		std::lock_guard<std::mutex> lock(mtx_);
+		ready_.append(pending_);
+		pending_.clear();
+		closed_ = true;
+		cond_.notify_one();
+	}
+
+	size_t GetMoreData(const uint8_t** src) override {
+		std::unique_lock<std::mutex> lock(mtx_);
+		cond_.wait(lock, [this] { return !ready_.empty() || closed_; });
+		if (ready_.empty()) {
+			return 0;
+		}
+		// V8 takes ownership of the returned chunk.
+		size_t len = ready_.size();
+		uint8_t* chunk = new uint8_t[len];
+		memcpy(chunk, ready_.data(), len);
+		ready_.clear();
+		*src = chunk;
+		return len;
+	}
+
+	// The full source is needed again for the final compile step. It must
+	// only be accessed after Close.
+	const std::string& source() const { return source_; }
+
+private:
+	std::mutex mtx_;
+	std::condition_variable cond_;
+	std::string source_;
+	std::string pending_; // incomplete UTF-8 tail of the last chunk
+	std::string ready_;   // data that can be handed to V8
+	bool closed_ = false;
+};
+
+// Text in malloc'ed memory that external strings refer to instead of copying
+// it, see v8_ExternalString_New. It is freed once the last string created from
+// it has been collected and v8_ExternalString_Release has been called.
+class ExternalText {
+public:
+	ExternalText(bool one_byte, size_t length, void* data)
+		: one_byte_(one_byte), length_(length), data_(data) {}
+
+	void Ref() { refs_++; }
+	void Unref() {
+		if (--refs_ == 0) {
+			free(data_);
+			delete this;
+		}
+	}
+
+	bool one_byte() const { return one_byte_; }
+	size_t length() const { return length_; } // in characters
+	const void* data() const { return data_; }
+
+private:
+	std::atomic<int> refs_{ 1 };
+	bool one_byte_; // Latin-1, UTF-16 otherwise
+	size_t length_;
+	void* data_;
+};
+
+// V8 deletes the resource of an external string when the string is collected
+// or the isolate is disposed.
+class ExternalOneByteResource : public v8::String::ExternalOneByteStringResource {
+public:
+	explicit ExternalOneByteResource(ExternalText* text) : text_(text) { text_->Ref(); }
+	~ExternalOneByteResource() override { text_->Unref(); }
+	const char* data() const override { return static_cast<const char*>(text_->data()); }
+	size_t length() const override { return text_->length(); }
+private:
+	ExternalText* text_;
+};
+
+class ExternalTwoByteResource : public v8::String::ExternalStringResource {
+public:
+	explicit ExternalTwoByteResource(ExternalText* text) : text_(text) { text_->Ref(); }
+	~ExternalTwoByteResource() override { text_->Unref(); }
+	const uint16_t* data() const override { return static_cast<const uint16_t*>(text_->data()); }
+	size_t length() const override { return text_->length(); }
+private:
+	ExternalText* text_;
+};
+
+// Decodes the UTF-8 sequence at s into *cp and returns its length. Invalid
+// sequences decode to U+FFFD, like String::NewFromUtf8 does.
+size_t DecodeUtf8(const unsigned char* s, size_t len, uint32_t* cp) {
+	unsigned char c = s[0];
+	size_t n;
+	uint32_t min;
+	if (c < 0x80) {
+		*cp = c;
+		return 1;
+	}
+	else if ((c & 0xE0) == 0xC0) { n = 2; min = 0x80; *cp = c & 0x1F; }
+	else if ((c & 0xF0) == 0xE0) { n = 3; min = 0x800; *cp = c & 0x0F; }
+	else if ((c & 0xF8) == 0xF0) { n = 4; min = 0x10000; *cp = c & 0x07; }
+	else {
+		*cp = 0xFFFD;
+		return 1;
+	}
+	for (size_t i = 1; i < n; i++) {
+		if (i >= len || (s[i] & 0xC0) != 0x80) {
+			*cp = 0xFFFD;
+			return i;
+		}
+		*cp = (*cp << 6) | (s[i] & 0x3F);
+	}
+	if (*cp < min || *cp > 0x10FFFF || (*cp >= 0xD800 && *cp <= 0xDFFF)) {
+		*cp = 0xFFFD;
+	}
+	return n;
+}
+
+// Converts UTF-8 to Latin-1 if every character fits into one byte, which
+// takes a single copy for ASCII, and to UTF-16 otherwise.
+ExternalText* NewExternalText(const char* utf8, size_t len) {
+	const unsigned char* s = reinterpret_cast<const unsigned char*>(utf8);
+
+	size_t ascii = 0;
+	while (ascii < len && s[ascii] < 0x80) {
+		ascii++;
+	}
+	if (ascii == len) {
+		char* data = static_cast<char*>(malloc(len > 0 ? len : 1));
+		memcpy(data, utf8, len);
+		return new ExternalText(true, len, data);
+	}
+
+	bool latin1 = true;
+	size_t units = ascii;
+	for (size_t i = ascii; i < len;) {
+		uint32_t cp;
+		i += DecodeUtf8(s + i, len - i, &cp);
+		latin1 = latin1 && cp <= 0xFF;
+		units += cp > 0xFFFF ? 2 : 1;
+	}
+
+	if (latin1) {
+		unsigned char* data = static_cast<unsigned char*>(malloc(units));
+		memcpy(data, utf8, ascii);
+		size_t j = ascii;
+		for (size_t i = ascii; i < len;) {
+			uint32_t cp;
+			i += DecodeUtf8(s + i, len - i, &cp);
+			data[j++] = static_cast<unsigned char>(cp);
+		}
+		return new ExternalText(true, units, data);
+	}
+
+	uint16_t* data = static_cast<uint16_t*>(malloc(units * sizeof(uint16_t)));
+	size_t j = 0;
+	for (; j < ascii; j++) {
+		data[j] = s[j];
+	}
+	for (size_t i = ascii; i < len;) {
+		uint32_t cp;
+		i += DecodeUtf8(s + i, len - i, &cp);
+		if (cp > 0xFFFF) {
+			cp -= 0x10000;
+			data[j++] = static_cast<uint16_t>(0xD800 + (cp >> 10));
+			data[j++] = static_cast<uint16_t>(0xDC00 + (cp & 0x3FF));
+		}
+		else {
+			data[j++] = static_cast<uint16_t>(cp);
+		}
+	}
+	return new ExternalText(false, units, data);
+}
+
+typedef struct {
+	v8::Isolate* isolate;
+	ScriptStream* stream; // owned by source
+	std::unique_ptr<v8::ScriptCompiler::StreamedSource> source;
+	std::unique_ptr<v8::ScriptCompiler::ScriptStreamingTask> task; // null if V8 can't stream
+} StreamingScript;
 
 String DupString(const v8::String::Utf8Value& src) {
 	char* data = static_cast<char*>(malloc(src.length()));
@@ -54,8 +333,10 @@ String DupString(v8::Isolate* isolate, const v8::Local<v8::Value>& val) {
 	return DupString(v8::String::Utf8Value(isolate, val));
 }
 String DupString(const char* msg) {
-	const char* data = _strdup(msg);
-	return String{ data, int(strlen(msg)) };
+	size_t len = strlen(msg);
+	char* data = static_cast<char*>(malloc(len + 1));
+	memcpy(data, msg, len + 1);
+	return String{ data, int(len) };
 }
 String DupString(const std::string& src) {
 	char* data = static_cast<char*>(malloc(src.length()));
@@ -114,6 +395,7 @@ KindMask v8_Value_KindsFromLocal(v8::Local<v8::Value> value) {
 	if (value->IsProxy())             kinds |= (1ULL << Kind::kProxy);
 	if (value->IsWebAssemblyCompiledModule())
 		kinds |= (1ULL << Kind::kWebAssemblyCompiledModule);
+	if (value->IsBigInt())            kinds |= (1ULL << Kind::kBigInt);
 
 	return kinds;
 }
@@ -173,240 +455,1419 @@ std::string report_exception(v8::Isolate* isolate, v8::Local<v8::Context> ctx, v
 	return ss.str();
 }
 
-// Platform has to be global
-std::unique_ptr<v8::Platform> platform_ = nullptr;
-
-char* snapshot_bytes_ = nullptr; // the default snapshot stored in resources
-DWORD snapshot_size_; // -1 means that the default snapshot has not been loaded from resources
-bool snapshot_loadad_ = false;
-std::mutex mtx;
+typedef struct {
+	v8::SnapshotCreator* creator;
+	v8::Locker* locker;
+	v8::StartupData existing_blob;
+} SnapshotCreator;
+
+GoAccessorHandlerPtr go_accessor_handler = nullptr;
+GoReleaseHandlePtr go_release_handle = nullptr;
+GoInterceptorHandlerPtr go_interceptor_handler = nullptr;
+GoConsoleFlushHandlerPtr go_console_flush_handler = nullptr;
+
+// An object wrapping a Go value, see v8_Context_Wrap and
+// v8_Context_NewInterceptedObject. The handle of the Go
+// value is released once the object has been collected.
+typedef struct {
+	v8::Global<v8::Object> object;
+	int handle;
+} WrappedObject;
 
-void log_warning(const char* msg) {
-	std::cout << "Warning: " << msg << "\n"; // TODO: implement some other kind of logging mechanism
-}
+// A property of the global template, see v8_Isolate_SetGlobalValue.
+typedef struct {
+	std::string name;
+	v8::Global<v8::Data> value;
+} GlobalProperty;
 
-// based on v8-8.0.426\v8\src\snapshot\snapshot-common.cc RunExtraCode
-bool RunExtraCode(v8::Isolate* isolate, v8::Local<v8::Context> context,
-	const char* utf8_source, const char* name) {
-	v8::Context::Scope context_scope(context);
-	v8::TryCatch try_catch(isolate);
-	v8::Local<v8::String> source_string;
-	if (!v8::String::NewFromUtf8(isolate, utf8_source, v8::NewStringType::kNormal)
-		.ToLocal(&source_string)) {
-		return false;
+// The code cache of a module, see CompileModule.
+typedef struct {
+	uint64_t source_hash;
+	std::string data;
+} ModuleCodeCache;
+
+// Bridge statistics of an isolate, see v8_Isolate_GetBridgeStats. The
+// counters are updated with relaxed atomics since they are only read as a
+// snapshot, and the isolate lock already serializes most updates.
+class BridgeCounters {
+public:
+	BridgeCounters() : enabled(false), handles_created(0), handles_released(0) {
+		for (Entry& entry : entries) {
+			entry.calls = 0;
+			entry.nanos = 0;
+			entry.bytes = 0;
+			for (std::atomic<uint64_t>& bucket : entry.histogram) {
+				bucket = 0;
+			}
+		}
 	}
-	v8::Local<v8::String> resource_name =
-		v8::String::NewFromUtf8(isolate, name, v8::NewStringType::kNormal)
-		.ToLocalChecked();
-	v8::ScriptOrigin origin(resource_name);
-	v8::ScriptCompiler::Source source(source_string, origin);
-	v8::Local<v8::Script> script;
-	if (!v8::ScriptCompiler::Compile(context, &source).ToLocal(&script))
-		return false;
-	if (script->Run(context).IsEmpty()) return false;
-	if (try_catch.HasCaught()) return false; // TODO: or exit?
-	return true;
-}
 
-v8::StartupData* GetSnapshotFromRes() {
-	mtx.lock();
+	struct Entry {
+		std::atomic<uint64_t> calls, nanos, bytes;
+		std::atomic<uint64_t> histogram[kBridgeHistogramBuckets];
+	};
 
-	//log_warning("Trying to load from resources");
+	std::atomic<bool> enabled;
+	std::atomic<uint64_t> handles_created, handles_released;
+	Entry entries[kNumBridgeEntries];
+};
 
-	// if snapshot has not been loaded in memory yet
-	if (!snapshot_loadad_) {
+// Bridge state owned by an isolate, stored in isolate data slot 0.
+typedef struct {
+	v8::ArrayBuffer::Allocator* allocator;
+	// V8 keeps referring to the startup data after the isolate is created,
+	// e.g. for Context::FromSnapshot. Only the struct is owned, the blob is
+	// owned by Go or by the process-wide snapshot mappings.
+	v8::StartupData snapshot;
+	// The global template is built from global_properties on first use and
+	// rebuilt after they change, since templates must not be modified once
+	// they have been instantiated.
+	std::vector<GlobalProperty> global_properties;
+	v8::Global<v8::ObjectTemplate> global_template;
+	// Code caches of compiled modules by name, for the source with the given
+	// hash. A module compiled from another source replaces the entry of its
+	// name, so the cache holds at most one entry per module name.
+	std::map<std::string, ModuleCodeCache> module_code_cache;
+	ModuleCacheStats module_cache_stats;
+	// Templates of wrapped Go structs by id, and the wrapping objects that
+	// haven't been collected yet.
+	std::vector<v8::Global<v8::ObjectTemplate>> struct_templates;
+	std::set<WrappedObject*> wrapped_objects;
+	// Templates of intercepted objects by InterceptorFlags.
+	v8::Global<v8::ObjectTemplate> interceptor_templates[(kInterceptNamed | kInterceptIndexed) + 1];
+	BridgeCounters stats;
+	// The contexts that haven't been released by Go context id, and the
+	// number of value handles held by Go in all of them.
+	std::map<int, Context*> contexts;
+	int live_values;
+} IsolateData;
+
+IsolateData* GetIsolateData(v8::Isolate* isolate) {
+	return static_cast<IsolateData*>(isolate->GetData(0));
+}
+
+// Returns the bridge statistics of the isolate if they are enabled.
+BridgeCounters* EnabledBridgeCounters(v8::Isolate* isolate) {
+	// Entry points count calls before checking for a released isolate.
+	if (isolate == nullptr) {
+		return nullptr;
+	}
+	IsolateData* data = GetIsolateData(isolate);
+	if (data == nullptr || !data->stats.enabled.load(std::memory_order_relaxed)) {
+		return nullptr;
+	}
+	return &data->stats;
+}
 
-		//log_warning("Before getting module handle");
+// Counts a call to a bridge entry point from its construction to its
+// destruction, so it is declared before the scopes of the call.
+class BridgeTimer {
+public:
+	BridgeTimer(v8::Isolate* isolate, BridgeEntry entry)
+		: entry_(nullptr) {
+		BridgeCounters* counters = EnabledBridgeCounters(isolate);
+		if (counters != nullptr) {
+			entry_ = &counters->entries[entry];
+			start_ = std::chrono::steady_clock::now();
+		}
+	}
 
-		snapshot_loadad_ = true; // do not try to load it again
+	~BridgeTimer() {
+		if (entry_ == nullptr) {
+			return;
+		}
+		uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start_).count();
+		int bucket = 0;
+		while (bucket < kBridgeHistogramBuckets - 1 && (nanos >> (bucket + 1)) != 0) {
+			bucket++;
+		}
+		entry_->calls.fetch_add(1, std::memory_order_relaxed);
+		entry_->nanos.fetch_add(nanos, std::memory_order_relaxed);
+		entry_->histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+	}
 
-		HMODULE hModule = GetModuleHandle(L"V8CBRIDGE.dll");
-		HRSRC hResInfo = FindResource(hModule, MAKEINTRESOURCE(IDR_SNAPSHOT1), L"snapshot"); // obtain handle of the resource
-		if (hResInfo != 0) {
+	void AddBytes(size_t bytes) {
+		if (entry_ != nullptr) {
+			entry_->bytes.fetch_add(bytes, std::memory_order_relaxed);
+		}
+	}
 
-			//log_warning("before LoadResource");
+private:
+	BridgeCounters::Entry* entry_;
+	std::chrono::steady_clock::time_point start_;
+};
 
-			HGLOBAL hResData = LoadResource(hModule, hResInfo); // Load the resource
-			snapshot_size_ = SizeofResource(hModule, hResInfo);
+#define ISOLATE_STAT(iso, entry) BridgeTimer bridge_timer((iso), (entry));
+#define CONTEXT_STAT(ctxptr, entry) ISOLATE_STAT(static_cast<Context*>(ctxptr)->isolate, entry)
 
-			//std::cout << snapshot_size_;
+// Returns the context of the Go context with the given id, or nullptr if it
+// has been released. The isolate must be locked.
+Context* FindContext(v8::Isolate* isolate, int go_context_id) {
+	IsolateData* data = GetIsolateData(isolate);
+	if (data == nullptr) {
+		return nullptr;
+	}
+	auto it = data->contexts.find(go_context_id);
+	return it == data->contexts.end() ? nullptr : it->second;
+}
 
-			if (hResData != 0) {
-				LPVOID lpAddress = LockResource(hResData); // Get the address of the loaded resource
+// Creates the persistent handle of a value that is returned to Go as a value
+// of owner, which releases the handle when it is released itself unless Go
+// has done so before. The isolate must be locked.
+template <class T>
+Value* NewValue(v8::Isolate* isolate, Context* owner, v8::Local<T> value) {
+	Value* handle = new Value(isolate, value);
+	if (owner != nullptr) {
+		handle->owner = owner;
+		handle->next = owner->values;
+		if (owner->values != nullptr) {
+			owner->values->prev = handle;
+		}
+		owner->values = handle;
+		owner->live_values++;
+	}
 
-				snapshot_bytes_ = new char[snapshot_size_];
-				memcpy(snapshot_bytes_, lpAddress, snapshot_size_);
+	IsolateData* data = GetIsolateData(isolate);
+	if (data != nullptr) {
+		data->live_values++;
+		if (data->stats.enabled.load(std::memory_order_relaxed)) {
+			data->stats.handles_created.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	return handle;
+}
 
-				//log_warning("Snapshot resource loaded");
+template <class T>
+Value* NewValue(ContextPtr ctxptr, v8::Local<T> value) {
+	Context* owner = static_cast<Context*>(ctxptr);
+	return NewValue(owner->isolate, owner, value);
+}
 
-			}
-			else {
-				//log_warning("Snapshot resource not loaded");
-			}
+// Releases a handle created with NewValue, the isolate must be locked.
+void DeleteValue(v8::Isolate* isolate, Value* value) {
+	if (Context* owner = value->owner) {
+		if (value->prev != nullptr) {
+			value->prev->next = value->next;
 		}
 		else {
-			//log_warning("Snapshot resource not found");
+			owner->values = value->next;
 		}
-
-
+		if (value->next != nullptr) {
+			value->next->prev = value->prev;
+		}
+		owner->live_values--;
 	}
 
-	mtx.unlock();
+	IsolateData* data = GetIsolateData(isolate);
+	if (data != nullptr) {
+		data->live_values--;
+		if (data->stats.enabled.load(std::memory_order_relaxed)) {
+			data->stats.handles_released.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	value->Reset();
+	delete value;
+}
 
-	v8::StartupData* startup_data = new v8::StartupData;
-	startup_data->data = snapshot_bytes_;
-	startup_data->raw_size = snapshot_size_;
+// Go passes a null context for the values of a context that it has released,
+// whose handles have been released along with it. Calls on them return the
+// given result, e.g. ReleasedContext, instead of touching the handles.
+#define RETURN_IF_RELEASED(ctxptr, result) if ((ctxptr) == nullptr) { return result; }
 
-	return startup_data;
+Error ReleasedContextError() {
+	return DupString("Context has been released");
+}
 
+// Returns an empty result carrying the released context error.
+template <class T>
+T ReleasedContext() {
+	T res = {};
+	res.error_msg = ReleasedContextError();
+	return res;
 }
 
-extern "C" {
+// Returns the result of a call that threw the exception caught by try_catch.
+// Unlike report_exception, the error message isn't formatted here but by Go,
+// once it is needed, so that scripts which throw routinely don't pay for it.
+// Terminations have no exception value and are reported as a string.
+ValueTuple ExceptionResult(ContextPtr ctxptr, v8::Local<v8::Context> ctx, v8::TryCatch& try_catch) {
+	v8::Isolate* isolate = ctx->GetIsolate();
+	ValueTuple res = { nullptr, 0, nullptr };
+	v8::Local<v8::Value> thrown = try_catch.Exception();
+	if (try_catch.HasTerminated() || thrown.IsEmpty()) {
+		res.error_msg = DupString(report_exception(isolate, ctx, try_catch));
+		return res;
+	}
 
-	V8CBRIDGE_API GoCallbackHandlerPtr go_callback_handler = nullptr;
+	Exception* exception = static_cast<Exception*>(calloc(1, sizeof(Exception)));
+	exception->Value = NewValue(ctxptr, thrown);
+	exception->Kinds = v8_Value_KindsFromLocal(thrown);
+	exception->Text = DupString(str(isolate, thrown));
+	exception->HasStack = thrown->IsNativeError() ? 1 : 0;
+	res.exception = exception;
 
-	V8CBRIDGE_API Version version = { V8_MAJOR_VERSION, V8_MINOR_VERSION, V8_BUILD_NUMBER, V8_PATCH_LEVEL };
+	v8::Local<v8::Message> message = try_catch.Message();
+	if (message.IsEmpty()) {
+		return res;
+	}
+	if (!message->GetScriptResourceName()->IsUndefined()) {
+		exception->HasLocation = 1;
+		exception->Filename = DupString(str(isolate, message->GetScriptResourceName()));
+		exception->Line = message->GetLineNumber(ctx).FromMaybe(0);
+		exception->StartColumn = message->GetStartColumn(ctx).FromMaybe(0);
+		exception->EndColumn = message->GetEndColumn(ctx).FromMaybe(0);
+		v8::Local<v8::String> source_line;
+		if (message->GetSourceLine(ctx).ToLocal(&source_line)) {
+			exception->SourceLine = DupString(str(isolate, source_line));
+		}
+	}
 
-	V8CBRIDGE_API void v8_Init(GoCallbackHandlerPtr callback_handler, const char* icu_data_file) {
+	v8::Local<v8::StackTrace> trace = message->GetStackTrace();
+	if (exception->HasStack && !trace.IsEmpty() && trace->GetFrameCount() > 0) {
+		exception->FrameCount = trace->GetFrameCount();
+		exception->Frames = static_cast<CallerInfo*>(calloc(exception->FrameCount, sizeof(CallerInfo)));
+		for (int i = 0; i < exception->FrameCount; i++) {
+			v8::Local<v8::StackFrame> frame = trace->GetFrame(isolate, i);
+			exception->Frames[i] = CallerInfo{
+				DupString(str(isolate, frame->GetFunctionName())),
+				DupString(str(isolate, frame->GetScriptName())),
+				frame->GetLineNumber(),
+				frame->GetColumn()
+			};
+		}
+	}
+	return res;
+}
 
-		mtx.lock();
+IsolateData* NewIsolateData(v8::Isolate* isolate, v8::ArrayBuffer::Allocator* allocator) {
+	IsolateData* data = new IsolateData;
+	data->allocator = allocator;
+	data->snapshot = { nullptr, 0 };
+	data->module_cache_stats = { 0, 0, 0, 0 };
+	data->live_values = 0;
+	isolate->SetData(0, data);
+	return data;
+}
 
-		//init only once
-		if (platform_ != nullptr) {
-			mtx.unlock();
-			return;
+// Resets the handles held by the isolate data, the isolate must be locked.
+void ResetIsolateData(IsolateData* data) {
+	data->global_template.Reset();
+	data->global_properties.clear();
+	data->module_code_cache.clear();
+	data->struct_templates.clear();
+	for (v8::Global<v8::ObjectTemplate>& templ : data->interceptor_templates) {
+		templ.Reset();
+	}
+	// Objects that are still alive are never collected now, so their Go
+	// values are released here.
+	for (WrappedObject* wrapped : data->wrapped_objects) {
+		wrapped->object.Reset();
+		if (go_release_handle != nullptr) {
+			go_release_handle(wrapped->handle);
 		}
+		delete wrapped;
+	}
+	data->wrapped_objects.clear();
+}
 
-		//const char* path
-		//v8::V8::InitializeICUDefaultLocation(path);
-		//v8::V8::InitializeExternalStartupData(path);
-
-		platform_ = v8::platform::NewDefaultPlatform(
-			0, // thread_pool_size
-			v8::platform::IdleTaskSupport::kDisabled,
-			v8::platform::InProcessStackDumping::kEnabled);
-		v8::V8::InitializePlatform(platform_.get());
-		v8::V8::Initialize();
+void ReleaseWrappedObject(const v8::WeakCallbackInfo<WrappedObject>& info) {
+	WrappedObject* wrapped = info.GetParameter();
+	wrapped->object.Reset();
+	GetIsolateData(info.GetIsolate())->wrapped_objects.erase(wrapped);
+	if (go_release_handle != nullptr) {
+		go_release_handle(wrapped->handle);
+	}
+	delete wrapped;
+}
 
-		if (!v8::V8::InitializeICU(icu_data_file)) {
-			log_warning("V8 ICU not initialized");
-		}
+// Makes obj wrap the Go value with the given handle, which is released once
+// obj has been collected. obj must have been created from a template with
+// one internal field.
+void WrapObject(v8::Isolate* isolate, v8::Local<v8::Object> obj, int handle) {
+	obj->SetInternalField(0, v8::Integer::New(isolate, handle));
+
+	WrappedObject* wrapped = new WrappedObject;
+	wrapped->object.Reset(isolate, obj);
+	wrapped->handle = handle;
+	wrapped->object.SetWeak(wrapped, ReleaseWrappedObject, v8::WeakCallbackType::kParameter);
+	GetIsolateData(isolate)->wrapped_objects.insert(wrapped);
+}
 
-		go_callback_handler = callback_handler;
+int WrappedHandle(v8::Local<v8::Object> obj) {
+	return obj->GetInternalField(0).As<v8::Int32>()->Value();
+}
 
-		mtx.unlock();
-	}
+// Returns the id of the Go context that owns the current context.
+int CurrentGoContextId(v8::Isolate* isolate) {
+	v8::Local<v8::Context> ctx = isolate->GetCurrentContext();
+	return ctx->GetEmbedderData(kGoContextIdIndex)->Int32Value(ctx).FromMaybe(0);
+}
 
-	V8CBRIDGE_API void v8_Free(void* ptr) {
-		free(ptr);
-	}
+// A ring of bytes holding lines of console output until Go reads them. Lines
+// that don't fit are dropped rather than overwriting lines that haven't been
+// read yet.
+class ConsoleRing {
+public:
+	explicit ConsoleRing(size_t capacity) : data_(capacity), head_(0), size_(0) {}
 
-	// If startup_data is null then snapshot will be loaded from resources.
-	V8CBRIDGE_API extern StartupData v8_CreateSnapshotDataBlob(const char* js, int include_compiled_fn_code, StartupData* startup_data) {
+	size_t size() const { return size_; }
+	size_t available() const { return data_.size() - size_; }
 
-		//Based on v8-8.0.426\v8\src\snapshot\snapshot-common.cc CreateSnapshotDataBlobInternal
+	bool Append(const std::string& line) {
+		if (line.size() > available()) {
+			return false;
+		}
+		size_t tail = (head_ + size_) % data_.size();
+		size_t first = std::min(line.size(), data_.size() - tail);
+		memcpy(&data_[tail], line.data(), first);
+		memcpy(&data_[0], line.data() + first, line.size() - first);
+		size_ += line.size();
+		return true;
+	}
 
-		v8::StartupData* existing_blob;
+	size_t Read(char* buf, size_t len) {
+		len = std::min(len, size_);
+		if (len == 0) {
+			return 0;
+		}
+		size_t first = std::min(len, data_.size() - head_);
+		memcpy(buf, &data_[head_], first);
+		memcpy(buf + first, &data_[0], len - first);
+		head_ = (head_ + len) % data_.size();
+		size_ -= len;
+		return len;
+	}
 
-		// if snapshot passed use that
-		if (startup_data != nullptr) {
-			//log_warning("Snapshot passed via arguments");
-			//std::cout << data;
-			existing_blob = new v8::StartupData;
-			existing_blob->data = startup_data->ptr;
-			existing_blob->raw_size = startup_data->len;
+private:
+	std::vector<char> data_;
+	size_t head_;
+	size_t size_;
+};
+
+// The native console of a context, see v8_Context_InjectConsole. The lines of
+// both streams are buffered in one ring, in the order they were logged, and
+// runs records which stream each run of consecutive bytes belongs to. The
+// isolate must be locked.
+class ConsoleBuffer {
+public:
+	explicit ConsoleBuffer(const ConsoleOptions& options)
+		: prefix(options.Prefix.ptr, size_t(options.Prefix.len)),
+		colorize(options.Colorize != 0),
+		flush_size(size_t(options.FlushSize)),
+		flush_interval(options.FlushIntervalNanos),
+		last_read(std::chrono::steady_clock::now()),
+		stats({ 0, 0, 0 }),
+		ring_(size_t(options.BufferSize)),
+		flushing_(false) {}
+
+	// Buffers line, calling the flush handler first if it doesn't fit and
+	// afterwards if the flush size or interval has been reached.
+	void Log(v8::Isolate* isolate, int go_context_id, ConsoleStream stream, const std::string& line) {
+		if (line.size() > ring_.available()) {
+			Flush(isolate, go_context_id);
+		}
+		if (ring_.Append(line)) {
+			if (!runs_.empty() && runs_.back().stream == stream) {
+				runs_.back().size += line.size();
+			}
+			else {
+				runs_.push_back({ stream, line.size() });
+			}
+			stats.Lines++;
 		}
 		else {
-			// load snapshot from resources
-			existing_blob = GetSnapshotFromRes();
+			stats.Dropped++;
 		}
 
-		// If no isolate is passed in, create it (and a new context) from scratch.
-		v8::Isolate* isolate = isolate = v8::Isolate::Allocate();		
+		if (ring_.size() >= flush_size || (flush_interval.count() > 0 &&
+			std::chrono::steady_clock::now() - last_read >= flush_interval)) {
+			Flush(isolate, go_context_id);
+		}
+	}
 
-		//TODO: important - what are these and are these needed?
-		v8::Locker locker(isolate);                            /* Lock to current thread.        */ \
-		v8::Isolate::Scope isolate_scope(isolate);             /* Assign isolate to this thread. */
+	// Moves up to len bytes of the oldest run to buf and sets *stream to its
+	// stream, returns the number of bytes moved.
+	size_t Read(char* buf, size_t len, ConsoleStream* stream) {
+		last_read = std::chrono::steady_clock::now();
+		if (runs_.empty()) {
+			return 0;
+		}
+		ConsoleRun& run = runs_.front();
+		size_t n = ring_.Read(buf, std::min(len, run.size));
+		*stream = run.stream;
+		run.size -= n;
+		if (run.size == 0) {
+			runs_.pop_front();
+		}
+		return n;
+	}
 
-		// Optionally run a script to embed, and serialize to create a snapshot blob.
-		v8::SnapshotCreator snapshot_creator(isolate, nullptr, existing_blob);
-		{
-			v8::HandleScope scope(isolate);
-			v8::Local<v8::Context> context = v8::Context::New(isolate);
-			if (js != nullptr &&
-				!RunExtraCode(isolate, context, js, "<embedded>")) {
-				return {};
-			}
-			snapshot_creator.SetDefaultContext(context);
+	std::string prefix;
+	bool colorize;
+	size_t flush_size;
+	std::chrono::nanoseconds flush_interval;
+	std::chrono::steady_clock::time_point last_read;
+	ConsoleStats stats;
+
+private:
+	struct ConsoleRun {
+		ConsoleStream stream;
+		size_t size;
+	};
+
+	void Flush(v8::Isolate* isolate, int go_context_id) {
+		// The handler reads the buffer with v8_Context_ReadConsole, a line
+		// logged while it runs, if any, is buffered without flushing again.
+		if (go_console_flush_handler == nullptr || flushing_) {
+			return;
 		}
+		ISOLATE_STAT(isolate, kStatGoConsoleFlush);
+		flushing_ = true;
+		stats.Flushes++;
+		go_console_flush_handler(go_context_id);
+		flushing_ = false;
+	}
 
-		v8::StartupData data = snapshot_creator.CreateBlob(include_compiled_fn_code ? v8::SnapshotCreator::FunctionCodeHandling::kKeep : v8::SnapshotCreator::FunctionCodeHandling::kClear);
+	ConsoleRing ring_;
+	std::deque<ConsoleRun> runs_;
+	bool flushing_;
+};
+
+const char* const kConsoleMethods[] = { "log", "info", "warn", "error" };
+const int kConsoleWarn = 2; // warn and error go to stderr
+
+// The methods of the native console, the data of the function is the index of
+// the method in kConsoleMethods. Lines are formatted like those of v8console:
+// warnings and errors go to stderr, prefixed with the location of the caller.
+void ConsoleLog(const v8::FunctionCallbackInfo<v8::Value>& args) {
+	v8::Isolate* isolate = args.GetIsolate();
+	v8::HandleScope scope(isolate);
+	Context* owner = FindContext(isolate, CurrentGoContextId(isolate));
+	if (owner == nullptr || owner->console == nullptr) {
+		return;
+	}
+	int method = args.Data().As<v8::Int32>()->Value();
+	bool to_stderr = method >= kConsoleWarn;
+	bool colorize = to_stderr && owner->console->colorize;
+
+	// Converting the arguments can run scripts that log in turn, e.g. in
+	// toString, so the line is formatted locally and the console looked up
+	// again afterwards: the script may even have injected a new one.
+	std::string line;
+	if (colorize) {
+		line += method == kConsoleWarn ? "\033[93m" : "\033[91m";
+	}
+	line += owner->console->prefix;
+	if (to_stderr) {
+		v8::Local<v8::StackTrace> trace(v8::StackTrace::CurrentStackTrace(isolate, 1));
+		if (trace->GetFrameCount() == 1) {
+			v8::Local<v8::StackFrame> frame(trace->GetFrame(isolate, 0));
+			line += "[" + str(isolate, frame->GetScriptName()) + ":" +
+				std::to_string(frame->GetLineNumber()) + "] ";
+		}
+	}
+	{
+		// Arguments that can't be converted, such as symbols, are logged as
+		// empty strings instead of making console.log throw.
+		v8::TryCatch try_catch(isolate);
+		for (int i = 0; i < args.Length(); i++) {
+			if (i > 0) {
+				line += ' ';
+			}
+			line += str(isolate, args[i]);
+		}
+	}
+	if (colorize) {
+		line += "\033[0m";
+	}
+	line += '\n';
 
-		return StartupData{ data.data, data.raw_size };
+	if (owner->console != nullptr) {
+		owner->console->Log(isolate, owner->go_context_id, to_stderr ? kConsoleStderr : kConsoleStdout, line);
 	}
+}
 
-	// If StartupData is null then snapshot will be loaded from
-	// resources. To create an Isolate with no snapshot, pass
-	// and StartupData with len 0.
-	V8CBRIDGE_API IsolatePtr v8_Isolate_New(StartupData* data) {
+// Reads (value is nullptr) or writes the field of the Go value wrapped by
+// holder, whose index is the accessor's data. Errors are thrown as
+// exceptions, in which case false is returned.
+bool CallGoAccessor(v8::Isolate* isolate, v8::Local<v8::Object> holder, v8::Local<v8::Value> data,
+	ValueTuple* value, v8::Local<v8::Value>* result) {
+	ISOLATE_STAT(isolate, kStatGoAccessor);
+	if (go_accessor_handler == nullptr) {
+		isolate->ThrowException(v8::Exception::Error(
+			v8::String::NewFromUtf8(isolate, "Accessor handler not init").ToLocalChecked()));
+		return false;
+	}
 
-		v8::Isolate::CreateParams create_params;
-		create_params.array_buffer_allocator =
-			v8::ArrayBuffer::Allocator::NewDefaultAllocator();
+	int handle = WrappedHandle(holder);
+	int field = data.As<v8::Int32>()->Value();
+	ValueTuple res = go_accessor_handler(CurrentGoContextId(isolate), handle, field, value);
 
-		// if snapshot passed use that
-		if (data != nullptr) {
-			//log_warning("Snapshot passed via arguments");
-			//std::cout << data;
-			v8::StartupData* startup_data = new v8::StartupData;
-			startup_data->data = data->ptr;
-			startup_data->raw_size = data->len;
-			create_params.snapshot_blob = startup_data;
+	if (res.error_msg.ptr != nullptr) {
+		isolate->ThrowException(v8::Exception::Error(
+			v8::String::NewFromUtf8(isolate, res.error_msg.ptr, v8::NewStringType::kNormal,
+				res.error_msg.len).ToLocalChecked()));
+		free((void*)res.error_msg.ptr);
+		return false;
+	}
+	if (result != nullptr) {
+		if (res.Value == nullptr) {
+			*result = v8::Undefined(isolate);
 		}
 		else {
-			// load snapshot from resources
-			create_params.snapshot_blob = GetSnapshotFromRes();
+			*result = static_cast<Value*>(res.Value)->Get(isolate);
 		}
+	}
+	return true;
+}
 
-		//log_warning("before isolate construction");
-
-		v8::Isolate* isolate = v8::Isolate::New(create_params);
+void StructFieldGetter(v8::Local<v8::Name> property, const v8::PropertyCallbackInfo<v8::Value>& info) {
+	v8::Local<v8::Value> result;
+	if (CallGoAccessor(info.GetIsolate(), info.Holder(), info.Data(), nullptr, &result)) {
+		info.GetReturnValue().Set(result);
+	}
+}
 
-		//log_warning("after isolate construction");
+void StructFieldSetter(v8::Local<v8::Name> property, v8::Local<v8::Value> value,
+	const v8::PropertyCallbackInfo<void>& info) {
+	// The Go side owns the handle of the new value.
+	v8::Isolate* isolate = info.GetIsolate();
+	ValueTuple arg = {
+		NewValue(isolate, FindContext(isolate, CurrentGoContextId(isolate)), value),
+		v8_Value_KindsFromLocal(value),
+		nullptr
+	};
+	CallGoAccessor(isolate, info.Holder(), info.Data(), &arg, nullptr);
+}
 
-		return isolate;
+// Must be called with the isolate locked and a HandleScope.
+v8::Local<v8::ObjectTemplate> GetGlobalTemplate(v8::Isolate* isolate) {
+	IsolateData* data = GetIsolateData(isolate);
+	if (data->global_template.IsEmpty()) {
+		v8::Local<v8::ObjectTemplate> templ = v8::ObjectTemplate::New(isolate);
+		for (const GlobalProperty& prop : data->global_properties) {
+			v8::Local<v8::String> name = v8::String::NewFromUtf8(isolate, prop.name.c_str(),
+				v8::NewStringType::kInternalized).ToLocalChecked();
+			templ->Set(name, prop.value.Get(isolate));
+		}
+		data->global_template.Reset(isolate, templ);
+	}
+	return data->global_template.Get(isolate);
+}
 
+void SetGlobalProperty(v8::Isolate* isolate, const char* name, v8::Local<v8::Data> value) {
+	IsolateData* data = GetIsolateData(isolate);
+	data->global_template.Reset();
+	for (GlobalProperty& prop : data->global_properties) {
+		if (prop.name == name) {
+			prop.value.Reset(isolate, value);
+			return;
+		}
 	}
+	data->global_properties.emplace_back();
+	data->global_properties.back().name = name;
+	data->global_properties.back().value.Reset(isolate, value);
+}
 
-	V8CBRIDGE_API ContextPtr v8_Isolate_NewContext(IsolatePtr isolate_ptr) {
-		ISOLATE_SCOPE(static_cast<v8::Isolate*>(isolate_ptr));
-		v8::HandleScope handle_scope(isolate);
+ContextPtr NewContextFromLocal(v8::Isolate* isolate, v8::Local<v8::Context> local_ctx, int go_context_id) {
+	local_ctx->SetEmbedderData(kGoContextIdIndex, v8::Integer::New(isolate, go_context_id));
+
+	Context* ctx = new Context;
+	ctx->ptr.Reset(isolate, local_ctx);
+	ctx->isolate = isolate;
+	ctx->go_context_id = go_context_id;
+	ctx->values = nullptr;
+	ctx->live_values = 0;
+	ctx->console = nullptr;
+	GetIsolateData(isolate)->contexts[go_context_id] = ctx;
+	return static_cast<ContextPtr>(ctx);
+}
 
-		isolate->SetCaptureStackTraceForUncaughtExceptions(true);
+// Platform has to be global
+std::unique_ptr<v8::Platform> platform_ = nullptr;
+bool idle_task_support_ = false;
 
-		v8::Local<v8::ObjectTemplate> globals = v8::ObjectTemplate::New(isolate);
+// The default snapshot, loaded from the resources (Windows) or from the file
+// passed to v8_Init and shared by all isolates that don't get another one.
+v8::StartupData default_snapshot_ = { nullptr, 0 };
+bool default_snapshot_loaded_ = false;
+std::string default_snapshot_file_;
+// Why the snapshot file couldn't be mapped, nullptr if it was.
+const char* default_snapshot_error_ = nullptr;
 
-		Context* ctx = new Context;
-		ctx->ptr.Reset(isolate, v8::Context::New(isolate, nullptr, globals));
-		ctx->isolate = isolate;
-		return static_cast<ContextPtr>(ctx);
-	}
-	V8CBRIDGE_API void v8_Isolate_Terminate(IsolatePtr isolate_ptr) {
-		v8::Isolate* isolate = static_cast<v8::Isolate*>(isolate_ptr);
-		isolate->TerminateExecution();
-	}
-	V8CBRIDGE_API void v8_Isolate_Release(IsolatePtr isolate_ptr) {
-		if (isolate_ptr == nullptr) {
-			return;
-		}
-		v8::Isolate* isolate = static_cast<v8::Isolate*>(isolate_ptr);
-		isolate->Dispose();
-	}
+// Snapshot files are mapped once per process and never unmapped, so every
+// isolate created from the same file shares one read-only copy.
+std::map<std::string, v8::StartupData> mapped_snapshots_;
 
-	V8CBRIDGE_API ValueTuple v8_Context_Run(ContextPtr ctxptr, const char* code, const char* filename) {
-		Context* ctx = static_cast<Context*>(ctxptr);
-		v8::Isolate* isolate = ctx->isolate;
-		v8::Locker locker(isolate);
+std::mutex mtx;
+
+void log_warning(const char* msg) {
+	std::cout << "Warning: " << msg << "\n"; // TODO: implement some other kind of logging mechanism
+}
+
+// based on v8-8.0.426\v8\src\snapshot\snapshot-common.cc RunExtraCode
+bool RunExtraCode(v8::Isolate* isolate, v8::Local<v8::Context> context,
+	const char* utf8_source, const char* name) {
+	v8::Context::Scope context_scope(context);
+	v8::TryCatch try_catch(isolate);
+	v8::Local<v8::String> source_string;
+	if (!v8::String::NewFromUtf8(isolate, utf8_source, v8::NewStringType::kNormal)
+		.ToLocal(&source_string)) {
+		return false;
+	}
+	v8::Local<v8::String> resource_name =
+		v8::String::NewFromUtf8(isolate, name, v8::NewStringType::kNormal)
+		.ToLocalChecked();
+	v8::ScriptOrigin origin(resource_name);
+	v8::ScriptCompiler::Source source(source_string, origin);
+	v8::Local<v8::Script> script;
+	if (!v8::ScriptCompiler::Compile(context, &source).ToLocal(&script))
+		return false;
+	if (script->Run(context).IsEmpty()) return false;
+	if (try_catch.HasCaught()) return false; // TODO: or exit?
+	return true;
+}
+
+// Snapshot files start with this header, followed by the blob itself.
+typedef struct {
+	char magic[8];
+	int32_t v8_major, v8_minor, v8_build, v8_patch;
+	uint64_t checksum; // FNV-1a of the blob
+	uint64_t size;
+	char reserved[24]; // pads the header to 64 bytes, which keeps the blob aligned
+} SnapshotFileHeader;
+
+static_assert(sizeof(SnapshotFileHeader) == 64, "snapshot file header must be 64 bytes");
+
+const char kSnapshotFileMagic[8] = { 'V', '8', 'G', 'O', 'S', 'N', 'A', 'P' };
+
+uint64_t HashBytes(const char* data, size_t len) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+GoResolveModuleHandlerPtr go_resolve_module_handler = nullptr;
+
+// The context whose module graph is being instantiated on this thread. The
+// resolve callback only gets the v8::Context.
+thread_local Context* instantiating_context_ = nullptr;
+// The names of the modules that the resolve callback has compiled and added
+// to instantiating_context_, which are removed again if instantiation fails.
+thread_local std::vector<std::string>* resolved_modules_ = nullptr;
+
+void ResetModules(Context* ctx) {
+	ctx->modules.clear();
+	ctx->module_names.clear();
+}
+
+void AddModule(Context* ctx, const std::string& name, v8::Local<v8::Module> module) {
+	ctx->modules[name].Reset(ctx->isolate, module);
+	ctx->module_names.emplace(module->GetIdentityHash(), name);
+}
+
+void RemoveModule(Context* ctx, const std::string& name, v8::Local<v8::Module> module) {
+	ctx->modules.erase(name);
+	auto range = ctx->module_names.equal_range(module->GetIdentityHash());
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second == name) {
+			ctx->module_names.erase(it);
+			break;
+		}
+	}
+}
+
+std::string ModuleName(Context* ctx, v8::Local<v8::Module> module) {
+	auto range = ctx->module_names.equal_range(module->GetIdentityHash());
+	for (auto it = range.first; it != range.second; ++it) {
+		if (ctx->modules[it->second].Get(ctx->isolate) == module) {
+			return it->second;
+		}
+	}
+	return "";
+}
+
+// Compiles a module, consuming the isolate's code cache for the same name and
+// source or adding to it. Must be called in a context scope and a TryCatch.
+v8::MaybeLocal<v8::Module> CompileModule(v8::Isolate* isolate, const std::string& name, const char* source, int source_len) {
+	IsolateData* data = GetIsolateData(isolate);
+
+	v8::Local<v8::String> name_local, source_local;
+	if (!v8::String::NewFromUtf8(isolate, name.data(), v8::NewStringType::kNormal, int(name.length())).ToLocal(&name_local) ||
+		!v8::String::NewFromUtf8(isolate, source, v8::NewStringType::kNormal, source_len).ToLocal(&source_local)) {
+		return v8::MaybeLocal<v8::Module>();
+	}
+
+	v8::ScriptOrigin origin(name_local,
+		v8::Local<v8::Integer>(), v8::Local<v8::Integer>(), v8::Local<v8::Boolean>(),
+		v8::Local<v8::Integer>(), v8::Local<v8::Value>(), v8::Local<v8::Boolean>(),
+		v8::Local<v8::Boolean>(), v8::True(isolate));
+
+	uint64_t source_hash = HashBytes(source, size_t(source_len));
+	auto cached = data->module_code_cache.find(name);
+	v8::ScriptCompiler::CachedData* cached_data = nullptr;
+	if (cached != data->module_code_cache.end() && cached->second.source_hash == source_hash) {
+		cached_data = new v8::ScriptCompiler::CachedData(
+			reinterpret_cast<const uint8_t*>(cached->second.data.data()), int(cached->second.data.length()));
+	}
+
+	v8::ScriptCompiler::Source src(source_local, origin, cached_data); // owns cached_data
+	v8::Local<v8::Module> module;
+	if (!v8::ScriptCompiler::CompileModule(isolate, &src, cached_data != nullptr ?
+		v8::ScriptCompiler::kConsumeCodeCache : v8::ScriptCompiler::kNoCompileOptions).ToLocal(&module)) {
+		return v8::MaybeLocal<v8::Module>();
+	}
+
+	if (cached_data != nullptr && !cached_data->rejected) {
+		data->module_cache_stats.hits++;
+		return module;
+	}
+	if (cached_data != nullptr) {
+		data->module_cache_stats.rejected++;
+	}
+	else {
+		data->module_cache_stats.misses++;
+	}
+
+	std::unique_ptr<v8::ScriptCompiler::CachedData> code_cache(
+		v8::ScriptCompiler::CreateCodeCache(module->GetUnboundModuleScript()));
+	if (code_cache) {
+		ModuleCodeCache& entry = data->module_code_cache[name];
+		entry.source_hash = source_hash;
+		entry.data.assign(reinterpret_cast<const char*>(code_cache->data), size_t(code_cache->length));
+	}
+	return module;
+}
+
+v8::MaybeLocal<v8::Module> ResolveModule(v8::Local<v8::Context> context, v8::Local<v8::String> specifier, v8::Local<v8::Module> referrer) {
+	v8::Isolate* isolate = context->GetIsolate();
+	Context* ctx = instantiating_context_;
+
+	if (go_resolve_module_handler == nullptr) {
+		isolate->ThrowException(v8::Exception::Error(
+			v8::String::NewFromUtf8(isolate, "Module resolve handler not init").ToLocalChecked()));
+		return v8::MaybeLocal<v8::Module>();
+	}
+
+	std::string specifier_str = str(isolate, specifier);
+	std::string referrer_str = ModuleName(ctx, referrer);
+	int go_context_id = context->GetEmbedderData(kGoContextIdIndex)->Int32Value(context).FromMaybe(0);
+
+	ResolvedModule resolved = go_resolve_module_handler(go_context_id,
+		String{ specifier_str.data(), int(specifier_str.length()) },
+		String{ referrer_str.data(), int(referrer_str.length()) });
+
+	std::string name(resolved.name.ptr != nullptr ? resolved.name.ptr : "", size_t(resolved.name.len));
+	v8::MaybeLocal<v8::Module> result;
+	if (resolved.error_msg.ptr != nullptr) {
+		isolate->ThrowException(v8::Exception::Error(v8::String::NewFromUtf8(isolate,
+			resolved.error_msg.ptr, v8::NewStringType::kNormal, resolved.error_msg.len).ToLocalChecked()));
+	}
+	else if (ctx->modules.count(name) > 0) {
+		result = ctx->modules[name].Get(isolate);
+	}
+	else {
+		v8::Local<v8::Module> module;
+		if (CompileModule(isolate, name, resolved.source.ptr, resolved.source.len).ToLocal(&module)) {
+			AddModule(ctx, name, module);
+			resolved_modules_->push_back(name);
+			result = module;
+		}
+	}
+
+	free(const_cast<char*>(resolved.name.ptr));
+	free(const_cast<char*>(resolved.source.ptr));
+	free(const_cast<char*>(resolved.error_msg.ptr));
+	return result;
+}
+
+// Must be called with mtx held. Returns an error message or nullptr.
+const char* MapSnapshotFile(const std::string& path, v8::StartupData* out) {
+	auto existing = mapped_snapshots_.find(path);
+	if (existing != mapped_snapshots_.end()) {
+		*out = existing->second;
+		return nullptr;
+	}
+
+	const char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	FILE* f = fopen(path.c_str(), "rb");
+	if (f == nullptr) {
+		return "Cannot open snapshot file";
+	}
+	fseek(f, 0, SEEK_END);
+	size = size_t(ftell(f));
+	fseek(f, 0, SEEK_SET);
+	char* buf = new char[size];
+	bool ok = fread(buf, 1, size, f) == size;
+	fclose(f);
+	if (!ok) {
+		delete[] buf;
+		return "Cannot read snapshot file";
+	}
+	data = buf;
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return "Cannot open snapshot file";
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return "Cannot stat snapshot file";
+	}
+	size = size_t(st.st_size);
+	void* mapped = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd); // the mapping stays valid
+	if (mapped == MAP_FAILED) {
+		return "Cannot map snapshot file";
+	}
+	data = static_cast<const char*>(mapped);
+#endif
+
+	const char* err = nullptr;
+	const SnapshotFileHeader* header = reinterpret_cast<const SnapshotFileHeader*>(data);
+	if (size < sizeof(SnapshotFileHeader) || memcmp(header->magic, kSnapshotFileMagic, sizeof(kSnapshotFileMagic)) != 0) {
+		err = "Not a snapshot file";
+	}
+	else if (header->v8_major != V8_MAJOR_VERSION || header->v8_minor != V8_MINOR_VERSION ||
+		header->v8_build != V8_BUILD_NUMBER || header->v8_patch != V8_PATCH_LEVEL) {
+		err = "Snapshot file was created by a different V8 version";
+	}
+	else if (header->size != size - sizeof(SnapshotFileHeader)) {
+		err = "Snapshot file is truncated";
+	}
+	else if (header->checksum != HashBytes(data + sizeof(SnapshotFileHeader), size_t(header->size))) {
+		err = "Snapshot file checksum mismatch";
+	}
+
+	if (err != nullptr) {
+#ifdef _WIN32
+		delete[] data;
+#else
+		munmap(const_cast<char*>(data), size);
+#endif
+		return err;
+	}
+
+	v8::StartupData blob;
+	blob.data = data + sizeof(SnapshotFileHeader);
+	blob.raw_size = int(header->size);
+	mapped_snapshots_[path] = blob;
+	*out = blob;
+	return nullptr;
+}
+
+// Returns the default snapshot or nullptr if V8's built-in snapshot should
+// be used.
+v8::StartupData* GetDefaultSnapshot() {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	// if snapshot has not been loaded in memory yet
+	if (!default_snapshot_loaded_) {
+		default_snapshot_loaded_ = true; // do not try to load it again
+
+#ifdef _WIN32
+		HMODULE hModule = GetModuleHandle(L"V8CBRIDGE.dll");
+		HRSRC hResInfo = FindResource(hModule, MAKEINTRESOURCE(IDR_SNAPSHOT1), L"snapshot"); // obtain handle of the resource
+		if (hResInfo != 0) {
+			HGLOBAL hResData = LoadResource(hModule, hResInfo); // Load the resource
+			if (hResData != 0) {
+				// Resources stay loaded for the lifetime of the module, so the
+				// data doesn't need to be copied.
+				default_snapshot_.data = static_cast<const char*>(LockResource(hResData));
+				default_snapshot_.raw_size = int(SizeofResource(hModule, hResInfo));
+			}
+		}
+#endif
+
+		if (default_snapshot_.data == nullptr && !default_snapshot_file_.empty()) {
+			// Reported by v8_Init; isolates use V8's built-in snapshot instead.
+			default_snapshot_error_ = MapSnapshotFile(default_snapshot_file_, &default_snapshot_);
+		}
+	}
+
+	if (default_snapshot_.data == nullptr) {
+		return nullptr;
+	}
+	return &default_snapshot_;
+}
+
+// Calls the Go interceptor of the object wrapping a Go value for a named or
+// indexed property, or to enumerate them (name is empty). Returns true if Go intercepted
+// the operation, with its result in *result unless that is nullptr. Errors
+// are thrown as exceptions.
+bool CallGoInterceptor(v8::Isolate* isolate, v8::Local<v8::Object> holder, InterceptOp op, bool indexed,
+	v8::Local<v8::Name> name, uint32_t index, v8::Local<v8::Value> value, v8::Local<v8::Value>* result) {
+	ISOLATE_STAT(isolate, kStatGoInterceptor);
+	if (go_interceptor_handler == nullptr) {
+		isolate->ThrowException(v8::Exception::Error(
+			v8::String::NewFromUtf8(isolate, "Interceptor handler not init").ToLocalChecked()));
+		return false;
+	}
+
+	std::string key;
+	if (!name.IsEmpty()) {
+		key = str(isolate, name);
+	}
+	ValueTuple arg = { nullptr, 0, nullptr };
+	if (!value.IsEmpty()) {
+		// The Go side owns the handle of the new value.
+		arg = { NewValue(isolate, FindContext(isolate, CurrentGoContextId(isolate)), value),
+			v8_Value_KindsFromLocal(value), nullptr };
+	}
+
+	int intercepted = 0;
+	ValueTuple res = go_interceptor_handler(CurrentGoContextId(isolate), WrappedHandle(holder), op,
+		String{ indexed ? nullptr : key.data(), int(key.length()) }, index,
+		value.IsEmpty() ? nullptr : &arg, &intercepted);
+
+	if (res.error_msg.ptr != nullptr) {
+		isolate->ThrowException(v8::Exception::Error(
+			v8::String::NewFromUtf8(isolate, res.error_msg.ptr, v8::NewStringType::kNormal,
+				res.error_msg.len).ToLocalChecked()));
+		free((void*)res.error_msg.ptr);
+		return false;
+	}
+	if (intercepted && result != nullptr) {
+		if (res.Value == nullptr) {
+			*result = v8::Undefined(isolate);
+		}
+		else {
+			*result = static_cast<Value*>(res.Value)->Get(isolate);
+		}
+	}
+	return intercepted != 0;
+}
+
+void NamedGetter(v8::Local<v8::Name> name, const v8::PropertyCallbackInfo<v8::Value>& info) {
+	v8::Local<v8::Value> result;
+	if (CallGoInterceptor(info.GetIsolate(), info.Holder(), kInterceptGet, false, name, 0,
+		v8::Local<v8::Value>(), &result)) {
+		info.GetReturnValue().Set(result);
+	}
+}
+
+void NamedSetter(v8::Local<v8::Name> name, v8::Local<v8::Value> value,
+	const v8::PropertyCallbackInfo<v8::Value>& info) {
+	if (CallGoInterceptor(info.GetIsolate(), info.Holder(), kInterceptSet, false, name, 0, value, nullptr)) {
+		info.GetReturnValue().Set(value);
+	}
+}
+
+void NamedQuery(v8::Local<v8::Name> name, const v8::PropertyCallbackInfo<v8::Integer>& info) {
+	if (CallGoInterceptor(info.GetIsolate(), info.Holder(), kInterceptQuery, false, name, 0,
+		v8::Local<v8::Value>(), nullptr)) {
+		info.GetReturnValue().Set(v8::Integer::New(info.GetIsolate(), v8::None));
+	}
+}
+
+void NamedEnumerator(const v8::PropertyCallbackInfo<v8::Array>& info) {
+	v8::Local<v8::Value> result;
+	if (CallGoInterceptor(info.GetIsolate(), info.Holder(), kInterceptEnumerate, false, v8::Local<v8::Name>(), 0,
+		v8::Local<v8::Value>(), &result) && result->IsArray()) {
+		info.GetReturnValue().Set(result.As<v8::Array>());
+	}
+}
+
+void IndexedGetter(uint32_t index, const v8::PropertyCallbackInfo<v8::Value>& info) {
+	v8::Local<v8::Value> result;
+	if (CallGoInterceptor(info.GetIsolate(), info.Holder(), kInterceptGet, true, v8::Local<v8::Name>(), index,
+		v8::Local<v8::Value>(), &result)) {
+		info.GetReturnValue().Set(result);
+	}
+}
+
+void IndexedSetter(uint32_t index, v8::Local<v8::Value> value, const v8::PropertyCallbackInfo<v8::Value>& info) {
+	if (CallGoInterceptor(info.GetIsolate(), info.Holder(), kInterceptSet, true, v8::Local<v8::Name>(), index,
+		value, nullptr)) {
+		info.GetReturnValue().Set(value);
+	}
+}
+
+void IndexedQuery(uint32_t index, const v8::PropertyCallbackInfo<v8::Integer>& info) {
+	if (CallGoInterceptor(info.GetIsolate(), info.Holder(), kInterceptQuery, true, v8::Local<v8::Name>(), index,
+		v8::Local<v8::Value>(), nullptr)) {
+		info.GetReturnValue().Set(v8::Integer::New(info.GetIsolate(), v8::None));
+	}
+}
+
+void IndexedEnumerator(const v8::PropertyCallbackInfo<v8::Array>& info) {
+	v8::Local<v8::Value> result;
+	if (CallGoInterceptor(info.GetIsolate(), info.Holder(), kInterceptEnumerate, true, v8::Local<v8::Name>(), 0,
+		v8::Local<v8::Value>(), &result) && result->IsArray()) {
+		info.GetReturnValue().Set(result.As<v8::Array>());
+	}
+}
+
+// Must be called with the isolate locked and a HandleScope. Templates are
+// created once per isolate and combination of flags.
+v8::Local<v8::ObjectTemplate> GetInterceptorTemplate(v8::Isolate* isolate, int flags) {
+	v8::Global<v8::ObjectTemplate>& cached = GetIsolateData(isolate)->interceptor_templates[flags & (kInterceptNamed | kInterceptIndexed)];
+	if (cached.IsEmpty()) {
+		v8::Local<v8::ObjectTemplate> templ = v8::ObjectTemplate::New(isolate);
+		templ->SetInternalFieldCount(1); // the handle of the Go value
+		if (flags & kInterceptNamed) {
+			// Symbols such as Symbol.toPrimitive are left to the prototype.
+			templ->SetHandler(v8::NamedPropertyHandlerConfiguration(NamedGetter, NamedSetter, NamedQuery,
+				nullptr, NamedEnumerator, v8::Local<v8::Value>(), v8::PropertyHandlerFlags::kOnlyInterceptStrings));
+		}
+		if (flags & kInterceptIndexed) {
+			templ->SetHandler(v8::IndexedPropertyHandlerConfiguration(IndexedGetter, IndexedSetter, IndexedQuery,
+				nullptr, IndexedEnumerator));
+		}
+		cached.Reset(isolate, templ);
+	}
+	return cached.Get(isolate);
+}
+
+extern "C" {
+
+	V8CBRIDGE_API GoCallbackHandlerPtr go_callback_handler = nullptr;
+
+	V8CBRIDGE_API void v8_SetModuleResolveHandler(GoResolveModuleHandlerPtr handler) {
+		go_resolve_module_handler = handler;
+	}
+
+	V8CBRIDGE_API void v8_SetWrapHandlers(GoAccessorHandlerPtr accessor_handler,
+		GoInterceptorHandlerPtr interceptor_handler, GoReleaseHandlePtr release_handler) {
+		go_accessor_handler = accessor_handler;
+		go_interceptor_handler = interceptor_handler;
+		go_release_handle = release_handler;
+	}
+
+	V8CBRIDGE_API void v8_SetConsoleFlushHandler(GoConsoleFlushHandlerPtr handler) {
+		go_console_flush_handler = handler;
+	}
+
+	V8CBRIDGE_API Version version = { V8_MAJOR_VERSION, V8_MINOR_VERSION, V8_BUILD_NUMBER, V8_PATCH_LEVEL };
+
+	V8CBRIDGE_API Error v8_Init(GoCallbackHandlerPtr callback_handler, const char* icu_data_file,
+		int thread_pool_size, int idle_task_support, const char* snapshot_file) {
+
+		mtx.lock();
+
+		//init only once
+		if (platform_ != nullptr) {
+			mtx.unlock();
+			return Error{ nullptr, 0 };
+		}
+
+		//const char* path
+		//v8::V8::InitializeICUDefaultLocation(path);
+		//v8::V8::InitializeExternalStartupData(path);
+
+		idle_task_support_ = idle_task_support != 0;
+		platform_ = v8::platform::NewDefaultPlatform(
+			thread_pool_size, // 0 means the number of cores
+			idle_task_support_ ? v8::platform::IdleTaskSupport::kEnabled : v8::platform::IdleTaskSupport::kDisabled,
+			v8::platform::InProcessStackDumping::kEnabled);
+		v8::V8::InitializePlatform(platform_.get());
+		v8::V8::Initialize();
+
+		if (!v8::V8::InitializeICU(icu_data_file)) {
+			log_warning("V8 ICU not initialized");
+		}
+
+		go_callback_handler = callback_handler;
+
+		if (snapshot_file != nullptr) {
+			default_snapshot_file_ = snapshot_file;
+		}
+
+		mtx.unlock();
+
+		// Map the default snapshot now rather than on the first isolate.
+		GetDefaultSnapshot();
+		if (default_snapshot_error_ != nullptr) {
+			return DupString(default_snapshot_error_);
+		}
+		return Error{ nullptr, 0 };
+	}
+
+	V8CBRIDGE_API void v8_Free(void* ptr) {
+		free(ptr);
+	}
+
+	V8CBRIDGE_API void v8_Exception_Release(Exception* exception) {
+		if (exception == nullptr) {
+			return;
+		}
+		free(const_cast<char*>(exception->Text.ptr));
+		free(const_cast<char*>(exception->Filename.ptr));
+		free(const_cast<char*>(exception->SourceLine.ptr));
+		for (int i = 0; i < exception->FrameCount; i++) {
+			free(const_cast<char*>(exception->Frames[i].Funcname.ptr));
+			free(const_cast<char*>(exception->Frames[i].Filename.ptr));
+		}
+		free(exception->Frames);
+		free(exception);
+	}
+
+	// If startup_data is null then snapshot will be loaded from resources.
+	V8CBRIDGE_API extern StartupData v8_CreateSnapshotDataBlob(const char* js, int include_compiled_fn_code, StartupData* startup_data) {
+
+		//Based on v8-8.0.426\v8\src\snapshot\snapshot-common.cc CreateSnapshotDataBlobInternal
+
+		v8::StartupData existing_blob_data;
+		v8::StartupData* existing_blob;
+
+		// if snapshot passed use that
+		if (startup_data != nullptr) {
+			existing_blob_data.data = startup_data->ptr;
+			existing_blob_data.raw_size = startup_data->len;
+			existing_blob = &existing_blob_data;
+		}
+		else {
+			existing_blob = GetDefaultSnapshot();
+		}
+
+		// If no isolate is passed in, create it (and a new context) from scratch.
+		v8::Isolate* isolate = isolate = v8::Isolate::Allocate();		
+
+		//TODO: important - what are these and are these needed?
+		v8::Locker locker(isolate);                            /* Lock to current thread.        */ \
+		v8::Isolate::Scope isolate_scope(isolate);             /* Assign isolate to this thread. */
+
+		// Optionally run a script to embed, and serialize to create a snapshot blob.
+		v8::SnapshotCreator snapshot_creator(isolate, external_references, existing_blob);
+		{
+			v8::HandleScope scope(isolate);
+			v8::Local<v8::Context> context = v8::Context::New(isolate);
+			if (js != nullptr &&
+				!RunExtraCode(isolate, context, js, "<embedded>")) {
+				return {};
+			}
+			snapshot_creator.SetDefaultContext(context);
+		}
+
+		v8::StartupData data = snapshot_creator.CreateBlob(include_compiled_fn_code ? v8::SnapshotCreator::FunctionCodeHandling::kKeep : v8::SnapshotCreator::FunctionCodeHandling::kClear);
+
+		return StartupData{ data.data, data.raw_size };
+	}
+
+	V8CBRIDGE_API SnapshotCreatorPtr v8_SnapshotCreator_New(StartupData* startup_data) {
+		SnapshotCreator* creator = new SnapshotCreator;
+
+		v8::StartupData* existing_blob = &creator->existing_blob;
+		if (startup_data != nullptr) {
+			creator->existing_blob.data = startup_data->ptr;
+			creator->existing_blob.raw_size = startup_data->len;
+		}
+		else if (v8::StartupData* default_snapshot = GetDefaultSnapshot()) {
+			creator->existing_blob = *default_snapshot;
+		}
+		else {
+			existing_blob = nullptr;
+		}
+
+		creator->creator = new v8::SnapshotCreator(external_references, existing_blob);
+		// The creator has entered its isolate on this thread; keep it locked
+		// here until the blob is created.
+		creator->locker = new v8::Locker(creator->creator->GetIsolate());
+		// The allocator is owned by the creator.
+		NewIsolateData(creator->creator->GetIsolate(), nullptr);
+		creator->creator->GetIsolate()->SetCaptureStackTraceForUncaughtExceptions(true);
+		return creator;
+	}
+
+	V8CBRIDGE_API IsolatePtr v8_SnapshotCreator_Isolate(SnapshotCreatorPtr creatorptr) {
+		return static_cast<SnapshotCreator*>(creatorptr)->creator->GetIsolate();
+	}
+
+	V8CBRIDGE_API int v8_SnapshotCreator_AddContext(SnapshotCreatorPtr creatorptr, ContextPtr ctxptr) {
+		CONTEXT_STAT(ctxptr, kStatSnapshotCreatorAddContext);
+		SnapshotCreator* creator = static_cast<SnapshotCreator*>(creatorptr);
+		VALUE_SCOPE(ctxptr);
+		return int(creator->creator->AddContext(ctx));
+	}
+
+	// All contexts of the creator must have been released before this is called.
+	V8CBRIDGE_API StartupData v8_SnapshotCreator_Create(SnapshotCreatorPtr creatorptr, int include_compiled_fn_code) {
+		SnapshotCreator* creator = static_cast<SnapshotCreator*>(creatorptr);
+		v8::Isolate* isolate = creator->creator->GetIsolate();
+
+		// The blob can't be created while the bridge still holds handles.
+		IsolateData* isolate_data = GetIsolateData(isolate);
+		ResetIsolateData(isolate_data);
+		delete isolate_data;
+		isolate->SetData(0, nullptr);
+
+		{
+			v8::HandleScope scope(isolate);
+			creator->creator->SetDefaultContext(v8::Context::New(isolate));
+		}
+
+		v8::StartupData data = creator->creator->CreateBlob(include_compiled_fn_code ?
+			v8::SnapshotCreator::FunctionCodeHandling::kKeep : v8::SnapshotCreator::FunctionCodeHandling::kClear);
+
+		delete creator->locker;
+		delete creator->creator;
+		delete creator;
+
+		return StartupData{ data.data, data.raw_size };
+	}
+
+	// If StartupData is null then the default snapshot will be used (from
+	// the resources or the snapshot file passed to v8_Init). The passed
+	// snapshot data must stay valid until the isolate is released.
+	V8CBRIDGE_API IsolatePtr v8_Isolate_New(StartupData* data) {
+		v8::Isolate::CreateParams create_params;
+		create_params.array_buffer_allocator = v8::ArrayBuffer::Allocator::NewDefaultAllocator();
+		create_params.external_references = external_references;
+
+		// Allocate the isolate first so that the snapshot referenced by
+		// create_params lives in its data.
+		v8::Isolate* isolate = v8::Isolate::Allocate();
+		IsolateData* isolate_data = NewIsolateData(isolate, create_params.array_buffer_allocator);
+
+		// if snapshot passed use that
+		if (data != nullptr) {
+			isolate_data->snapshot.data = data->ptr;
+			isolate_data->snapshot.raw_size = data->len;
+			create_params.snapshot_blob = &isolate_data->snapshot;
+		}
+		else if (v8::StartupData* default_snapshot = GetDefaultSnapshot()) {
+			isolate_data->snapshot = *default_snapshot;
+			create_params.snapshot_blob = &isolate_data->snapshot;
+		}
+
+		v8::Isolate::Initialize(isolate, create_params);
+		isolate->SetCaptureStackTraceForUncaughtExceptions(true);
+		return isolate;
+	}
+
+	V8CBRIDGE_API ContextPtr v8_Isolate_NewContext(IsolatePtr isolate_ptr, int go_context_id) {
+		ISOLATE_STAT(static_cast<v8::Isolate*>(isolate_ptr), kStatIsolateNewContext);
+		ISOLATE_SCOPE(static_cast<v8::Isolate*>(isolate_ptr));
+		v8::HandleScope handle_scope(isolate);
+
+		v8::Local<v8::Context> local_ctx = v8::Context::New(isolate, nullptr, GetGlobalTemplate(isolate));
+		return NewContextFromLocal(isolate, local_ctx, go_context_id);
+	}
+
+	V8CBRIDGE_API Error v8_Isolate_SetGlobalValue(IsolatePtr isolate_ptr, const char* name, ImmediateValue val) {
+		ISOLATE_STAT(static_cast<v8::Isolate*>(isolate_ptr), kStatIsolateSetGlobalValue);
+		ISOLATE_SCOPE(static_cast<v8::Isolate*>(isolate_ptr));
+		v8::HandleScope handle_scope(isolate);
+
+		v8::Local<v8::Data> value;
+		switch (val.Type) {
+		case tBOOL:      value = v8::Boolean::New(isolate, val.Bool == 1); break;
+		case tFLOAT64:   value = v8::Number::New(isolate, val.Float64); break;
+		case tINT64:     value = v8::Number::New(isolate, double(val.Int64)); break;
+		case tBIGINT:    value = v8::BigInt::New(isolate, val.Int64); break;
+		case tBIGUINT:   value = v8::BigInt::NewFromUnsigned(isolate, uint64_t(val.Int64)); break;
+		case tUNDEFINED: value = v8::Undefined(isolate); break;
+		case tSTRING: {
+			v8::Local<v8::String> str;
+			if (!v8::String::NewFromUtf8(isolate, val.Mem.ptr, v8::NewStringType::kNormal, val.Mem.len).ToLocal(&str)) {
+				return DupString("Cannot create string");
+			}
+			value = str;
+			break;
+		}
+		default:
+			return DupString("Only primitive values can be set on the global template");
+		}
+
+		SetGlobalProperty(isolate, name, value);
+		return Error{ nullptr, 0 };
+	}
+
+	V8CBRIDGE_API void v8_Isolate_SetGlobalCallback(IsolatePtr isolate_ptr, const char* name, const char* id) {
+		ISOLATE_STAT(static_cast<v8::Isolate*>(isolate_ptr), kStatIsolateSetGlobalCallback);
+		ISOLATE_SCOPE(static_cast<v8::Isolate*>(isolate_ptr));
+		v8::HandleScope handle_scope(isolate);
+
+		v8::Local<v8::FunctionTemplate> cb = v8::FunctionTemplate::New(isolate,
+			static_cast<v8::FunctionCallback>(go_callback),
+			v8::String::NewFromUtf8(isolate, id).ToLocalChecked());
+		cb->SetClassName(v8::String::NewFromUtf8(isolate, name).ToLocalChecked());
+		SetGlobalProperty(isolate, name, cb);
+	}
+
+	V8CBRIDGE_API ContextPtr v8_Isolate_NewContextFromSnapshot(IsolatePtr isolate_ptr, int index, int go_context_id) {
+		ISOLATE_STAT(static_cast<v8::Isolate*>(isolate_ptr), kStatIsolateNewContextFromSnapshot);
+		ISOLATE_SCOPE(static_cast<v8::Isolate*>(isolate_ptr));
+		v8::HandleScope handle_scope(isolate);
+
+		v8::Local<v8::Context> local_ctx;
+		if (!v8::Context::FromSnapshot(isolate, size_t(index)).ToLocal(&local_ctx)) {
+			return nullptr;
+		}
+		return NewContextFromLocal(isolate, local_ctx, go_context_id);
+	}
+	V8CBRIDGE_API void v8_Isolate_Terminate(IsolatePtr isolate_ptr) {
+		v8::Isolate* isolate = static_cast<v8::Isolate*>(isolate_ptr);
+		ISOLATE_STAT(isolate, kStatIsolateTerminate);
+		isolate->TerminateExecution();
+	}
+	V8CBRIDGE_API void v8_Isolate_Release(IsolatePtr isolate_ptr) {
+		if (isolate_ptr == nullptr) {
+			return;
+		}
+		v8::Isolate* isolate = static_cast<v8::Isolate*>(isolate_ptr);
+		IsolateData* isolate_data = GetIsolateData(isolate);
+		if (isolate_data != nullptr) {
+			v8::Locker locker(isolate);
+			ResetIsolateData(isolate_data);
+		}
+		isolate->Dispose();
+		if (isolate_data != nullptr) {
+			delete isolate_data->allocator;
+			delete isolate_data;
+		}
+	}
+
+	V8CBRIDGE_API Error v8_Snapshot_WriteFile(const char* path, StartupData data) {
+		SnapshotFileHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, kSnapshotFileMagic, sizeof(kSnapshotFileMagic));
+		header.v8_major = V8_MAJOR_VERSION;
+		header.v8_minor = V8_MINOR_VERSION;
+		header.v8_build = V8_BUILD_NUMBER;
+		header.v8_patch = V8_PATCH_LEVEL;
+		header.checksum = HashBytes(data.ptr, size_t(data.len));
+		header.size = uint64_t(data.len);
+
+		FILE* f = fopen(path, "wb");
+		if (f == nullptr) {
+			return DupString("Cannot create snapshot file");
+		}
+		bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+			(data.len == 0 || fwrite(data.ptr, size_t(data.len), 1, f) == 1);
+		ok = fclose(f) == 0 && ok;
+		if (!ok) {
+			return DupString("Cannot write snapshot file");
+		}
+		return Error{ nullptr, 0 };
+	}
+
+	V8CBRIDGE_API Error v8_Snapshot_MapFile(const char* path, StartupData* out) {
+		std::lock_guard<std::mutex> lock(mtx);
+		v8::StartupData blob;
+		const char* err = MapSnapshotFile(path, &blob);
+		if (err != nullptr) {
+			return DupString(err);
+		}
+		out->ptr = blob.data;
+		out->len = blob.raw_size;
+		return Error{ nullptr, 0 };
+	}
+
+	V8CBRIDGE_API ValueTuple v8_Context_Run(ContextPtr ctxptr, const char* code, const char* filename) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContext<ValueTuple>());
+		CONTEXT_STAT(ctxptr, kStatContextRun);
+		bridge_timer.AddBytes(strlen(code));
+		Context* ctx = static_cast<Context*>(ctxptr);
+		v8::Isolate* isolate = ctx->isolate;
+		v8::Locker locker(isolate);
 		v8::Isolate::Scope isolate_scope(isolate);
 		v8::HandleScope handle_scope(isolate);
 		v8::Local<v8::Context> localCtx = ctx->ptr.Get(isolate);
@@ -432,14 +1893,13 @@ extern "C" {
 			&origin);
 
 		if (script.IsEmpty()) {
-			res.error_msg = DupString(report_exception(isolate, ctx->ptr.Get(isolate), try_catch));
-			return res;
+			return ExceptionResult(ctxptr, localCtx, try_catch);
 		}
 
 		v8::MaybeLocal<v8::Value> result = script.ToLocalChecked()->Run(localCtx);
 
 		if (result.IsEmpty()) {
-			res.error_msg = DupString(report_exception(isolate, ctx->ptr.Get(isolate), try_catch));
+			res = ExceptionResult(ctxptr, localCtx, try_catch);
 		}
 		else {
 			/*
@@ -476,22 +1936,298 @@ extern "C" {
 				*/
 
 				res.Kinds = v8_Value_KindsFromLocal(resultChecked);
-				res.Value = static_cast<PersistentValuePtr>(new Value(isolate, resultChecked));
+				res.Value = static_cast<PersistentValuePtr>(NewValue(ctxptr, resultChecked));
+
+			}
+
+		}
+
+		return res;
+	}
+
+	V8CBRIDGE_API ValueTuple v8_Context_EvalModule(ContextPtr ctxptr, const char* name, const char* source) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContext<ValueTuple>());
+		CONTEXT_STAT(ctxptr, kStatContextEvalModule);
+		bridge_timer.AddBytes(strlen(source));
+		VALUE_SCOPE(ctxptr);
+		Context* context = static_cast<Context*>(ctxptr);
+		v8::TryCatch try_catch(isolate);
+		try_catch.SetVerbose(false);
+
+		ValueTuple res = { nullptr, 0, nullptr };
+		std::string name_str(name);
 
+		v8::Local<v8::Module> module;
+		auto existing = context->modules.find(name_str);
+		if (existing != context->modules.end()) {
+			module = existing->second.Get(isolate);
+		}
+		else if (CompileModule(isolate, name_str, source, int(strlen(source))).ToLocal(&module)) {
+			AddModule(context, name_str, module);
+		}
+		else {
+			return ExceptionResult(ctxptr, ctx, try_catch);
+		}
+
+		if (module->GetStatus() == v8::Module::kUninstantiated) {
+			Context* outer = instantiating_context_;
+			std::vector<std::string>* outer_resolved = resolved_modules_;
+			std::vector<std::string> resolved;
+			instantiating_context_ = context;
+			resolved_modules_ = &resolved;
+			v8::Maybe<bool> instantiated = module->InstantiateModule(ctx, ResolveModule);
+			instantiating_context_ = outer;
+			resolved_modules_ = outer_resolved;
+
+			if (instantiated.IsNothing() || !instantiated.FromJust()) {
+				// Allow another attempt, e.g. once the missing imports exist.
+				// The dependencies resolved by this attempt are left
+				// uninstantiated and would be reused as they are, so they are
+				// resolved again too.
+				RemoveModule(context, name_str, module);
+				for (const std::string& dep : resolved) {
+					auto it = context->modules.find(dep);
+					if (it == context->modules.end()) {
+						continue;
+					}
+					v8::Local<v8::Module> dep_module = it->second.Get(isolate);
+					if (dep_module->GetStatus() == v8::Module::kUninstantiated) {
+						RemoveModule(context, dep, dep_module);
+					}
+				}
+				return ExceptionResult(ctxptr, ctx, try_catch);
 			}
+		}
+
+		if (module->GetStatus() == v8::Module::kErrored) {
+			res.error_msg = DupString(("Uncaught exception: " + str(isolate, module->GetException())).c_str());
+			return res;
+		}
+
+		if (module->GetStatus() != v8::Module::kEvaluated && module->Evaluate(ctx).IsEmpty()) {
+			return ExceptionResult(ctxptr, ctx, try_catch);
+		}
+
+		v8::Local<v8::Value> ns = module->GetModuleNamespace();
+		res.Kinds = v8_Value_KindsFromLocal(ns);
+		res.Value = static_cast<PersistentValuePtr>(NewValue(ctxptr, ns));
+		return res;
+	}
+
+	V8CBRIDGE_API ScriptStreamPtr v8_Context_StartStreaming(ContextPtr ctxptr) {
+		RETURN_IF_RELEASED(ctxptr, nullptr);
+		CONTEXT_STAT(ctxptr, kStatContextStartStreaming);
+		VALUE_SCOPE(ctxptr);
+
+		StreamingScript* streaming = new StreamingScript;
+		streaming->isolate = isolate;
+		streaming->stream = new ScriptStream;
+		streaming->source.reset(new v8::ScriptCompiler::StreamedSource(
+			std::unique_ptr<v8::ScriptCompiler::ExternalSourceStream>(streaming->stream),
+			v8::ScriptCompiler::StreamedSource::UTF8));
+		streaming->task.reset(
+			v8::ScriptCompiler::StartStreamingScript(isolate, streaming->source.get()));
+		return streaming;
+	}
+
+	V8CBRIDGE_API void v8_ScriptStream_Push(ScriptStreamPtr streamptr, const char* data, int len) {
+		StreamingScript* streaming = static_cast<StreamingScript*>(streamptr);
+		ISOLATE_STAT(streaming->isolate, kStatScriptStreamPush);
+		bridge_timer.AddBytes(size_t(len));
+		streaming->stream->Push(data, len);
+	}
+
+	V8CBRIDGE_API void v8_ScriptStream_Close(ScriptStreamPtr streamptr) {
+		StreamingScript* streaming = static_cast<StreamingScript*>(streamptr);
+		ISOLATE_STAT(streaming->isolate, kStatScriptStreamClose);
+		streaming->stream->Close();
+	}
+
+	// Does not take the isolate lock: this runs on a background thread while
+	// the isolate is free to be used by others.
+	V8CBRIDGE_API void v8_ScriptStream_Run(ScriptStreamPtr streamptr) {
+		StreamingScript* streaming = static_cast<StreamingScript*>(streamptr);
+		ISOLATE_STAT(streaming->isolate, kStatScriptStreamRun);
+		if (streaming->task != nullptr) {
+			streaming->task->Run();
+		}
+	}
 
+	V8CBRIDGE_API ScriptTuple v8_ScriptStream_Compile(ContextPtr ctxptr, ScriptStreamPtr streamptr,
+		const char* filename) {
+		if (ctxptr == nullptr) {
+			// The context was released while the source was streamed.
+			v8_ScriptStream_Release(streamptr);
+			return ReleasedContext<ScriptTuple>();
 		}
+		CONTEXT_STAT(ctxptr, kStatScriptStreamCompile);
+		StreamingScript* streaming = static_cast<StreamingScript*>(streamptr);
+		ScriptTuple res = { nullptr, nullptr };
+		{
+			VALUE_SCOPE(ctxptr);
+			v8::TryCatch try_catch(isolate);
+			try_catch.SetVerbose(false);
+
+			filename = filename ? filename : "(no file)";
+			v8::ScriptOrigin origin(v8::String::NewFromUtf8(isolate, filename).ToLocalChecked());
+
+			const std::string& code = streaming->stream->source();
+			v8::Local<v8::String> full_source;
+			if (!v8::String::NewFromUtf8(isolate, code.data(), v8::NewStringType::kNormal,
+				int(code.size())).ToLocal(&full_source)) {
+				res.error_msg = DupString("Script source is too large.");
+			}
+			else {
+				v8::MaybeLocal<v8::Script> script;
+				if (streaming->task != nullptr) {
+					script = v8::ScriptCompiler::Compile(ctx, streaming->source.get(), full_source, origin);
+				}
+				else {
+					script = v8::Script::Compile(ctx, full_source, &origin);
+				}
 
+				if (script.IsEmpty()) {
+					res.error_msg = DupString(report_exception(isolate, ctx, try_catch));
+				}
+				else {
+					res.Script = new Script(isolate, script.ToLocalChecked());
+				}
+			}
+		}
+		v8_ScriptStream_Release(streamptr);
 		return res;
 	}
 
+	V8CBRIDGE_API void v8_ScriptStream_Release(ScriptStreamPtr streamptr) {
+		if (streamptr == nullptr) {
+			return;
+		}
+		StreamingScript* streaming = static_cast<StreamingScript*>(streamptr);
+		ISOLATE_STAT(streaming->isolate, kStatScriptStreamRelease);
+		ISOLATE_SCOPE(streaming->isolate);
+		delete streaming;
+	}
+
+	V8CBRIDGE_API ValueTuple v8_Script_Run(ContextPtr ctxptr, ScriptPtr scriptptr) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContext<ValueTuple>());
+		CONTEXT_STAT(ctxptr, kStatScriptRun);
+		VALUE_SCOPE(ctxptr);
+		v8::TryCatch try_catch(isolate);
+		try_catch.SetVerbose(false);
+
+		v8::Local<v8::Script> script = static_cast<Script*>(scriptptr)->Get(isolate);
+		v8::MaybeLocal<v8::Value> result = script->Run(ctx);
+
+		v8::Local<v8::Value> value;
+		if (!result.ToLocal(&value)) {
+			return ExceptionResult(ctxptr, ctx, try_catch);
+		}
+		return ValueTuple{ NewValue(ctxptr, value), v8_Value_KindsFromLocal(value), nullptr };
+	}
+
+	V8CBRIDGE_API void v8_Script_Release(IsolatePtr isolate_ptr, ScriptPtr scriptptr) {
+		if (scriptptr == nullptr || isolate_ptr == nullptr) {
+			return;
+		}
+
+		// Scripts outlive their context, whose compiled code they keep alive
+		// until they are released.
+		ISOLATE_STAT(static_cast<v8::Isolate*>(isolate_ptr), kStatScriptRelease);
+		ISOLATE_SCOPE(static_cast<v8::Isolate*>(isolate_ptr));
+
+		Script* script = static_cast<Script*>(scriptptr);
+		script->Reset();
+		delete script;
+	}
+
+	V8CBRIDGE_API WasmModuleTuple v8_Context_CompileWasm(ContextPtr ctxptr,
+		const char* serialized, int serialized_len, const char* wire_bytes, int wire_bytes_len) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContext<WasmModuleTuple>());
+		CONTEXT_STAT(ctxptr, kStatContextCompileWasm);
+		bridge_timer.AddBytes(size_t(serialized_len) + size_t(wire_bytes_len));
+		VALUE_SCOPE(ctxptr);
+		v8::TryCatch try_catch(isolate);
+		try_catch.SetVerbose(false);
+
+		v8::MemorySpan<const uint8_t> serialized_span(
+			reinterpret_cast<const uint8_t*>(serialized), size_t(serialized_len));
+		v8::MemorySpan<const uint8_t> wire_bytes_span(
+			reinterpret_cast<const uint8_t*>(wire_bytes), size_t(wire_bytes_len));
+
+		v8::Local<v8::WasmModuleObject> module;
+		if (!v8::WasmModuleObject::DeserializeOrCompile(isolate, serialized_span, wire_bytes_span).ToLocal(&module)) {
+			return WasmModuleTuple{ nullptr, DupString(report_exception(isolate, ctx, try_catch)) };
+		}
+		return WasmModuleTuple{ new v8::CompiledWasmModule(module->GetCompiledModule()), nullptr };
+	}
+
+	V8CBRIDGE_API ValueTuple v8_Context_InstantiateWasm(ContextPtr ctxptr, WasmModulePtr moduleptr,
+		PersistentValuePtr importsptr) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContext<ValueTuple>());
+		CONTEXT_STAT(ctxptr, kStatContextInstantiateWasm);
+		VALUE_SCOPE(ctxptr);
+		v8::TryCatch try_catch(isolate);
+		try_catch.SetVerbose(false);
+
+		const v8::CompiledWasmModule* compiled = static_cast<v8::CompiledWasmModule*>(moduleptr);
+		v8::Local<v8::WasmModuleObject> module;
+		if (!v8::WasmModuleObject::FromCompiledModule(isolate, *compiled).ToLocal(&module)) {
+			return ExceptionResult(ctxptr, ctx, try_catch);
+		}
+
+		// The embedder API has no instantiation, so use the JS constructor.
+		v8::Local<v8::Value> wasm, instance_ctor;
+		if (!ctx->Global()->Get(ctx, v8::String::NewFromUtf8(isolate, "WebAssembly").ToLocalChecked()).ToLocal(&wasm) ||
+			!wasm->IsObject() ||
+			!wasm.As<v8::Object>()->Get(ctx, v8::String::NewFromUtf8(isolate, "Instance").ToLocalChecked()).ToLocal(&instance_ctor) ||
+			!instance_ctor->IsFunction()) {
+			return ValueTuple{ nullptr, 0, DupString("WebAssembly.Instance is not available") };
+		}
+
+		v8::Local<v8::Value> argv[2] = { module, v8::Undefined(isolate) };
+		if (importsptr != nullptr) {
+			argv[1] = static_cast<Value*>(importsptr)->Get(isolate);
+		}
+
+		v8::Local<v8::Object> instance;
+		if (!instance_ctor.As<v8::Function>()->NewInstance(ctx, 2, argv).ToLocal(&instance)) {
+			return ExceptionResult(ctxptr, ctx, try_catch);
+		}
+		return ValueTuple{ NewValue(ctxptr, instance), v8_Value_KindsFromLocal(instance), nullptr };
+	}
+
+	V8CBRIDGE_API ByteArray v8_WasmModule_Serialize(WasmModulePtr moduleptr) {
+		v8::OwnedBuffer buffer = static_cast<v8::CompiledWasmModule*>(moduleptr)->Serialize();
+		if (buffer.size == 0) {
+			return ByteArray{ nullptr, 0 };
+		}
+		char* data = static_cast<char*>(malloc(buffer.size));
+		memcpy(data, buffer.buffer.get(), buffer.size);
+		return ByteArray{ data, int(buffer.size) };
+	}
+
+	V8CBRIDGE_API ByteArray v8_WasmModule_WireBytes(WasmModulePtr moduleptr) {
+		v8::MemorySpan<const uint8_t> wire_bytes = static_cast<v8::CompiledWasmModule*>(moduleptr)->GetWireBytesRef();
+		char* data = static_cast<char*>(malloc(wire_bytes.size()));
+		memcpy(data, wire_bytes.data(), wire_bytes.size());
+		return ByteArray{ data, int(wire_bytes.size()) };
+	}
+
+	V8CBRIDGE_API void v8_WasmModule_Release(WasmModulePtr moduleptr) {
+		delete static_cast<v8::CompiledWasmModule*>(moduleptr);
+	}
+
 	V8CBRIDGE_API void go_callback(const v8::FunctionCallbackInfo<v8::Value>& args);
+	V8CBRIDGE_API void go_callback_fast(const v8::FunctionCallbackInfo<v8::Value>& args);
 
 	V8CBRIDGE_API PersistentValuePtr v8_Context_RegisterCallback(
 		ContextPtr ctxptr,
 		const char* name,
-		const char* id
+		const char* id,
+		int capture_caller
 	) {
+		RETURN_IF_RELEASED(ctxptr, nullptr);
+		CONTEXT_STAT(ctxptr, kStatContextRegisterCallback);
 		VALUE_SCOPE(ctxptr);
 
 		v8::MaybeLocal<v8::String> idLocal = v8::String::NewFromUtf8(isolate, id);
@@ -506,7 +2242,7 @@ extern "C" {
 
 		v8::Local<v8::FunctionTemplate> cb =
 			v8::FunctionTemplate::New(isolate,
-				static_cast<v8::FunctionCallback>(go_callback),
+				static_cast<v8::FunctionCallback>(capture_caller ? go_callback : go_callback_fast),
 				idLocal.ToLocalChecked());
 		cb->SetClassName(nameLocal.ToLocalChecked());
 		v8::MaybeLocal<v8::Function> fn = cb->GetFunction(ctx);
@@ -515,38 +2251,44 @@ extern "C" {
 			return nullptr;
 		}
 
-		return new Value(isolate, fn.ToLocalChecked());
+		return NewValue(ctxptr, fn.ToLocalChecked());
 
 	}
 
-	V8CBRIDGE_API void go_callback(const v8::FunctionCallbackInfo<v8::Value>& args) {
+	// Calls the Go callback with the given id, looking up the caller in the
+	// script if capture_caller is set.
+	static void CallGoCallbackWithId(const v8::FunctionCallbackInfo<v8::Value>& args, const std::string& id,
+		bool capture_caller) {
 		v8::Isolate* iso = args.GetIsolate();
-		v8::HandleScope scope(iso);
+		ISOLATE_STAT(iso, kStatGoCallback);
 
 		if (go_callback_handler == nullptr) {
 			const char* err_msg = "Callback handler not init";
 			v8::Local<v8::Value> err = v8::Exception::Error(
 				v8::String::NewFromUtf8(iso, err_msg).ToLocalChecked());
 			iso->ThrowException(err);
+			return;
 		}
 
-		std::string id = str(iso, args.Data());
-
 		std::string src_file, src_func;
 		int line_number = 0, column = 0;
-		v8::Local<v8::StackTrace> trace(v8::StackTrace::CurrentStackTrace(iso, 1));
-		if (trace->GetFrameCount() == 1) {
-			v8::Local<v8::StackFrame> frame(trace->GetFrame(iso, 0));
-			src_file = str(iso, frame->GetScriptName());
-			src_func = str(iso, frame->GetFunctionName());
-			line_number = frame->GetLineNumber();
-			column = frame->GetColumn();
+		if (capture_caller) {
+			v8::Local<v8::StackTrace> trace(v8::StackTrace::CurrentStackTrace(iso, 1));
+			if (trace->GetFrameCount() == 1) {
+				v8::Local<v8::StackFrame> frame(trace->GetFrame(iso, 0));
+				src_file = str(iso, frame->GetScriptName());
+				src_func = str(iso, frame->GetFunctionName());
+				line_number = frame->GetLineNumber();
+				column = frame->GetColumn();
+			}
 		}
 
+		// The arguments belong to the Go context that the id starts with.
+		Context* owner = FindContext(iso, atoi(id.c_str()));
 		int argc = args.Length();
 		ValueTuple* argv = new ValueTuple[argc];
 		for (int i = 0; i < argc; i++) {
-			argv[i] = ValueTuple{ new Value(iso, args[i]), v8_Value_KindsFromLocal(args[i]) };
+			argv[i] = ValueTuple{ NewValue(iso, owner, args[i]), v8_Value_KindsFromLocal(args[i]) };
 		}
 
 		ValueTuple result =
@@ -559,73 +2301,311 @@ extern "C" {
 				  column
 				},
 				argc, argv);
+		delete[] argv;
+
+		if (result.error_msg.ptr != nullptr) {
+			v8::Local<v8::Value> err = v8::Exception::Error(
+				v8::String::NewFromUtf8(iso, result.error_msg.ptr, v8::NewStringType::kNormal, result.error_msg.len).ToLocalChecked());
+			iso->ThrowException(err);
+		}
+		else if (result.Value == NULL) {
+			args.GetReturnValue().Set(v8::Undefined(iso));
+		}
+		else {
+			v8::Persistent<v8::Value>* persVal = static_cast<Value*>(result.Value);
+			args.GetReturnValue().Set(persVal->Get(iso));
+		}
+	}
+
+	// Calls the Go callback whose id is the data of the function.
+	static void CallGoCallback(const v8::FunctionCallbackInfo<v8::Value>& args, bool capture_caller) {
+		v8::Isolate* iso = args.GetIsolate();
+		v8::HandleScope scope(iso);
+
+		std::string id = str(iso, args.Data());
+		if (!id.empty() && id[0] == '@') {
+			// Callbacks bound by name are dispatched to the Go context that
+			// owns the function's context, which may have been restored
+			// from a snapshot.
+			id = std::to_string(CurrentGoContextId(iso)) + ":" + id;
+		}
+		CallGoCallbackWithId(args, id, capture_caller);
+	}
+
+	V8CBRIDGE_API void go_callback(const v8::FunctionCallbackInfo<v8::Value>& args) {
+		CallGoCallback(args, true);
+	}
+
+	// Like go_callback, without looking up the caller: walking the stack and
+	// copying the names is a large part of the cost of short callbacks. Go
+	// can still ask for the caller with v8_Isolate_CurrentCaller.
+	V8CBRIDGE_API void go_callback_fast(const v8::FunctionCallbackInfo<v8::Value>& args) {
+		CallGoCallback(args, false);
+	}
+
+	V8CBRIDGE_API CallerInfo v8_Isolate_CurrentCaller(IsolatePtr isolate_ptr) {
+		ISOLATE_STAT(static_cast<v8::Isolate*>(isolate_ptr), kStatIsolateCurrentCaller);
+		CallerInfo caller = { { nullptr, 0 }, { nullptr, 0 }, 0, 0 };
+		// Only the thread running the callback holds the lock and has a
+		// caller; others would wait for the script to finish, and might
+		// deadlock if the callback waits for them.
+		if (isolate_ptr == nullptr || !v8::Locker::IsLocked(static_cast<v8::Isolate*>(isolate_ptr))) {
+			return caller;
+		}
+		ISOLATE_SCOPE(static_cast<v8::Isolate*>(isolate_ptr));
+		v8::HandleScope handle_scope(isolate);
+		v8::Local<v8::StackTrace> trace(v8::StackTrace::CurrentStackTrace(isolate, 1));
+		if (trace->GetFrameCount() == 1) {
+			v8::Local<v8::StackFrame> frame(trace->GetFrame(isolate, 0));
+			caller.Funcname = DupString(str(isolate, frame->GetFunctionName()));
+			caller.Filename = DupString(str(isolate, frame->GetScriptName()));
+			caller.Line = frame->GetLineNumber();
+			caller.Column = frame->GetColumn();
+		}
+		return caller;
+	}
+
+
+	// Calls a method of the Go value wrapped by the receiver, the index of the
+	// method's property is the data of the function. The id is dispatched by
+	// goCallbackHandler to the method of the wrapped value, so one function
+	// per context serves all objects of the template.
+	static void StructMethodCall(const v8::FunctionCallbackInfo<v8::Value>& args) {
+		v8::Isolate* iso = args.GetIsolate();
+		v8::HandleScope scope(iso);
+
+		// The signature of the function guarantees that the holder has been
+		// created from the template.
+		std::string id = std::to_string(CurrentGoContextId(iso)) + ":#" +
+			std::to_string(WrappedHandle(args.Holder())) + "." +
+			std::to_string(args.Data().As<v8::Int32>()->Value());
+		CallGoCallbackWithId(args, id, true);
+	}
+
+	V8CBRIDGE_API int v8_Isolate_NewStructTemplate(IsolatePtr isolate_ptr, const char* names,
+		const int* offsets, const char* methods, int count) {
+		ISOLATE_STAT(static_cast<v8::Isolate*>(isolate_ptr), kStatIsolateNewStructTemplate);
+		ISOLATE_SCOPE(static_cast<v8::Isolate*>(isolate_ptr));
+		v8::HandleScope handle_scope(isolate);
+
+		// The constructor only serves as the signature of the methods, which
+		// can't be called on other objects.
+		v8::Local<v8::FunctionTemplate> ctor = v8::FunctionTemplate::New(isolate);
+		v8::Local<v8::Signature> signature = v8::Signature::New(isolate, ctor);
+		v8::Local<v8::ObjectTemplate> templ = ctor->InstanceTemplate();
+		templ->SetInternalFieldCount(1); // the handle of the Go value
+		for (int i = 0; i < count; i++) {
+			v8::Local<v8::String> name = v8::String::NewFromUtf8(isolate, names + offsets[i],
+				v8::NewStringType::kInternalized, offsets[i + 1] - offsets[i]).ToLocalChecked();
+			if (methods[i]) {
+				v8::Local<v8::FunctionTemplate> method = v8::FunctionTemplate::New(isolate,
+					StructMethodCall, v8::Integer::New(isolate, i), signature);
+				method->SetClassName(name);
+				templ->Set(name, method, v8::PropertyAttribute(v8::ReadOnly | v8::DontDelete));
+			}
+			else {
+				templ->SetAccessor(name, StructFieldGetter, StructFieldSetter,
+					v8::Integer::New(isolate, i), v8::DEFAULT, v8::DontDelete);
+			}
+		}
+
+		IsolateData* data = GetIsolateData(isolate);
+		data->struct_templates.emplace_back(isolate, templ);
+		return int(data->struct_templates.size()) - 1;
+	}
+
+	V8CBRIDGE_API PersistentValuePtr v8_Context_Wrap(ContextPtr ctxptr, int template_id, int handle) {
+		RETURN_IF_RELEASED(ctxptr, nullptr);
+		CONTEXT_STAT(ctxptr, kStatContextWrap);
+		VALUE_SCOPE(ctxptr);
+
+		IsolateData* data = GetIsolateData(isolate);
+		v8::Local<v8::Object> obj;
+		if (template_id < 0 || size_t(template_id) >= data->struct_templates.size() ||
+			!data->struct_templates[template_id].Get(isolate)->NewInstance(ctx).ToLocal(&obj)) {
+			return nullptr;
+		}
+		WrapObject(isolate, obj, handle);
+		return NewValue(ctxptr, obj);
+	}
+
+	V8CBRIDGE_API PersistentValuePtr v8_Context_NewInterceptedObject(ContextPtr ctxptr, int flags, int handle) {
+		RETURN_IF_RELEASED(ctxptr, nullptr);
+		CONTEXT_STAT(ctxptr, kStatContextNewInterceptedObject);
+		VALUE_SCOPE(ctxptr);
+
+		v8::Local<v8::Object> obj;
+		if (!GetInterceptorTemplate(isolate, flags)->NewInstance(ctx).ToLocal(&obj)) {
+			return nullptr;
+		}
+		WrapObject(isolate, obj, handle);
+		return NewValue(ctxptr, obj);
+	}
+
+	V8CBRIDGE_API PersistentValuePtr v8_Context_Global(ContextPtr ctxptr) {
+		RETURN_IF_RELEASED(ctxptr, nullptr);
+		CONTEXT_STAT(ctxptr, kStatContextGlobal);
+		VALUE_SCOPE(ctxptr);
+		return NewValue(ctxptr, ctx->Global());
+	}
+
+	V8CBRIDGE_API void v8_Context_Release(ContextPtr ctxptr) {
+		if (ctxptr == nullptr) {
+			return;
+		}
+		Context* ctx = static_cast<Context*>(ctxptr);
+		ISOLATE_STAT(ctx->isolate, kStatContextRelease);
+		{
+			ISOLATE_SCOPE(ctx->isolate);
+			ResetModules(ctx);
+			ctx->ptr.Reset();
+			// Go values of the context may outlive it, but can't be used
+			// anymore, so their handles are released in one go instead of
+			// waiting for their finalizers.
+			while (ctx->values != nullptr) {
+				DeleteValue(isolate, ctx->values);
+			}
+			if (IsolateData* data = GetIsolateData(isolate)) {
+				data->contexts.erase(ctx->go_context_id);
+			}
+			delete ctx->console;
+		}
+		delete ctx;
+	}
+
+	V8CBRIDGE_API Error v8_Context_Recycle(ContextPtr ctxptr) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContextError());
+		CONTEXT_STAT(ctxptr, kStatContextRecycle);
+		Context* ctx = static_cast<Context*>(ctxptr);
+		ISOLATE_SCOPE(ctx->isolate);
+		v8::HandleScope handle_scope(isolate);
+
+		v8::Local<v8::Context> old_ctx = ctx->ptr.Get(isolate);
+		v8::Local<v8::Value> go_context_id = old_ctx->GetEmbedderData(kGoContextIdIndex);
+
+		// Detaching the global proxy and handing it to the new context saves
+		// allocating a new one, and keeps references to the global valid.
+		v8::Local<v8::Object> global = old_ctx->Global();
+		old_ctx->DetachGlobal();
 
-		if (result.error_msg.ptr != nullptr) {
-			v8::Local<v8::Value> err = v8::Exception::Error(
-				v8::String::NewFromUtf8(iso, result.error_msg.ptr, v8::NewStringType::kNormal, result.error_msg.len).ToLocalChecked());
-			iso->ThrowException(err);
+		v8::Local<v8::Context> new_ctx = v8::Context::New(isolate, nullptr, GetGlobalTemplate(isolate), global);
+		if (new_ctx.IsEmpty()) {
+			return DupString("Cannot create context");
 		}
-		else if (result.Value == NULL) {
-			args.GetReturnValue().Set(v8::Undefined(iso));
+		new_ctx->SetEmbedderData(kGoContextIdIndex, go_context_id);
+		ctx->ptr.Reset(isolate, new_ctx);
+		ResetModules(ctx); // they are linked to the old context
+		return Error{ nullptr, 0 };
+	}
+
+	V8CBRIDGE_API Error v8_Context_InjectConsole(ContextPtr ctxptr, ConsoleOptions options) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContextError());
+		CONTEXT_STAT(ctxptr, kStatContextInjectConsole);
+		VALUE_SCOPE(ctxptr);
+
+		v8::Local<v8::String> name = v8::String::NewFromUtf8(isolate, "console",
+			v8::NewStringType::kInternalized).ToLocalChecked();
+		v8::Local<v8::Value> existing;
+		v8::Local<v8::Object> console;
+		if (ctx->Global()->Get(ctx, name).ToLocal(&existing) && existing->IsObject()) {
+			console = existing.As<v8::Object>();
 		}
 		else {
-			v8::Persistent<v8::Value>* persVal = static_cast<Value*>(result.Value);
-			args.GetReturnValue().Set(persVal->Get(iso));
+			console = v8::Object::New(isolate);
+		}
+
+		for (int i = 0; i < int(sizeof(kConsoleMethods) / sizeof(kConsoleMethods[0])); i++) {
+			v8::Local<v8::String> method = v8::String::NewFromUtf8(isolate, kConsoleMethods[i],
+				v8::NewStringType::kInternalized).ToLocalChecked();
+			v8::Local<v8::Function> fn;
+			if (!v8::Function::New(ctx, ConsoleLog, v8::Integer::New(isolate, i)).ToLocal(&fn) ||
+				console->Set(ctx, method, fn).IsNothing()) {
+				return DupString(std::string("Cannot set console.") + kConsoleMethods[i]);
+			}
+			fn->SetName(method);
+		}
+		if (ctx->Global()->Set(ctx, name, console).IsNothing()) {
+			return DupString("Cannot set the global console");
 		}
 
+		Context* context = static_cast<Context*>(ctxptr);
+		delete context->console;
+		context->console = new ConsoleBuffer(options);
+		return Error{ nullptr, 0 };
 	}
 
-	V8CBRIDGE_API PersistentValuePtr v8_Context_Global(ContextPtr ctxptr) {
-		VALUE_SCOPE(ctxptr);
-		return new Value(isolate, ctx->Global());
+	V8CBRIDGE_API int v8_Context_ReadConsole(ContextPtr ctxptr, char* buf, int len, ConsoleStream* stream) {
+		RETURN_IF_RELEASED(ctxptr, 0);
+		CONTEXT_STAT(ctxptr, kStatContextReadConsole);
+		Context* context = static_cast<Context*>(ctxptr);
+		ISOLATE_SCOPE(context->isolate);
+
+		ConsoleBuffer* console = context->console;
+		if (console == nullptr) {
+			return 0;
+		}
+		size_t n = console->Read(buf, size_t(len), stream);
+		bridge_timer.AddBytes(n);
+		return int(n);
 	}
 
-	V8CBRIDGE_API void v8_Context_Release(ContextPtr ctxptr) {
-		if (ctxptr == nullptr) {
-			return;
+	V8CBRIDGE_API ConsoleStats v8_Context_ConsoleStats(ContextPtr ctxptr) {
+		ConsoleStats stats = { 0, 0, 0 };
+		RETURN_IF_RELEASED(ctxptr, stats);
+		CONTEXT_STAT(ctxptr, kStatContextConsoleStats);
+		Context* context = static_cast<Context*>(ctxptr);
+		ISOLATE_SCOPE(context->isolate);
+		if (context->console != nullptr) {
+			stats = context->console->stats;
 		}
-		Context* ctx = static_cast<Context*>(ctxptr);
-		ISOLATE_SCOPE(ctx->isolate);
-		ctx->ptr.Reset();
+		return stats;
 	}
 
 	V8CBRIDGE_API PersistentValuePtr v8_Context_Create(ContextPtr ctxptr, ImmediateValue val) {
+		RETURN_IF_RELEASED(ctxptr, nullptr);
+		CONTEXT_STAT(ctxptr, kStatContextCreate);
 		VALUE_SCOPE(ctxptr);
 
+		if (val.Type == tSTRING || val.Type == tARRAYBUFFER) {
+			bridge_timer.AddBytes(size_t(val.Mem.len));
+		}
+
 		switch (val.Type) {
-		case tARRAY:       return new Value(isolate, v8::Array::New(isolate, val.Mem.len)); break;
+		case tARRAY:       return NewValue(ctxptr, v8::Array::New(isolate, val.Mem.len)); break;
 		case tARRAYBUFFER: {
 			v8::Local<v8::ArrayBuffer> buf = v8::ArrayBuffer::New(isolate, val.Mem.len);
 			memcpy(buf->GetContents().Data(), val.Mem.ptr, val.Mem.len);
-			return new Value(isolate, buf);
+			return NewValue(ctxptr, buf);
 			break;
 		}
-		case tBOOL:        return new Value(isolate, v8::Boolean::New(isolate, val.Bool == 1)); break;
+		case tBOOL:        return NewValue(ctxptr, v8::Boolean::New(isolate, val.Bool == 1)); break;
 		case tDATE: {
 			v8::MaybeLocal<v8::Value> maybeDate = v8::Date::New(ctx, val.Float64);
 			if (maybeDate.IsEmpty()) {
 				return nullptr;
 			}
-			return new Value(isolate, maybeDate.ToLocalChecked());
+			return NewValue(ctxptr, maybeDate.ToLocalChecked());
 			break;
 		}
-		case tFLOAT64:     return new Value(isolate, v8::Number::New(isolate, val.Float64)); break;
-			// For now, this is converted to a double on entry.
-			// TODO(aroman) Consider using BigInt, but only if the V8 version supports
-			// it. Check to see what V8 versions support BigInt.
-		case tINT64:       return new Value(isolate, v8::Number::New(isolate, double(val.Int64))); break;
-		case tOBJECT:      return new Value(isolate, v8::Object::New(isolate)); break;
+		case tFLOAT64:     return NewValue(ctxptr, v8::Number::New(isolate, val.Float64)); break;
+			// This is converted to a double on entry, use tBIGINT to keep all bits.
+		case tINT64:       return NewValue(ctxptr, v8::Number::New(isolate, double(val.Int64))); break;
+		case tBIGINT:      return NewValue(ctxptr, v8::BigInt::New(isolate, val.Int64)); break;
+		case tBIGUINT:     return NewValue(ctxptr, v8::BigInt::NewFromUnsigned(isolate, uint64_t(val.Int64))); break;
+		case tOBJECT:      return NewValue(ctxptr, v8::Object::New(isolate)); break;
 		case tSTRING: {
-			return new Value(isolate, v8::String::NewFromUtf8(
+			return NewValue(ctxptr, v8::String::NewFromUtf8(
 				isolate, val.Mem.ptr, v8::NewStringType::kNormal, val.Mem.len).ToLocalChecked());
 			break;
 		}
-		case tUNDEFINED:   return new Value(isolate, v8::Undefined(isolate)); break;
+		case tUNDEFINED:   return NewValue(ctxptr, v8::Undefined(isolate)); break;
 		}
 		return nullptr;
 	}
 
 	V8CBRIDGE_API ValueTuple v8_Value_Get(ContextPtr ctxptr, PersistentValuePtr valueptr, const char* field) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContext<ValueTuple>());
+		CONTEXT_STAT(ctxptr, kStatValueGet);
 		VALUE_SCOPE(ctxptr);
 
 		Value* value = static_cast<Value*>(valueptr);
@@ -657,13 +2637,15 @@ extern "C" {
 		}
 
 		return ValueTuple{
-		  new Value(isolate, localValue),
+		  NewValue(ctxptr, localValue),
 		  v8_Value_KindsFromLocal(localValue),
 		  nullptr,
 		};
 	}
 
 	V8CBRIDGE_API ValueTuple v8_Value_GetIdx(ContextPtr ctxptr, PersistentValuePtr valueptr, int idx) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContext<ValueTuple>());
+		CONTEXT_STAT(ctxptr, kStatValueGetIdx);
 		VALUE_SCOPE(ctxptr);
 
 		Value* value = static_cast<Value*>(valueptr);
@@ -688,11 +2670,13 @@ extern "C" {
 			v8::Local<v8::Object> object = maybeObject->ToObject(ctx).ToLocalChecked();
 			obj = object->Get(ctx, uint32_t(idx)).ToLocalChecked();
 		}
-		return ValueTuple{ new Value(isolate, obj), v8_Value_KindsFromLocal(obj), nullptr };
+		return ValueTuple{ NewValue(ctxptr, obj), v8_Value_KindsFromLocal(obj), nullptr };
 	}
 
 	V8CBRIDGE_API Error v8_Value_Set(ContextPtr ctxptr, PersistentValuePtr valueptr,
 		const char* field, PersistentValuePtr new_valueptr) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContextError());
+		CONTEXT_STAT(ctxptr, kStatValueSet);
 		VALUE_SCOPE(ctxptr);
 
 		Value* value = static_cast<Value*>(valueptr);
@@ -726,6 +2710,8 @@ extern "C" {
 
 	V8CBRIDGE_API Error v8_Value_SetIdx(ContextPtr ctxptr, PersistentValuePtr valueptr,
 		int idx, PersistentValuePtr new_valueptr) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContextError());
+		CONTEXT_STAT(ctxptr, kStatValueSetIdx);
 		VALUE_SCOPE(ctxptr);
 
 		Value* value = static_cast<Value*>(valueptr);
@@ -766,10 +2752,253 @@ extern "C" {
 		return Error{ nullptr, 0 };
 	}
 
+	V8CBRIDGE_API Properties v8_Value_GetOwnProperties(ContextPtr ctxptr, PersistentValuePtr valueptr, int flags) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContext<Properties>());
+		CONTEXT_STAT(ctxptr, kStatValueGetOwnProperties);
+		VALUE_SCOPE(ctxptr);
+		v8::TryCatch try_catch(isolate);
+		try_catch.SetVerbose(false);
+
+		Properties res;
+		memset(&res, 0, sizeof(res));
+
+		v8::Local<v8::Value> maybeObject = static_cast<Value*>(valueptr)->Get(isolate);
+		if (!maybeObject->IsObject()) {
+			res.error_msg = DupString("Not an object");
+			return res;
+		}
+		v8::Local<v8::Object> object = maybeObject.As<v8::Object>();
+
+		int filter = v8::PropertyFilter::ALL_PROPERTIES;
+		if (flags & kPropertiesEnumerableOnly) {
+			filter |= v8::PropertyFilter::ONLY_ENUMERABLE;
+		}
+		if (!(flags & kPropertiesIncludeSymbols)) {
+			filter |= v8::PropertyFilter::SKIP_SYMBOLS;
+		}
+
+		v8::Local<v8::Array> names;
+		if (!object->GetOwnPropertyNames(ctx, static_cast<v8::PropertyFilter>(filter),
+			v8::KeyConversionMode::kConvertToString).ToLocal(&names)) {
+			res.error_msg = DupString(report_exception(isolate, ctx, try_catch));
+			return res;
+		}
+
+		int length = int(names->Length());
+		std::string keys;
+		res.Offsets = static_cast<int*>(malloc(sizeof(int) * (length + 1)));
+		res.Offsets[0] = 0;
+		if (flags & kPropertiesWithValues) {
+			res.Values = static_cast<ValueTuple*>(malloc(sizeof(ValueTuple) * (length + 1)));
+		}
+
+		int i = 0;
+		for (; i < length; i++) {
+			v8::Local<v8::Value> key;
+			if (!names->Get(ctx, uint32_t(i)).ToLocal(&key)) {
+				break;
+			}
+			if (key->IsSymbol()) {
+				v8::Local<v8::Value> description = key.As<v8::Symbol>()->Description();
+				keys += "Symbol(" + (description->IsUndefined() ? "" : str(isolate, description)) + ")";
+			}
+			else {
+				keys += str(isolate, key);
+			}
+			res.Offsets[i + 1] = int(keys.length());
+
+			if (res.Values != nullptr) {
+				v8::Local<v8::Value> value;
+				if (!object->Get(ctx, key).ToLocal(&value)) {
+					break;
+				}
+				res.Values[i] = ValueTuple{ NewValue(ctxptr, value), v8_Value_KindsFromLocal(value), nullptr };
+			}
+		}
+
+		if (i < length) {
+			res.error_msg = DupString(report_exception(isolate, ctx, try_catch));
+			if (res.Values != nullptr) {
+				for (int j = 0; j < i; j++) {
+					DeleteValue(isolate, static_cast<Value*>(res.Values[j].Value));
+				}
+			}
+			free(res.Offsets);
+			free(res.Values);
+			res.Offsets = nullptr;
+			res.Values = nullptr;
+			return res;
+		}
+
+		res.Keys = static_cast<char*>(malloc(keys.length() + 1));
+		memcpy(res.Keys, keys.data(), keys.length());
+		res.Length = length;
+		bridge_timer.AddBytes(keys.length());
+		return res;
+	}
+
+	V8CBRIDGE_API ArrayRange v8_Value_GetRange(ContextPtr ctxptr, PersistentValuePtr valueptr,
+		int start, int count, ImmediateValueType type) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContext<ArrayRange>());
+		CONTEXT_STAT(ctxptr, kStatValueGetRange);
+		VALUE_SCOPE(ctxptr);
+		v8::TryCatch try_catch(isolate);
+		try_catch.SetVerbose(false);
+
+		ArrayRange res;
+		memset(&res, 0, sizeof(res));
+		res.Type = type;
+		if (start < 0 || count < 0 || int64_t(start) + count > int64_t(UINT32_MAX)) {
+			res.error_msg = DupString("Invalid range");
+			return res;
+		}
+
+		v8::Local<v8::Value> maybeObject = static_cast<Value*>(valueptr)->Get(isolate);
+		if (!maybeObject->IsObject()) {
+			res.error_msg = DupString("Not an object");
+			return res;
+		}
+		v8::Local<v8::Object> object = maybeObject.As<v8::Object>();
+
+		std::string strings;
+		switch (type) {
+		case tFLOAT64: res.Float64s = static_cast<double*>(malloc(sizeof(double) * (count + 1))); break;
+		case tBOOL:    res.Bools = static_cast<char*>(malloc(count + 1)); break;
+		case tSTRING:  res.Offsets = static_cast<int*>(malloc(sizeof(int) * (count + 1))); res.Offsets[0] = 0; break;
+		default:       res.Values = static_cast<ValueTuple*>(malloc(sizeof(ValueTuple) * (count + 1))); break;
+		}
+
+		const char* mismatch = nullptr;
+		int i = 0;
+		for (; i < count && mismatch == nullptr; i++) {
+			v8::Local<v8::Value> el;
+			if (!object->Get(ctx, uint32_t(start + i)).ToLocal(&el)) {
+				res.error_msg = DupString(report_exception(isolate, ctx, try_catch));
+				break;
+			}
+
+			switch (type) {
+			case tFLOAT64:
+				if (!el->IsNumber()) {
+					mismatch = "is not a number";
+					break;
+				}
+				res.Float64s[i] = el.As<v8::Number>()->Value();
+				break;
+			case tBOOL:
+				if (!el->IsBoolean()) {
+					mismatch = "is not a boolean";
+					break;
+				}
+				res.Bools[i] = el->IsTrue() ? 1 : 0;
+				break;
+			case tSTRING:
+				if (!el->IsString()) {
+					mismatch = "is not a string";
+					break;
+				}
+				strings += str(isolate, el);
+				res.Offsets[i + 1] = int(strings.length());
+				break;
+			default:
+				res.Values[i] = ValueTuple{ NewValue(ctxptr, el), v8_Value_KindsFromLocal(el), nullptr };
+				break;
+			}
+		}
+
+		if (mismatch != nullptr) {
+			res.error_msg = DupString(("Element " + std::to_string(start + i - 1) + " " + mismatch).c_str());
+		}
+		if (res.error_msg.ptr != nullptr) {
+			if (res.Values != nullptr) {
+				for (int j = 0; j < i; j++) {
+					DeleteValue(isolate, static_cast<Value*>(res.Values[j].Value));
+				}
+			}
+			free(res.Float64s);
+			free(res.Bools);
+			free(res.Offsets);
+			free(res.Values);
+			res.Float64s = nullptr;
+			res.Bools = nullptr;
+			res.Offsets = nullptr;
+			res.Values = nullptr;
+			return res;
+		}
+
+		if (type == tSTRING) {
+			res.Strings = static_cast<char*>(malloc(strings.length() + 1));
+			memcpy(res.Strings, strings.data(), strings.length());
+			bridge_timer.AddBytes(strings.length());
+		}
+		else if (type == tFLOAT64) {
+			bridge_timer.AddBytes(sizeof(double) * count);
+		}
+		else if (type == tBOOL) {
+			bridge_timer.AddBytes(size_t(count));
+		}
+		res.Length = count;
+		return res;
+	}
+
+	V8CBRIDGE_API Error v8_Value_SetRange(ContextPtr ctxptr, PersistentValuePtr valueptr,
+		int start, ArrayRange range) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContextError());
+		CONTEXT_STAT(ctxptr, kStatValueSetRange);
+		VALUE_SCOPE(ctxptr);
+		v8::TryCatch try_catch(isolate);
+		try_catch.SetVerbose(false);
+
+		if (start < 0 || range.Length < 0 || int64_t(start) + range.Length > int64_t(UINT32_MAX)) {
+			return DupString("Invalid range");
+		}
+
+		v8::Local<v8::Value> maybeObject = static_cast<Value*>(valueptr)->Get(isolate);
+		if (!maybeObject->IsObject()) {
+			return DupString("Not an object");
+		}
+		v8::Local<v8::Object> object = maybeObject.As<v8::Object>();
+
+		for (int i = 0; i < range.Length; i++) {
+			v8::Local<v8::Value> el;
+			switch (range.Type) {
+			case tFLOAT64:
+				el = v8::Number::New(isolate, range.Float64s[i]);
+				break;
+			case tBOOL:
+				el = v8::Boolean::New(isolate, range.Bools[i] != 0);
+				break;
+			case tSTRING:
+				if (!v8::String::NewFromUtf8(isolate, range.Strings + range.Offsets[i], v8::NewStringType::kNormal,
+					range.Offsets[i + 1] - range.Offsets[i]).ToLocal(&el)) {
+					return DupString(report_exception(isolate, ctx, try_catch));
+				}
+				break;
+			default:
+				el = static_cast<Value*>(range.Values[i].Value)->Get(isolate);
+				break;
+			}
+
+			if (object->Set(ctx, uint32_t(start + i), el).IsNothing()) {
+				return DupString(report_exception(isolate, ctx, try_catch));
+			}
+		}
+
+		switch (range.Type) {
+		case tFLOAT64: bridge_timer.AddBytes(sizeof(double) * range.Length); break;
+		case tBOOL:    bridge_timer.AddBytes(size_t(range.Length)); break;
+		case tSTRING:  bridge_timer.AddBytes(size_t(range.Length > 0 ? range.Offsets[range.Length] : 0)); break;
+		default:       break;
+		}
+		return Error{ nullptr, 0 };
+	}
+
 	V8CBRIDGE_API ValueTuple v8_Value_Call(ContextPtr ctxptr,
 		PersistentValuePtr funcptr,
 		PersistentValuePtr selfptr,
 		int argc, PersistentValuePtr* argvptr) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContext<ValueTuple>());
+		CONTEXT_STAT(ctxptr, kStatValueCall);
 		VALUE_SCOPE(ctxptr);
 
 		v8::TryCatch try_catch(isolate);
@@ -799,12 +3028,12 @@ extern "C" {
 		delete[] argv;
 
 		if (result.IsEmpty()) {
-			return ValueTuple{ nullptr, 0, DupString(report_exception(isolate, ctx, try_catch)) };
+			return ExceptionResult(ctxptr, ctx, try_catch);
 		}
 
 		v8::Local<v8::Value> value = result.ToLocalChecked();
 		return ValueTuple{
-		  static_cast<PersistentValuePtr>(new Value(isolate, value)),
+		  static_cast<PersistentValuePtr>(NewValue(ctxptr, value)),
 		  v8_Value_KindsFromLocal(value),
 		  nullptr
 		};
@@ -813,6 +3042,8 @@ extern "C" {
 	V8CBRIDGE_API ValueTuple v8_Value_New(ContextPtr ctxptr,
 		PersistentValuePtr funcptr,
 		int argc, PersistentValuePtr* argvptr) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContext<ValueTuple>());
+		CONTEXT_STAT(ctxptr, kStatValueNew);
 		VALUE_SCOPE(ctxptr);
 
 		v8::TryCatch try_catch(isolate);
@@ -834,37 +3065,157 @@ extern "C" {
 		delete[] argv;
 
 		if (result.IsEmpty()) {
-			return ValueTuple{ nullptr, 0, DupString(report_exception(isolate, ctx, try_catch)) };
+			return ExceptionResult(ctxptr, ctx, try_catch);
 		}
 
 		v8::Local<v8::Value> value = result.ToLocalChecked();
 		return ValueTuple{
-		  static_cast<PersistentValuePtr>(new Value(isolate, value)),
+		  static_cast<PersistentValuePtr>(NewValue(ctxptr, value)),
 		  v8_Value_KindsFromLocal(value),
 		  nullptr
 		};
 	}
 
+	V8CBRIDGE_API PreparedCallPtr v8_Context_PrepareCall(ContextPtr ctxptr,
+		PersistentValuePtr funcptr, PersistentValuePtr selfptr, int nargs) {
+		RETURN_IF_RELEASED(ctxptr, nullptr);
+		CONTEXT_STAT(ctxptr, kStatContextPrepareCall);
+		VALUE_SCOPE(ctxptr);
+
+		PreparedCall* call = new PreparedCall;
+		call->func = NewValue(ctxptr, static_cast<Value*>(funcptr)->Get(isolate));
+		call->self = selfptr == nullptr ? nullptr : NewValue(ctxptr, static_cast<Value*>(selfptr)->Get(isolate));
+		call->args.resize(nargs);
+		for (CallArg& arg : call->args) {
+			memset(&arg, 0, sizeof(arg));
+			arg.Type = tUNDEFINED;
+		}
+		call->argv.resize(nargs);
+		return call;
+	}
+
+	V8CBRIDGE_API CallArg* v8_PreparedCall_Args(PreparedCallPtr callptr) {
+		return static_cast<PreparedCall*>(callptr)->args.data();
+	}
+
+	V8CBRIDGE_API ValueTuple v8_PreparedCall_Call(ContextPtr ctxptr, PreparedCallPtr callptr,
+		int discard_result) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContext<ValueTuple>());
+		CONTEXT_STAT(ctxptr, kStatPreparedCallCall);
+		VALUE_SCOPE(ctxptr);
+
+		v8::TryCatch try_catch(isolate);
+		try_catch.SetVerbose(false);
+
+		PreparedCall* call = static_cast<PreparedCall*>(callptr);
+		v8::Local<v8::Value> func = call->func->Get(isolate);
+		if (!func->IsFunction()) {
+			return ValueTuple{ nullptr, 0, DupString("Not a function") };
+		}
+		v8::Local<v8::Value> self;
+		if (call->self == nullptr) {
+			self = ctx->Global();
+		}
+		else {
+			self = call->self->Get(isolate);
+		}
+
+		for (size_t i = 0; i < call->args.size(); i++) {
+			const CallArg& arg = call->args[i];
+			v8::Local<v8::Value>& value = call->argv[i];
+			switch (arg.Type) {
+			case tFLOAT64: value = v8::Number::New(isolate, arg.Float64); break;
+			case tINT64:   value = v8::Number::New(isolate, double(arg.Int64)); break;
+			case tBOOL:    value = v8::Boolean::New(isolate, arg.Bool != 0); break;
+			case tSTRING:
+				if (!v8::String::NewFromUtf8(isolate, arg.Str.ptr, v8::NewStringType::kNormal,
+					arg.Str.len).ToLocal(&value)) {
+					return ValueTuple{ nullptr, 0, DupString("Cannot create string") };
+				}
+				break;
+			case tOBJECT:
+				if (arg.Handle != nullptr) {
+					value = static_cast<Value*>(arg.Handle)->Get(isolate);
+					break;
+				}
+				// fall through
+			default:
+				value = v8::Undefined(isolate);
+			}
+		}
+
+		v8::Local<v8::Value> result;
+		if (!func.As<v8::Function>()->Call(ctx, self, int(call->argv.size()), call->argv.data()).ToLocal(&result)) {
+			return ExceptionResult(ctxptr, ctx, try_catch);
+		}
+		if (discard_result) {
+			return ValueTuple{ nullptr, 0, nullptr };
+		}
+		return ValueTuple{ NewValue(ctxptr, result), v8_Value_KindsFromLocal(result), nullptr };
+	}
+
+	V8CBRIDGE_API void v8_PreparedCall_Release(ContextPtr ctxptr, PreparedCallPtr callptr) {
+		if (callptr == nullptr) {
+			return;
+		}
+		// A released context has no isolate to count the call in.
+		ISOLATE_STAT(ctxptr == nullptr ? nullptr : static_cast<Context*>(ctxptr)->isolate,
+			kStatPreparedCallRelease);
+		PreparedCall* call = static_cast<PreparedCall*>(callptr);
+		// Otherwise the handles have been released along with the context.
+		if (ctxptr != nullptr) {
+			ISOLATE_SCOPE(static_cast<Context*>(ctxptr)->isolate);
+			DeleteValue(isolate, call->func);
+			if (call->self != nullptr) {
+				DeleteValue(isolate, call->self);
+			}
+		}
+		for (CallArg& arg : call->args) {
+			free(const_cast<char*>(arg.Str.ptr));
+		}
+		delete call;
+	}
+
 	V8CBRIDGE_API void v8_Value_Release(ContextPtr ctxptr, PersistentValuePtr valueptr) {
 		if (valueptr == nullptr || ctxptr == nullptr) {
 			return;
 		}
 
+		CONTEXT_STAT(ctxptr, kStatValueRelease);
 		ISOLATE_SCOPE(static_cast<Context*>(ctxptr)->isolate);
 
-		Value* value = static_cast<Value*>(valueptr);
-		value->Reset();
-		delete value;
+		DeleteValue(isolate, static_cast<Value*>(valueptr));
+	}
+
+	V8CBRIDGE_API void v8_Value_ReleaseAll(ContextPtr ctxptr, PersistentValuePtr* values, int count) {
+		if (ctxptr == nullptr || count == 0) {
+			return;
+		}
+
+		CONTEXT_STAT(ctxptr, kStatValueReleaseAll);
+		ISOLATE_SCOPE(static_cast<Context*>(ctxptr)->isolate);
+
+		for (int i = 0; i < count; i++) {
+			if (values[i] != nullptr) {
+				DeleteValue(isolate, static_cast<Value*>(values[i]));
+			}
+		}
 	}
 
 	V8CBRIDGE_API String v8_Value_String(ContextPtr ctxptr, PersistentValuePtr valueptr) {
+		RETURN_IF_RELEASED(ctxptr, String());
+		CONTEXT_STAT(ctxptr, kStatValueString);
 		VALUE_SCOPE(ctxptr);
 
 		v8::Local<v8::Value> value = static_cast<Value*>(valueptr)->Get(isolate);
-		return DupString(isolate, value);
+		String res = DupString(isolate, value);
+		bridge_timer.AddBytes(size_t(res.len));
+		return res;
 	}
 
 	V8CBRIDGE_API double v8_Value_Float64(ContextPtr ctxptr, PersistentValuePtr valueptr) {
+		RETURN_IF_RELEASED(ctxptr, 0);
+		CONTEXT_STAT(ctxptr, kStatValueFloat64);
 		VALUE_SCOPE(ctxptr);
 		v8::Local<v8::Value> value = static_cast<Value*>(valueptr)->Get(isolate);
 		v8::Maybe<double> val = value->NumberValue(ctx);
@@ -874,48 +3225,193 @@ extern "C" {
 		return val.ToChecked();
 	}
 	V8CBRIDGE_API int64_t v8_Value_Int64(ContextPtr ctxptr, PersistentValuePtr valueptr) {
+		RETURN_IF_RELEASED(ctxptr, 0);
+		CONTEXT_STAT(ctxptr, kStatValueInt64);
 		VALUE_SCOPE(ctxptr);
 		v8::Local<v8::Value> value = static_cast<Value*>(valueptr)->Get(isolate);
+		if (value->IsBigInt()) {
+			return value.As<v8::BigInt>()->Int64Value();
+		}
 		v8::Maybe<int64_t> val = value->IntegerValue(ctx);
 		if (val.IsNothing()) {
 			return 0;
 		}
 		return val.ToChecked();
 	}
+	V8CBRIDGE_API int64_t v8_Value_BigInt64(ContextPtr ctxptr, PersistentValuePtr valueptr, int* lossless) {
+		RETURN_IF_RELEASED(ctxptr, 0);
+		CONTEXT_STAT(ctxptr, kStatValueBigInt64);
+		VALUE_SCOPE(ctxptr);
+		v8::Local<v8::Value> value = static_cast<Value*>(valueptr)->Get(isolate);
+		*lossless = 0;
+		if (value->IsBigInt()) {
+			bool ok = false;
+			int64_t i = value.As<v8::BigInt>()->Int64Value(&ok);
+			*lossless = ok ? 1 : 0;
+			return i;
+		}
+		if (value->IsNumber()) {
+			double d = value.As<v8::Number>()->Value();
+			if (d >= -9223372036854775808.0 && d < 9223372036854775808.0) {
+				int64_t i = int64_t(d);
+				*lossless = double(i) == d ? 1 : 0;
+				return i;
+			}
+		}
+		return 0;
+	}
+	V8CBRIDGE_API uint64_t v8_Value_BigUint64(ContextPtr ctxptr, PersistentValuePtr valueptr, int* lossless) {
+		RETURN_IF_RELEASED(ctxptr, 0);
+		CONTEXT_STAT(ctxptr, kStatValueBigUint64);
+		VALUE_SCOPE(ctxptr);
+		v8::Local<v8::Value> value = static_cast<Value*>(valueptr)->Get(isolate);
+		*lossless = 0;
+		if (value->IsBigInt()) {
+			bool ok = false;
+			uint64_t u = value.As<v8::BigInt>()->Uint64Value(&ok);
+			*lossless = ok ? 1 : 0;
+			return u;
+		}
+		if (value->IsNumber()) {
+			double d = value.As<v8::Number>()->Value();
+			if (d >= 0 && d < 18446744073709551616.0) {
+				uint64_t u = uint64_t(d);
+				*lossless = double(u) == d ? 1 : 0;
+				return u;
+			}
+		}
+		return 0;
+	}
 	V8CBRIDGE_API int v8_Value_Bool(ContextPtr ctxptr, PersistentValuePtr valueptr) {
+		RETURN_IF_RELEASED(ctxptr, 0);
+		CONTEXT_STAT(ctxptr, kStatValueBool);
 		VALUE_SCOPE(ctxptr);
 		v8::Local<v8::Value> value = static_cast<Value*>(valueptr)->Get(isolate);
 		return value->BooleanValue(isolate) ? 1 : 0;
 	}
 
 	V8CBRIDGE_API ByteArray v8_Value_Bytes(ContextPtr ctxptr, PersistentValuePtr valueptr) {
+		size_t length = 0;
+		const char* data = v8_Value_ByteView(ctxptr, valueptr, &length);
+		if (data == nullptr || length > size_t(INT_MAX)) {
+			return ByteArray{ nullptr, 0 };
+		}
+		return ByteArray{ data, int(length) };
+	}
+
+	V8CBRIDGE_API const char* v8_Value_ByteView(ContextPtr ctxptr, PersistentValuePtr valueptr, size_t* byte_length) {
+		*byte_length = 0;
+		RETURN_IF_RELEASED(ctxptr, nullptr);
+		CONTEXT_STAT(ctxptr, kStatValueBytes);
 		VALUE_SCOPE(ctxptr);
 
 		v8::Local<v8::Value> value = static_cast<Value*>(valueptr)->Get(isolate);
 
 		v8::ArrayBuffer* bufPtr;
-
-		if (value->IsTypedArray()) {
-			bufPtr = *v8::TypedArray::Cast(*value)->Buffer();
+		size_t offset = 0;
+		size_t length = 0;
+
+		if (value->IsArrayBufferView()) {
+			// Only the range of the view, e.g. for typed arrays created with
+			// subarray().
+			v8::ArrayBufferView* view = v8::ArrayBufferView::Cast(*value);
+			bufPtr = *view->Buffer();
+			offset = view->ByteOffset();
+			length = view->ByteLength();
 		}
 		else if (value->IsArrayBuffer()) {
 			bufPtr = v8::ArrayBuffer::Cast(*value);
+			length = bufPtr->GetContents().ByteLength();
 		}
 		else {
-			return ByteArray{ nullptr, 0 };
+			return nullptr;
 		}
 
 		if (bufPtr == NULL) {
-			return ByteArray{ nullptr, 0 };
+			return nullptr;
 		}
 
-		return ByteArray{
-		  static_cast<const char*>(bufPtr->GetContents().Data()),
-		  static_cast<int>(bufPtr->GetContents().ByteLength()),
-		};
+		const char* data = static_cast<const char*>(bufPtr->GetContents().Data());
+		if (data == nullptr) {
+			return nullptr;
+		}
+		bridge_timer.AddBytes(length);
+		*byte_length = length;
+		return data + offset;
+	}
+
+	V8CBRIDGE_API PersistentValuePtr v8_Context_CreateTypedArray(ContextPtr ctxptr, Kind kind,
+		const char* data, size_t byte_length) {
+		RETURN_IF_RELEASED(ctxptr, nullptr);
+		CONTEXT_STAT(ctxptr, kStatContextCreateTypedArray);
+		bridge_timer.AddBytes(byte_length);
+		VALUE_SCOPE(ctxptr);
+
+		v8::Local<v8::ArrayBuffer> buf = v8::ArrayBuffer::New(isolate, byte_length);
+		if (byte_length > 0) {
+			memcpy(buf->GetContents().Data(), data, byte_length);
+		}
+
+		size_t len = byte_length;
+		v8::Local<v8::TypedArray> arr;
+		switch (kind) {
+		case kUint8Array:   arr = v8::Uint8Array::New(buf, 0, len); break;
+		case kInt8Array:    arr = v8::Int8Array::New(buf, 0, len); break;
+		case kUint16Array:  arr = v8::Uint16Array::New(buf, 0, len / 2); break;
+		case kInt16Array:   arr = v8::Int16Array::New(buf, 0, len / 2); break;
+		case kUint32Array:  arr = v8::Uint32Array::New(buf, 0, len / 4); break;
+		case kInt32Array:   arr = v8::Int32Array::New(buf, 0, len / 4); break;
+		case kFloat32Array: arr = v8::Float32Array::New(buf, 0, len / 4); break;
+		case kFloat64Array: arr = v8::Float64Array::New(buf, 0, len / 8); break;
+		default:            return nullptr;
+		}
+		return NewValue(ctxptr, arr);
+	}
+
+	V8CBRIDGE_API ExternalStringPtr v8_ExternalString_New(const char* utf8, int len) {
+		return NewExternalText(utf8, size_t(len));
+	}
+
+	V8CBRIDGE_API int v8_ExternalString_IsOneByte(ExternalStringPtr textptr) {
+		return static_cast<ExternalText*>(textptr)->one_byte() ? 1 : 0;
+	}
+
+	V8CBRIDGE_API void v8_ExternalString_Release(ExternalStringPtr textptr) {
+		static_cast<ExternalText*>(textptr)->Unref();
+	}
+
+	V8CBRIDGE_API ValueTuple v8_Context_CreateExternalString(ContextPtr ctxptr, ExternalStringPtr textptr) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContext<ValueTuple>());
+		CONTEXT_STAT(ctxptr, kStatContextCreateExternalString);
+		VALUE_SCOPE(ctxptr);
+		ExternalText* text = static_cast<ExternalText*>(textptr);
+
+		// V8 doesn't keep resources of empty strings, nor of strings that are
+		// too long, in which case they must be deleted here.
+		v8::Local<v8::String> str;
+		if (text->length() == 0) {
+			str = v8::String::Empty(isolate);
+		}
+		else if (text->one_byte()) {
+			ExternalOneByteResource* resource = new ExternalOneByteResource(text);
+			if (!v8::String::NewExternalOneByte(isolate, resource).ToLocal(&str)) {
+				delete resource;
+			}
+		}
+		else {
+			ExternalTwoByteResource* resource = new ExternalTwoByteResource(text);
+			if (!v8::String::NewExternalTwoByte(isolate, resource).ToLocal(&str)) {
+				delete resource;
+			}
+		}
+		if (str.IsEmpty()) {
+			return ValueTuple{ nullptr, 0, DupString("String is too long") };
+		}
+		return ValueTuple{ NewValue(ctxptr, str), v8_Value_KindsFromLocal(str), nullptr };
 	}
 
 	V8CBRIDGE_API HeapStatistics v8_Isolate_GetHeapStatistics(IsolatePtr isolate_ptr) {
+		ISOLATE_STAT(static_cast<v8::Isolate*>(isolate_ptr), kStatIsolateGetHeapStatistics);
 		if (isolate_ptr == nullptr) {
 			return HeapStatistics{ 0 };
 		}
@@ -935,7 +3431,29 @@ extern "C" {
 		};
 	}
 
+	V8CBRIDGE_API ModuleCacheStats v8_Isolate_GetModuleCacheStats(IsolatePtr isolate_ptr) {
+		ISOLATE_STAT(static_cast<v8::Isolate*>(isolate_ptr), kStatIsolateGetModuleCacheStats);
+		if (isolate_ptr == nullptr) {
+			return ModuleCacheStats{ 0, 0, 0, 0 };
+		}
+		ISOLATE_SCOPE(static_cast<v8::Isolate*>(isolate_ptr));
+		IsolateData* data = GetIsolateData(isolate);
+		ModuleCacheStats stats = data->module_cache_stats;
+		stats.entries = int(data->module_code_cache.size());
+		return stats;
+	}
+
+	V8CBRIDGE_API void v8_Isolate_ClearModuleCache(IsolatePtr isolate_ptr) {
+		ISOLATE_STAT(static_cast<v8::Isolate*>(isolate_ptr), kStatIsolateClearModuleCache);
+		if (isolate_ptr == nullptr) {
+			return;
+		}
+		ISOLATE_SCOPE(static_cast<v8::Isolate*>(isolate_ptr));
+		GetIsolateData(isolate)->module_code_cache.clear();
+	}
+
 	V8CBRIDGE_API void v8_Isolate_LowMemoryNotification(IsolatePtr isolate_ptr) {
+		ISOLATE_STAT(static_cast<v8::Isolate*>(isolate_ptr), kStatIsolateLowMemoryNotification);
 		if (isolate_ptr == nullptr) {
 			return;
 		}
@@ -943,8 +3461,80 @@ extern "C" {
 		isolate->LowMemoryNotification();
 	}
 
+	V8CBRIDGE_API int v8_Isolate_PumpMessageLoop(IsolatePtr isolate_ptr, double idle_time_in_seconds) {
+		ISOLATE_STAT(static_cast<v8::Isolate*>(isolate_ptr), kStatIsolatePumpMessageLoop);
+		if (isolate_ptr == nullptr) {
+			return 0;
+		}
+		ISOLATE_SCOPE(static_cast<v8::Isolate*>(isolate_ptr));
+		v8::HandleScope handle_scope(isolate);
+
+		// Foreground tasks are posted by V8 (e.g. finalization of concurrent
+		// compilation or GC steps) and only run when the embedder pumps them.
+		int tasks_run = 0;
+		while (v8::platform::PumpMessageLoop(platform_.get(), isolate)) {
+			tasks_run++;
+		}
+		if (idle_task_support_ && idle_time_in_seconds > 0) {
+			v8::platform::RunIdleTasks(platform_.get(), isolate, idle_time_in_seconds);
+		}
+		return tasks_run;
+	}
+
+	V8CBRIDGE_API void v8_Isolate_SetBridgeStats(IsolatePtr isolate_ptr, int enabled) {
+		IsolateData* data = GetIsolateData(static_cast<v8::Isolate*>(isolate_ptr));
+		if (data != nullptr) {
+			data->stats.enabled = enabled != 0;
+		}
+	}
+
+	V8CBRIDGE_API void v8_Isolate_GetBridgeStats(IsolatePtr isolate_ptr, BridgeStats* out) {
+		memset(out, 0, sizeof(*out));
+		IsolateData* data = GetIsolateData(static_cast<v8::Isolate*>(isolate_ptr));
+		if (data == nullptr) {
+			return;
+		}
+
+		const BridgeCounters& stats = data->stats;
+		out->Enabled = stats.enabled ? 1 : 0;
+		out->HandlesCreated = stats.handles_created.load(std::memory_order_relaxed);
+		out->HandlesReleased = stats.handles_released.load(std::memory_order_relaxed);
+		for (int i = 0; i < kNumBridgeEntries; i++) {
+			const BridgeCounters::Entry& entry = stats.entries[i];
+			out->Entries[i].Calls = entry.calls.load(std::memory_order_relaxed);
+			out->Entries[i].Nanos = entry.nanos.load(std::memory_order_relaxed);
+			out->Entries[i].Bytes = entry.bytes.load(std::memory_order_relaxed);
+			for (int b = 0; b < kBridgeHistogramBuckets; b++) {
+				out->Entries[i].Histogram[b] = entry.histogram[b].load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	V8CBRIDGE_API int v8_Context_LiveValues(ContextPtr ctxptr) {
+		if (ctxptr == nullptr) {
+			return 0;
+		}
+		CONTEXT_STAT(ctxptr, kStatContextLiveValues);
+		Context* ctx = static_cast<Context*>(ctxptr);
+		v8::Locker locker(ctx->isolate);
+		return ctx->live_values;
+	}
+
+	V8CBRIDGE_API int v8_Isolate_LiveValues(IsolatePtr isolate_ptr) {
+		v8::Isolate* isolate = static_cast<v8::Isolate*>(isolate_ptr);
+		IsolateData* data = GetIsolateData(isolate);
+		if (data == nullptr) {
+			return 0;
+		}
+		ISOLATE_STAT(isolate, kStatIsolateLiveValues);
+		v8::Locker locker(isolate);
+		return data->live_values;
+	}
+
 	V8CBRIDGE_API ValueTuple v8_Value_PromiseInfo(ContextPtr ctxptr, PersistentValuePtr valueptr,
 		int* promise_state) {
+		RETURN_IF_RELEASED(ctxptr, ReleasedContext<ValueTuple>());
+		CONTEXT_STAT(ctxptr, kStatValuePromiseInfo);
 		VALUE_SCOPE(ctxptr);
 		v8::Local<v8::Value> value = static_cast<Value*>(valueptr)->Get(isolate);
 		if (!value->IsPromise()) { // just in case
@@ -957,7 +3547,7 @@ extern "C" {
 			return ValueTuple{ nullptr, 0, nullptr };
 		}
 		v8::Local<v8::Value> res = prom->Result();
-		return ValueTuple{ new Value(isolate, res), v8_Value_KindsFromLocal(res), nullptr };
+		return ValueTuple{ NewValue(ctxptr, res), v8_Value_KindsFromLocal(res), nullptr };
 	}
 
 } // extern "C"
\ No newline at end of file
@@ -38,6 +38,12 @@ extern "C" {
 	V8CBRIDGE_API typedef void* IsolatePtr;
 	V8CBRIDGE_API typedef void* ContextPtr;
 	V8CBRIDGE_API typedef void* PersistentValuePtr;
+	V8CBRIDGE_API typedef void* ScriptPtr;
+	V8CBRIDGE_API typedef void* ScriptStreamPtr;
+	V8CBRIDGE_API typedef void* SnapshotCreatorPtr;
+	V8CBRIDGE_API typedef void* WasmModulePtr;
+	V8CBRIDGE_API typedef void* ExternalStringPtr;
+	V8CBRIDGE_API typedef void* PreparedCallPtr;
 
 	V8CBRIDGE_API void v8_Free(void* ptr);
 
@@ -112,6 +118,7 @@ extern "C" {
 		kSharedArrayBuffer,
 		kProxy,
 		kWebAssemblyCompiledModule,
+		kBigInt,
 		kNumKinds,
 	} Kind;
 
@@ -120,18 +127,58 @@ extern "C" {
 	// to multiple bitmasks or a dynamically-allocated array.
 	V8CBRIDGE_API typedef uint64_t KindMask;
 
+	V8CBRIDGE_API typedef struct {
+		String Funcname;
+		String Filename;
+		int Line;
+		int Column;
+	} CallerInfo;
+
+	// An exception thrown by a script, see v8_Exception_Release. Go formats
+	// the error message from the fields only if it is asked for.
+	V8CBRIDGE_API typedef struct {
+		// The thrown value, whose handle belongs to the context like that of
+		// any other value.
+		PersistentValuePtr Value;
+		KindMask Kinds;
+		// The thrown value converted to a string.
+		String Text;
+		// Set if the script that threw it is known: the script, the line
+		// (starting at 1), the columns of the statement and the source line.
+		int HasLocation;
+		String Filename;
+		int Line;
+		int StartColumn;
+		int EndColumn;
+		String SourceLine;
+		// Set if the value is an Error, Frames being its stack trace, innermost
+		// frame first.
+		int HasStack;
+		CallerInfo* Frames;
+		int FrameCount;
+	} Exception;
+
+	// Frees the exception and its strings, but not the handle of its value.
+	V8CBRIDGE_API void v8_Exception_Release(Exception* exception);
+
+	// The result of a call returning a value. A thrown exception is returned
+	// as exception, other errors as error_msg.
 	V8CBRIDGE_API typedef struct {
 		PersistentValuePtr Value;
 		KindMask Kinds;
 		Error error_msg;
+		Exception* exception;
 	} ValueTuple;
 
 	V8CBRIDGE_API typedef struct {
-		String Funcname;
-		String Filename;
-		int Line;
-		int Column;
-	} CallerInfo;
+		ScriptPtr Script;
+		Error error_msg;
+	} ScriptTuple;
+
+	V8CBRIDGE_API typedef struct {
+		WasmModulePtr Module;
+		Error error_msg;
+	} WasmModuleTuple;
 
 	V8CBRIDGE_API typedef struct { int Major, Minor, Build, Patch; } Version;
 	V8CBRIDGE_API extern Version version;
@@ -139,29 +186,366 @@ extern "C" {
 	// pointer to callback function
 	V8CBRIDGE_API typedef ValueTuple(*GoCallbackHandlerPtr)(String id, CallerInfo info, int argc, ValueTuple* argv);
 
+	// Result of resolving an import. The strings must be allocated with malloc
+	// and are freed by the bridge.
+	V8CBRIDGE_API typedef struct {
+		String name;
+		String source;
+		Error error_msg;
+	} ResolvedModule;
+
+	// pointer to the function resolving imports of the modules evaluated in
+	// the Go context with the given id
+	V8CBRIDGE_API typedef ResolvedModule(*GoResolveModuleHandlerPtr)(int go_context_id, String specifier,
+		String referrer);
+
+	// pointers to the functions reading (value is NULL) or writing the field
+	// with the given index of the Go value wrapped with handle, see
+	// v8_Context_Wrap, and releasing the handle once it is no longer used
+	V8CBRIDGE_API typedef ValueTuple(*GoAccessorHandlerPtr)(int go_context_id, int handle, int field,
+		ValueTuple* value);
+	V8CBRIDGE_API typedef void(*GoReleaseHandlePtr)(int handle);
+
+	V8CBRIDGE_API typedef enum {
+		kInterceptNamed = 1,
+		kInterceptIndexed = 2,
+	} InterceptorFlags;
+
+	V8CBRIDGE_API typedef enum {
+		kInterceptGet,
+		kInterceptSet,
+		kInterceptQuery,
+		kInterceptEnumerate,
+	} InterceptOp;
+
+	// pointer to the function handling an operation on a named property
+	// (name.ptr is not NULL) or indexed property of the object wrapping the
+	// Go value with the given handle, see v8_Context_NewInterceptedObject.
+	// value is only set for kInterceptSet. The handler sets *intercepted if
+	// the operation was handled; otherwise V8 carries on as if there was no
+	// interceptor. kInterceptEnumerate returns an array of the keys.
+	V8CBRIDGE_API typedef ValueTuple(*GoInterceptorHandlerPtr)(int go_context_id, int handle, InterceptOp op,
+		String name, uint32_t index, ValueTuple* value, int* intercepted);
+
+	// pointer to the function reading the lines buffered by the native console
+	// of the Go context with the given id, see v8_Context_InjectConsole
+	V8CBRIDGE_API typedef void(*GoConsoleFlushHandlerPtr)(int go_context_id);
+
+	V8CBRIDGE_API typedef struct {
+		int entries;
+		int hits;
+		int misses;
+		int rejected;
+	} ModuleCacheStats;
+
+	// Entry points counted by the bridge statistics of an isolate, see
+	// v8_Isolate_GetBridgeStats. kStatGo* are the calls from V8 into Go.
+	// Every entry point that works on an isolate is counted, except:
+	//  - v8_Isolate_New and v8_SnapshotCreator_New, since statistics can
+	//    only be enabled once the isolate exists;
+	//  - v8_Isolate_Release and v8_SnapshotCreator_Create, which free the
+	//    counters before the call ends;
+	//  - v8_Isolate_GetBridgeStats and v8_Isolate_SetBridgeStats, which
+	//    would count themselves;
+	//  - accessors that don't call into V8: v8_SnapshotCreator_Isolate,
+	//    v8_PreparedCall_Args and v8_ExternalString_IsOneByte.
+	// Entry points without an isolate aren't counted either: compiled wasm
+	// modules and external strings are shared by all isolates, and the rest
+	// set up or tear down the process or free memory.
+	// NOTE! The names in v8_bridgestats.go must match.
+	V8CBRIDGE_API typedef enum {
+		kStatIsolateNewContext = 0,
+		kStatIsolateNewContextFromSnapshot,
+		kStatIsolateSetGlobalValue,
+		kStatIsolateSetGlobalCallback,
+		kStatIsolateNewStructTemplate,
+		kStatIsolateGetHeapStatistics,
+		kStatIsolateLowMemoryNotification,
+		kStatIsolatePumpMessageLoop,
+		kStatIsolateGetModuleCacheStats,
+		kStatIsolateClearModuleCache,
+		kStatIsolateTerminate,
+		kStatIsolateLiveValues,
+		kStatIsolateCurrentCaller,
+		kStatSnapshotCreatorAddContext,
+		kStatContextRun,
+		kStatContextEvalModule,
+		kStatContextStartStreaming,
+		kStatScriptStreamPush,
+		kStatScriptStreamClose,
+		kStatScriptStreamRun,
+		kStatScriptStreamCompile,
+		kStatScriptStreamRelease,
+		kStatScriptRun,
+		kStatScriptRelease,
+		kStatContextCompileWasm,
+		kStatContextInstantiateWasm,
+		kStatContextRegisterCallback,
+		kStatContextWrap,
+		kStatContextNewInterceptedObject,
+		kStatContextGlobal,
+		kStatContextRelease,
+		kStatContextRecycle,
+		kStatContextCreate,
+		kStatContextCreateTypedArray,
+		kStatContextCreateExternalString,
+		kStatContextInjectConsole,
+		kStatContextReadConsole,
+		kStatContextConsoleStats,
+		kStatContextLiveValues,
+		kStatValueGetOwnProperties,
+		kStatValueGet,
+		kStatValueSet,
+		kStatValueGetIdx,
+		kStatValueSetIdx,
+		kStatValueGetRange,
+		kStatValueSetRange,
+		kStatValueCall,
+		kStatValueNew,
+		kStatContextPrepareCall,
+		kStatPreparedCallCall,
+		kStatPreparedCallRelease,
+		kStatValueRelease,
+		kStatValueReleaseAll,
+		kStatValueString,
+		kStatValueFloat64,
+		kStatValueInt64,
+		kStatValueBool,
+		kStatValueBigInt64,
+		kStatValueBigUint64,
+		kStatValueBytes,
+		kStatValuePromiseInfo,
+		kStatGoCallback,
+		kStatGoAccessor,
+		kStatGoInterceptor,
+		kStatGoConsoleFlush,
+		kNumBridgeEntries,
+	} BridgeEntry;
+
+	// Bucket i of a latency histogram counts the calls that took from 2^i to
+	// 2^(i+1)-1 nanoseconds; the last bucket also counts longer calls.
+	enum { kBridgeHistogramBuckets = 32 };
+
+	V8CBRIDGE_API typedef struct {
+		uint64_t Calls;
+		uint64_t Nanos;
+		// Bytes of strings, buffers and arrays copied by the calls.
+		uint64_t Bytes;
+		uint64_t Histogram[kBridgeHistogramBuckets];
+	} BridgeEntryStats;
+
+	V8CBRIDGE_API typedef struct {
+		int Enabled;
+		// Persistent handles of values created for and released by Go.
+		uint64_t HandlesCreated;
+		uint64_t HandlesReleased;
+		BridgeEntryStats Entries[kNumBridgeEntries];
+	} BridgeStats;
+
 	// v8_Init must be called once before anything else.
-	V8CBRIDGE_API void v8_Init(GoCallbackHandlerPtr callback_handler, const char* icu_data_file);
+	//
+	// thread_pool_size is the number of worker threads V8 uses for background
+	// tasks such as concurrent marking and off-thread compilation, 0 lets V8
+	// choose based on the number of cores. If idle_task_support is non-zero,
+	// idle tasks posted by V8 are run by v8_Isolate_PumpMessageLoop.
+	// snapshot_file, if not NULL, names a file written by v8_Snapshot_WriteFile
+	// that is mapped and used as the default snapshot when no snapshot is
+	// embedded in the resources. If it can't be mapped, V8 is initialized all
+	// the same, with its built-in snapshot as the default, and the reason is
+	// returned.
+	V8CBRIDGE_API Error v8_Init(GoCallbackHandlerPtr callback_handler, const char* icu_data_file,
+		int thread_pool_size, int idle_task_support, const char* snapshot_file);
+
+	V8CBRIDGE_API void v8_SetModuleResolveHandler(GoResolveModuleHandlerPtr handler);
+	V8CBRIDGE_API void v8_SetWrapHandlers(GoAccessorHandlerPtr accessor_handler,
+		GoInterceptorHandlerPtr interceptor_handler, GoReleaseHandlePtr release_handler);
+	V8CBRIDGE_API void v8_SetConsoleFlushHandler(GoConsoleFlushHandlerPtr handler);
 
 	// typedef unsigned int uint32_t;
 
 	V8CBRIDGE_API StartupData v8_CreateSnapshotDataBlob(const char* js, int includeCompiledFnCode, StartupData* startup_data);
 
-	// Pass NULL as startup_data to use the default snapshot.
+	// A snapshot creator owns an isolate whose contexts can be set up with the
+	// usual v8_Context_* functions (including callbacks bound by name) and then
+	// added to the snapshot with v8_SnapshotCreator_AddContext. The creator
+	// must be used from a single thread and is freed by v8_SnapshotCreator_Create.
+	V8CBRIDGE_API extern SnapshotCreatorPtr v8_SnapshotCreator_New(StartupData* startup_data);
+	V8CBRIDGE_API extern IsolatePtr         v8_SnapshotCreator_Isolate(SnapshotCreatorPtr creator);
+	V8CBRIDGE_API extern int                v8_SnapshotCreator_AddContext(SnapshotCreatorPtr creator,
+		ContextPtr ctx);
+	V8CBRIDGE_API extern StartupData        v8_SnapshotCreator_Create(SnapshotCreatorPtr creator,
+		int include_compiled_fn_code);
+
+	// Writes the snapshot to path, prefixed with a header recording the V8
+	// version and a checksum.
+	V8CBRIDGE_API extern Error v8_Snapshot_WriteFile(const char* path, StartupData data);
+	// Maps a file written by v8_Snapshot_WriteFile read-only into memory and
+	// points out at the snapshot blob. Files are mapped once per process and
+	// stay mapped, so the returned data must not be freed.
+	V8CBRIDGE_API extern Error v8_Snapshot_MapFile(const char* path, StartupData* out);
+
+	// Pass NULL as startup_data to use the default snapshot. The snapshot data
+	// must stay valid until the isolate is released.
 	V8CBRIDGE_API extern IsolatePtr v8_Isolate_New(StartupData* startup_data);
 
-	V8CBRIDGE_API extern ContextPtr v8_Isolate_NewContext(IsolatePtr isolate);
+	// go_context_id identifies the Go context that callbacks bound by name are
+	// dispatched to.
+	V8CBRIDGE_API extern ContextPtr v8_Isolate_NewContext(IsolatePtr isolate, int go_context_id);
+	// Creates a context from the context added at index to the isolate's
+	// snapshot, or returns NULL if there is no such context.
+	V8CBRIDGE_API extern ContextPtr v8_Isolate_NewContextFromSnapshot(IsolatePtr isolate, int index,
+		int go_context_id);
 	V8CBRIDGE_API extern void       v8_Isolate_Terminate(IsolatePtr isolate);
 	V8CBRIDGE_API extern void       v8_Isolate_Release(IsolatePtr isolate);
 
 	V8CBRIDGE_API extern HeapStatistics       v8_Isolate_GetHeapStatistics(IsolatePtr isolate);
+
+	// Modules are compiled with the code cache of an earlier compilation of
+	// the same name and source in the isolate, if there is one.
+	V8CBRIDGE_API extern ModuleCacheStats     v8_Isolate_GetModuleCacheStats(IsolatePtr isolate);
+	V8CBRIDGE_API extern void                 v8_Isolate_ClearModuleCache(IsolatePtr isolate);
 	V8CBRIDGE_API extern void                 v8_Isolate_LowMemoryNotification(IsolatePtr isolate);
 
+	// Bridge statistics are collected per isolate while they are enabled, at
+	// the cost of reading the clock twice per call. Durations include the
+	// time spent waiting for the isolate lock and in nested calls, e.g. Go
+	// callbacks made by a script. Functions that aren't tied to an isolate,
+	// such as v8_Free, aren't counted.
+	V8CBRIDGE_API extern void                 v8_Isolate_SetBridgeStats(IsolatePtr isolate, int enabled);
+	V8CBRIDGE_API extern void                 v8_Isolate_GetBridgeStats(IsolatePtr isolate, BridgeStats* out);
+
+	// Number of value handles held by Go for the context, or for all contexts
+	// of the isolate, that haven't been released yet.
+	V8CBRIDGE_API extern int v8_Context_LiveValues(ContextPtr ctx);
+	V8CBRIDGE_API extern int v8_Isolate_LiveValues(IsolatePtr isolate);
+
+	// Runs all foreground tasks that the platform has queued for the isolate
+	// and, if idle task support is enabled, idle tasks for up to
+	// idle_time_in_seconds. Returns the number of foreground tasks run.
+	V8CBRIDGE_API extern int                  v8_Isolate_PumpMessageLoop(IsolatePtr isolate,
+		double idle_time_in_seconds);
+
 	V8CBRIDGE_API extern ValueTuple     v8_Context_Run(ContextPtr ctx,
 		const char* code, const char* filename);
+
+	// Compiles, instantiates and evaluates the module and returns its namespace
+	// object. Imports are resolved with the module resolve handler. Modules are
+	// identified by name within a context, so if a module with that name has
+	// been evaluated in the context already, its namespace is returned.
+	V8CBRIDGE_API extern ValueTuple     v8_Context_EvalModule(ContextPtr ctx,
+		const char* name, const char* source);
+
+	// Streaming compilation: the source is pushed in chunks with
+	// v8_ScriptStream_Push while v8_ScriptStream_Run parses it on another
+	// thread without holding the isolate lock. After v8_ScriptStream_Close and
+	// once v8_ScriptStream_Run has returned, v8_ScriptStream_Compile finishes
+	// the compilation and releases the stream. v8_ScriptStream_Release
+	// abandons a stream instead.
+	V8CBRIDGE_API extern ScriptStreamPtr v8_Context_StartStreaming(ContextPtr ctx);
+	V8CBRIDGE_API extern void            v8_ScriptStream_Push(ScriptStreamPtr stream,
+		const char* data, int len);
+	V8CBRIDGE_API extern void            v8_ScriptStream_Close(ScriptStreamPtr stream);
+	V8CBRIDGE_API extern void            v8_ScriptStream_Run(ScriptStreamPtr stream);
+	V8CBRIDGE_API extern ScriptTuple     v8_ScriptStream_Compile(ContextPtr ctx,
+		ScriptStreamPtr stream, const char* filename);
+	V8CBRIDGE_API extern void            v8_ScriptStream_Release(ScriptStreamPtr stream);
+
+	V8CBRIDGE_API extern ValueTuple v8_Script_Run(ContextPtr ctx, ScriptPtr script);
+	// Scripts belong to the isolate and may be released after their context.
+	V8CBRIDGE_API extern void       v8_Script_Release(IsolatePtr isolate, ScriptPtr script);
+
+	// A compiled wasm module is not bound to an isolate: the same handle can
+	// be instantiated in any context of any isolate, sharing the compiled
+	// code. v8_Context_CompileWasm deserializes serialized if it was produced
+	// by the same V8 version and flags and compiles wire_bytes otherwise.
+	// serialized may be empty. v8_WasmModule_Serialize returns an empty array
+	// if the module can't be serialized (yet). Returned arrays are allocated
+	// with malloc.
+	V8CBRIDGE_API extern WasmModuleTuple v8_Context_CompileWasm(ContextPtr ctx,
+		const char* serialized, int serialized_len, const char* wire_bytes, int wire_bytes_len);
+	V8CBRIDGE_API extern ValueTuple      v8_Context_InstantiateWasm(ContextPtr ctx,
+		WasmModulePtr module, PersistentValuePtr imports);
+	V8CBRIDGE_API extern ByteArray       v8_WasmModule_Serialize(WasmModulePtr module);
+	V8CBRIDGE_API extern ByteArray       v8_WasmModule_WireBytes(WasmModulePtr module);
+	V8CBRIDGE_API extern void            v8_WasmModule_Release(WasmModulePtr module);
+
+	// Creates a function calling the Go callback with the given id. Unless
+	// capture_caller is set, the callback gets an empty CallerInfo, which
+	// saves walking the stack on every call.
 	V8CBRIDGE_API extern PersistentValuePtr v8_Context_RegisterCallback(ContextPtr ctx,
-		const char* name, const char* id);
+		const char* name, const char* id, int capture_caller);
+	// Returns the script location calling the current Go callback. It must be
+	// called from the callback's thread, elsewhere the location is empty; the
+	// strings are allocated with malloc.
+	V8CBRIDGE_API extern CallerInfo v8_Isolate_CurrentCaller(IsolatePtr isolate);
+	// Struct templates are object templates whose properties are accessors
+	// calling the Go accessor handler with the index of the property. Name i
+	// is names[offsets[i]:offsets[i+1]]. Properties flagged in methods are
+	// read-only functions instead, shared by all objects of the template,
+	// which call the Go callback handler with the id
+	// "<context id>:#<handle>.<index>". Templates live as long as the isolate;
+	// the id of the new one is returned.
+	V8CBRIDGE_API extern int                v8_Isolate_NewStructTemplate(IsolatePtr isolate,
+		const char* names, const int* offsets, const char* methods, int count);
+	// Creates an object from a struct template that wraps the Go value with
+	// the given handle. The handle is released when the object is collected
+	// or the isolate is released.
+	V8CBRIDGE_API extern PersistentValuePtr v8_Context_Wrap(ContextPtr ctx, int template_id, int handle);
+	// Creates an object whose named and/or indexed properties, as selected by
+	// InterceptorFlags, are handled by the Go interceptor handler. The handle
+	// is released like that of v8_Context_Wrap.
+	V8CBRIDGE_API extern PersistentValuePtr v8_Context_NewInterceptedObject(ContextPtr ctx, int flags,
+		int handle);
 	V8CBRIDGE_API extern PersistentValuePtr v8_Context_Global(ContextPtr ctx);
+	// Releases the context along with the handles of its values that Go
+	// still holds. Calls on those values must pass a NULL context afterwards.
 	V8CBRIDGE_API extern void               v8_Context_Release(ContextPtr ctx);
+	// Replaces the context with a fresh one created from the isolate's global
+	// template. The global proxy is reused, so existing references to the
+	// global object see the new context's global.
+	V8CBRIDGE_API extern Error              v8_Context_Recycle(ContextPtr ctx);
+
+	V8CBRIDGE_API typedef enum {
+		kConsoleStdout = 0, // console.log and console.info
+		kConsoleStderr,     // console.warn and console.error
+	} ConsoleStream;
+
+	V8CBRIDGE_API typedef struct {
+		// Prepended to every line; the string is copied.
+		String Prefix;
+		int Colorize;
+		// Size in bytes of the buffer shared by the streams, and the number of
+		// buffered bytes at which the console flush handler is called.
+		int BufferSize;
+		int FlushSize;
+		// If not 0, the flush handler is also called when a line is logged
+		// this long after the last read.
+		int64_t FlushIntervalNanos;
+	} ConsoleOptions;
+
+	V8CBRIDGE_API typedef struct {
+		// Lines buffered, and lines dropped because they didn't fit into
+		// the buffer.
+		uint64_t Lines;
+		uint64_t Dropped;
+		// Calls of the console flush handler.
+		uint64_t Flushes;
+	} ConsoleStats;
+
+	// Sets the log, info, warn and error methods of the global console object,
+	// which is created if there is none, to native functions formatting their
+	// arguments into a buffer of the context instead of calling Go for every
+	// line. Lines are written out by Go with v8_Context_ReadConsole, e.g. when
+	// the console flush handler is called. Injecting the console again
+	// replaces the options and discards lines that haven't been read.
+	V8CBRIDGE_API extern Error        v8_Context_InjectConsole(ContextPtr ctx, ConsoleOptions options);
+	// Moves up to len bytes of the oldest buffered output to buf, all of the
+	// same stream, sets *stream to it and returns the number of bytes moved;
+	// 0 once nothing is buffered. Reading until 0 is returned yields the lines
+	// of both streams in the order they were logged.
+	V8CBRIDGE_API extern int          v8_Context_ReadConsole(ContextPtr ctx, char* buf, int len,
+		ConsoleStream* stream);
+	V8CBRIDGE_API extern ConsoleStats v8_Context_ConsoleStats(ContextPtr ctx);
 
 	V8CBRIDGE_API typedef enum {
 		tSTRING,
@@ -173,6 +557,8 @@ extern "C" {
 		tARRAYBUFFER,
 		tUNDEFINED,
 		tDATE, // uses Float64 for msec since Unix epoch
+		tBIGINT, // uses Int64
+		tBIGUINT, // uses the bits of Int64 as a uint64_t
 	} ImmediateValueType;
 
 	V8CBRIDGE_API typedef struct {
@@ -187,12 +573,65 @@ extern "C" {
 
 	V8CBRIDGE_API extern PersistentValuePtr v8_Context_Create(ContextPtr ctx, ImmediateValue val);
 
+	// A contiguous span of array elements. Only the member matching Type is
+	// used: tFLOAT64 -> Float64s, tBOOL -> Bools, tSTRING -> Strings with
+	// element i at Strings[Offsets[i]:Offsets[i+1]], any other type ->
+	// Values, holding one handle per element. Ranges returned by the bridge
+	// are allocated with malloc, one block per member.
+	V8CBRIDGE_API typedef struct {
+		ImmediateValueType Type;
+		int Length;
+		double* Float64s;
+		char* Bools;
+		char* Strings;
+		int* Offsets;
+		ValueTuple* Values;
+		Error error_msg;
+	} ArrayRange;
+
+	// The global template is shared by all contexts created with
+	// v8_Isolate_NewContext or recycled with v8_Context_Recycle afterwards.
+	// Only primitive values (string, bool, number, undefined) can be set.
+	V8CBRIDGE_API extern Error v8_Isolate_SetGlobalValue(IsolatePtr isolate, const char* name,
+		ImmediateValue val);
+	// Adds a function calling the Go callback with the given id to the global
+	// template, see v8_Context_RegisterCallback. Ids of callbacks bound by name
+	// ("@name") are the only ones valid in every context.
+	V8CBRIDGE_API extern void  v8_Isolate_SetGlobalCallback(IsolatePtr isolate, const char* name,
+		const char* id);
+
+	V8CBRIDGE_API typedef enum {
+		kPropertiesEnumerableOnly = 1,
+		kPropertiesIncludeSymbols = 2,
+		kPropertiesWithValues = 4,
+	} PropertiesFlags;
+
+	// Own properties of an object. Key i is Keys[Offsets[i]:Offsets[i+1]];
+	// integer keys are converted to strings and symbol keys are rendered as
+	// "Symbol(description)". Values is only set with kPropertiesWithValues.
+	// Keys, Offsets and Values are allocated with malloc.
+	V8CBRIDGE_API typedef struct {
+		int Length;
+		char* Keys;
+		int* Offsets;
+		ValueTuple* Values;
+		Error error_msg;
+	} Properties;
+
+	V8CBRIDGE_API extern Properties  v8_Value_GetOwnProperties(ContextPtr ctx, PersistentValuePtr value,
+		int flags);
 	V8CBRIDGE_API extern ValueTuple  v8_Value_Get(ContextPtr ctx, PersistentValuePtr value, const char* field);
 	V8CBRIDGE_API extern Error       v8_Value_Set(ContextPtr ctx, PersistentValuePtr value,
 		const char* field, PersistentValuePtr new_value);
 	V8CBRIDGE_API extern ValueTuple  v8_Value_GetIdx(ContextPtr ctx, PersistentValuePtr value, int idx);
 	V8CBRIDGE_API extern Error       v8_Value_SetIdx(ContextPtr ctx, PersistentValuePtr value,
 		int idx, PersistentValuePtr new_value);
+	// Reads count elements starting at start in one call. For packed types
+	// every element must be of that type, otherwise an error is returned.
+	V8CBRIDGE_API extern ArrayRange  v8_Value_GetRange(ContextPtr ctx, PersistentValuePtr value,
+		int start, int count, ImmediateValueType type);
+	V8CBRIDGE_API extern Error       v8_Value_SetRange(ContextPtr ctx, PersistentValuePtr value,
+		int start, ArrayRange range);
 	V8CBRIDGE_API extern ValueTuple  v8_Value_Call(ContextPtr ctx,
 		PersistentValuePtr func,
 		PersistentValuePtr self,
@@ -200,13 +639,69 @@ extern "C" {
 	V8CBRIDGE_API extern ValueTuple  v8_Value_New(ContextPtr ctx,
 		PersistentValuePtr func,
 		int argc, PersistentValuePtr* argv);
+
+	// An argument of a prepared call. Type selects the member that is passed:
+	// tFLOAT64, tINT64, tBOOL, tSTRING (Str, allocated with malloc and owned
+	// by the call), tOBJECT (Handle, undefined if NULL) or tUNDEFINED.
+	V8CBRIDGE_API typedef struct {
+		ImmediateValueType Type;
+		int Bool;
+		double Float64;
+		int64_t Int64;
+		String Str;
+		PersistentValuePtr Handle;
+	} CallArg;
+
+	// Binds func and self (NULL for the global object) for repeated calls with
+	// nargs arguments, which are written to the slots returned by
+	// v8_PreparedCall_Args before each call. They start out undefined. A
+	// prepared call belongs to its context and must not be used by two
+	// threads at once.
+	V8CBRIDGE_API extern PreparedCallPtr v8_Context_PrepareCall(ContextPtr ctx,
+		PersistentValuePtr func, PersistentValuePtr self, int nargs);
+	V8CBRIDGE_API extern CallArg*        v8_PreparedCall_Args(PreparedCallPtr call);
+	// Calls the function with the current arguments. With discard_result, the
+	// result isn't returned, which saves creating a handle for it.
+	V8CBRIDGE_API extern ValueTuple      v8_PreparedCall_Call(ContextPtr ctx, PreparedCallPtr call,
+		int discard_result);
+	// ctx may be NULL if the context has been released already.
+	V8CBRIDGE_API extern void            v8_PreparedCall_Release(ContextPtr ctx, PreparedCallPtr call);
+
 	V8CBRIDGE_API extern void   v8_Value_Release(ContextPtr ctx, PersistentValuePtr value);
+	// Releases count values at once, skipping NULL entries.
+	V8CBRIDGE_API extern void   v8_Value_ReleaseAll(ContextPtr ctx, PersistentValuePtr* values, int count);
 	V8CBRIDGE_API extern String v8_Value_String(ContextPtr ctx, PersistentValuePtr value);
 
 	V8CBRIDGE_API extern double    v8_Value_Float64(ContextPtr ctx, PersistentValuePtr value);
 	V8CBRIDGE_API extern int64_t   v8_Value_Int64(ContextPtr ctx, PersistentValuePtr value);
 	V8CBRIDGE_API extern int       v8_Value_Bool(ContextPtr ctx, PersistentValuePtr value);
+	// Read BigInts, and numbers that are integers, as 64-bit integers.
+	// *lossless is set to 0 if the value was truncated or isn't an integer.
+	V8CBRIDGE_API extern int64_t   v8_Value_BigInt64(ContextPtr ctx, PersistentValuePtr value, int* lossless);
+	V8CBRIDGE_API extern uint64_t  v8_Value_BigUint64(ContextPtr ctx, PersistentValuePtr value, int* lossless);
+	// Returns the memory of an ArrayBuffer, or the range of an ArrayBufferView
+	// (typed array or DataView) within its buffer. The memory is owned by V8.
+	// Memory larger than INT_MAX bytes is returned as empty, use
+	// v8_Value_ByteView for it.
 	V8CBRIDGE_API extern ByteArray v8_Value_Bytes(ContextPtr ctx, PersistentValuePtr value);
+	// Like v8_Value_Bytes, returning the size in *byte_length.
+	V8CBRIDGE_API extern const char* v8_Value_ByteView(ContextPtr ctx, PersistentValuePtr value,
+		size_t* byte_length);
+	// Creates a typed array of the given kind (kUint8Array ... kFloat64Array)
+	// holding a copy of data.
+	V8CBRIDGE_API extern PersistentValuePtr v8_Context_CreateTypedArray(ContextPtr ctx, Kind kind,
+		const char* data, size_t byte_length);
+
+	// External strings reference text in C memory instead of copying it into
+	// the V8 heap. The text is converted from UTF-8 once, into Latin-1 if
+	// possible and UTF-16 otherwise, and can then back any number of strings in
+	// any isolate. It is freed when it has been released and all those strings
+	// have been collected.
+	V8CBRIDGE_API extern ExternalStringPtr v8_ExternalString_New(const char* utf8, int len);
+	V8CBRIDGE_API extern int               v8_ExternalString_IsOneByte(ExternalStringPtr text);
+	V8CBRIDGE_API extern void              v8_ExternalString_Release(ExternalStringPtr text);
+	V8CBRIDGE_API extern ValueTuple        v8_Context_CreateExternalString(ContextPtr ctx,
+		ExternalStringPtr text);
 
 	V8CBRIDGE_API extern ValueTuple v8_Value_PromiseInfo(ContextPtr ctx, PersistentValuePtr value,
 		int* promise_state);
@@ -0,0 +1,211 @@
+package v8
+
+// #include <stdlib.h>
+// #include "v8_c_bridge.h"
+import "C"
+
+import (
+	"errors"
+	"fmt"
+	"runtime"
+	"unsafe"
+)
+
+// PreparedCall calls the same function repeatedly, without the allocations
+// that Value.Call makes on every call. The arguments are written into slots
+// in C memory, which keep their value between calls, and primitive arguments
+// don't need a Value of their own. This pays off for functions that are
+// called very often, such as event handlers.
+//
+// A PreparedCall must not be used by several goroutines at once.
+type PreparedCall struct {
+	ctx  *Context
+	ptr  C.PreparedCallPtr
+	args []C.CallArg
+	// The capacity of the string buffer of each slot, and the values passed
+	// as arguments, which must stay alive until the call.
+	caps   []int
+	values []*Value
+}
+
+var errPreparedCallReleased = errors.New("PreparedCall has been released")
+
+// Prepare binds v and its receiver this (nil for the global object) for calls
+// with nargs arguments. The arguments are undefined until they are set. this
+// must belong to the context of v.
+func (v *Value) Prepare(this *Value, nargs int) (*PreparedCall, error) {
+	if nargs < 0 {
+		return nil, fmt.Errorf("Invalid number of arguments: %d", nargs)
+	}
+	var thisPtr C.PersistentValuePtr
+	if this != nil {
+		if err := v.ctx.checkOwnValue(this); err != nil {
+			return nil, err
+		}
+		thisPtr = this.ptr
+	}
+	ptr := C.v8_Context_PrepareCall(v.ctx.ptr, v.ptr, thisPtr, C.int(nargs))
+	if ptr == nil {
+		return nil, errContextReleased
+	}
+	c := &PreparedCall{
+		ctx:    v.ctx,
+		ptr:    ptr,
+		caps:   make([]int, nargs),
+		values: make([]*Value, nargs),
+	}
+	if nargs > 0 {
+		c.args = (*[1 << 20]C.CallArg)(unsafe.Pointer(C.v8_PreparedCall_Args(c.ptr)))[:nargs:nargs]
+	}
+	if c.ctx.inSnapshotCreator {
+		c.ctx.snapshotHandles = append(c.ctx.snapshotHandles, c.Release)
+	} else {
+		runtime.SetFinalizer(c, (*PreparedCall).Release)
+	}
+	return c, nil
+}
+
+// checkOwnValue fails unless v is a live value of the context. Prepared calls
+// keep the handles of their arguments, which go away with their context.
+func (ctx *Context) checkOwnValue(v *Value) error {
+	if v.ptr == nil || ctx.ptr == nil {
+		return errContextReleased
+	}
+	if v.ctx != ctx {
+		return errors.New("Value belongs to another context")
+	}
+	return nil
+}
+
+// arg returns the slot of argument i after forgetting its previous value.
+func (c *PreparedCall) arg(i int) (*C.CallArg, error) {
+	if c.ptr == nil {
+		return nil, errPreparedCallReleased
+	}
+	if i < 0 || i >= len(c.args) {
+		return nil, fmt.Errorf("Argument %d out of range for %d arguments", i, len(c.args))
+	}
+	c.values[i] = nil
+	return &c.args[i], nil
+}
+
+// SetFloat64 sets argument i to the number f.
+func (c *PreparedCall) SetFloat64(i int, f float64) error {
+	arg, err := c.arg(i)
+	if err != nil {
+		return err
+	}
+	arg.Type = C.tFLOAT64
+	arg.Float64 = C.double(f)
+	return nil
+}
+
+// SetInt64 sets argument i to the number n.
+func (c *PreparedCall) SetInt64(i int, n int64) error {
+	arg, err := c.arg(i)
+	if err != nil {
+		return err
+	}
+	arg.Type = C.tINT64
+	arg.Int64 = C.int64_t(n)
+	return nil
+}
+
+// SetBool sets argument i to b.
+func (c *PreparedCall) SetBool(i int, b bool) error {
+	arg, err := c.arg(i)
+	if err != nil {
+		return err
+	}
+	arg.Type = C.tBOOL
+	arg.Bool = boolToInt(b)
+	return nil
+}
+
+// SetString sets argument i to the string s, which is copied into a buffer
+// that is reused by later calls.
+func (c *PreparedCall) SetString(i int, s string) error {
+	arg, err := c.arg(i)
+	if err != nil {
+		return err
+	}
+	if len(s) > c.caps[i] {
+		arg.Str.ptr = (*C.char)(C.realloc(unsafe.Pointer(arg.Str.ptr), C.size_t(len(s))))
+		c.caps[i] = len(s)
+	}
+	if len(s) > 0 {
+		copy((*[1 << 30]byte)(unsafe.Pointer(arg.Str.ptr))[:len(s):len(s)], s)
+	}
+	arg.Str.len = C.int(len(s))
+	arg.Type = C.tSTRING
+	return nil
+}
+
+// SetValue sets argument i to v, or to undefined if v is nil. v must belong
+// to the context of the call.
+func (c *PreparedCall) SetValue(i int, v *Value) error {
+	if v != nil {
+		if err := c.ctx.checkOwnValue(v); err != nil {
+			return err
+		}
+	}
+	arg, err := c.arg(i)
+	if err != nil {
+		return err
+	}
+	arg.Type = C.tOBJECT
+	arg.Handle = nil
+	if v != nil {
+		c.values[i] = v
+		arg.Handle = v.ptr
+	}
+	return nil
+}
+
+// SetUndefined sets argument i to undefined.
+func (c *PreparedCall) SetUndefined(i int) error {
+	arg, err := c.arg(i)
+	if err != nil {
+		return err
+	}
+	arg.Type = C.tUNDEFINED
+	return nil
+}
+
+// Call calls the function with the current arguments and returns its result.
+func (c *PreparedCall) Call() (*Value, error) {
+	return c.call(false)
+}
+
+// Invoke calls the function with the current arguments like Call, but drops
+// the result, which saves creating a Value for it.
+func (c *PreparedCall) Invoke() error {
+	_, err := c.call(true)
+	return err
+}
+
+func (c *PreparedCall) call(discardResult bool) (*Value, error) {
+	if c.ptr == nil {
+		return nil, errPreparedCallReleased
+	}
+	addRef(c.ctx)
+	ret := C.v8_PreparedCall_Call(c.ctx.ptr, c.ptr, boolToInt(discardResult))
+	decRef(c.ctx)
+	return c.ctx.split(ret)
+}
+
+// Release frees the call immediately instead of waiting for the garbage
+// collector. Its methods fail afterwards.
+func (c *PreparedCall) Release() {
+	if c.ptr != nil {
+		// The handles of the call belong to the context: once it has been
+		// released, only the call itself is freed.
+		c.ctx.releaseMutex.RLock()
+		C.v8_PreparedCall_Release(c.ctx.ptr, c.ptr)
+		c.ctx.releaseMutex.RUnlock()
+	}
+	c.ptr = nil
+	c.args = nil
+	c.values = nil
+	runtime.SetFinalizer(c, nil)
+}
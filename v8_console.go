@@ -0,0 +1,188 @@
+package v8
+
+// #include <stdlib.h>
+// #include "v8_c_bridge.h"
+import "C"
+
+import (
+	"fmt"
+	"io"
+	"sync"
+	"time"
+	"unsafe"
+)
+
+// ConsoleOptions configures the native console of a context, see
+// Context.InjectConsole.
+type ConsoleOptions struct {
+	// Stdout receives the lines of console.log and console.info, Stderr those
+	// of console.warn and console.error. Lines for a nil writer are discarded.
+	Stdout, Stderr io.Writer
+	// Prefix is prepended to every line.
+	Prefix string
+	// Colorize wraps warnings and errors in ANSI color escape codes.
+	Colorize bool
+	// BufferSize is the size in bytes of the buffer shared by both streams,
+	// 64 KiB if 0. Lines that don't fit even after flushing are dropped.
+	// Buffered lines are written out in the order they were logged, so
+	// streams going to the same writer stay interleaved.
+	BufferSize int
+	// FlushSize is the number of buffered bytes at which the lines are
+	// written out while a script runs, half of BufferSize if 0.
+	FlushSize int
+	// FlushInterval, if not 0, also has the lines written out when a line is
+	// logged this long after the last flush.
+	FlushInterval time.Duration
+}
+
+const defaultConsoleBufferSize = 64 << 10
+
+// Console is the native console of a context, see Context.InjectConsole.
+type Console struct {
+	ctx  *Context
+	opts ConsoleOptions
+
+	mu  sync.Mutex
+	err error
+}
+
+// ConsoleStats are the statistics of a native console.
+type ConsoleStats struct {
+	// Lines counts the lines logged, Dropped those dropped because they
+	// didn't fit into the buffer.
+	Lines, Dropped uint64
+	// Flushes counts the flushes made while a script was running, because the
+	// buffer was full enough or the flush interval had passed.
+	Flushes uint64
+}
+
+// consoleBufs holds the buffers that flushes read the console output into.
+// They aren't kept per console since a context can be used by several
+// goroutines, and a flush during a script must not wait for another.
+var consoleBufs = sync.Pool{New: func() interface{} {
+	buf := make([]byte, 16<<10)
+	return &buf
+}}
+
+// InjectConsole sets console.log, console.info, console.warn and
+// console.error of the context to native functions. Unlike the Go callbacks
+// of v8console.Config.Inject, they format their arguments inside V8 and
+// buffer the lines, which are written out in batches: while a script runs,
+// once FlushSize bytes are buffered or FlushInterval has passed, and when
+// Eval, EvalModule or Script.Run returns. Lines logged by scripts that run
+// otherwise, e.g. promise jobs run by PumpMessageLoop, are written out by the
+// next of these or by Flush.
+//
+// Lines are formatted like those of v8console: the arguments converted to
+// strings and separated by spaces, with warnings and errors prefixed by the
+// location of the caller. Injecting a console again replaces the previous
+// one.
+func (ctx *Context) InjectConsole(opts ConsoleOptions) (*Console, error) {
+	if opts.BufferSize <= 0 {
+		opts.BufferSize = defaultConsoleBufferSize
+	}
+	if opts.FlushSize <= 0 || opts.FlushSize > opts.BufferSize {
+		opts.FlushSize = opts.BufferSize / 2
+	}
+	// The lines of the previous console are discarded by the bridge.
+	ctx.flushConsole()
+
+	prefix := C.CString(opts.Prefix)
+	defer C.free(unsafe.Pointer(prefix))
+	errmsg := C.v8_Context_InjectConsole(ctx.ptr, C.ConsoleOptions{
+		Prefix:             C.String{ptr: prefix, len: C.int(len(opts.Prefix))},
+		Colorize:           boolToInt(opts.Colorize),
+		BufferSize:         C.int(opts.BufferSize),
+		FlushSize:          C.int(opts.FlushSize),
+		FlushIntervalNanos: C.int64_t(opts.FlushInterval),
+	})
+	if err := ctx.iso.convertErrorMsg(errmsg); err != nil {
+		return nil, err
+	}
+	c := &Console{ctx: ctx, opts: opts}
+	ctx.console = c
+	return c, nil
+}
+
+// Flush writes out the buffered lines. It returns the first error returned
+// by a writer since the last call, including the errors of the flushes made
+// while scripts ran.
+func (c *Console) Flush() error {
+	c.flush()
+	c.mu.Lock()
+	err := c.err
+	c.err = nil
+	c.mu.Unlock()
+	return err
+}
+
+// Stats returns the statistics of the console.
+func (c *Console) Stats() ConsoleStats {
+	s := C.v8_Context_ConsoleStats(c.ctx.ptr)
+	return ConsoleStats{
+		Lines:   uint64(s.Lines),
+		Dropped: uint64(s.Dropped),
+		Flushes: uint64(s.Flushes),
+	}
+}
+
+func (c *Console) flush() {
+	bufp := consoleBufs.Get().(*[]byte)
+	defer consoleBufs.Put(bufp)
+	buf := *bufp
+
+	var stream C.ConsoleStream
+	for {
+		// The context may be released concurrently, e.g. by its finalizer
+		// after the last flush of the context's release.
+		var n C.int
+		c.ctx.releaseMutex.RLock()
+		if c.ctx.ptr != nil {
+			n = C.v8_Context_ReadConsole(c.ctx.ptr, (*C.char)(unsafe.Pointer(&buf[0])), C.int(len(buf)), &stream)
+		}
+		c.ctx.releaseMutex.RUnlock()
+		if n == 0 {
+			return
+		}
+		w := c.opts.Stdout
+		if stream == C.kConsoleStderr {
+			w = c.opts.Stderr
+		}
+		if w != nil {
+			if _, err := w.Write(buf[:n]); err != nil {
+				c.setErr(err)
+			}
+		}
+	}
+}
+
+func (c *Console) setErr(err error) {
+	c.mu.Lock()
+	if c.err == nil {
+		c.err = err
+	}
+	c.mu.Unlock()
+}
+
+func (ctx *Context) flushConsole() {
+	if ctx.console != nil {
+		ctx.console.flush()
+	}
+}
+
+//export goConsoleFlushHandler
+func goConsoleFlushHandler(ctxId C.int) {
+	ctx := callbackContext(ctxId)
+	if ctx == nil || ctx.console == nil {
+		return
+	}
+	c := ctx.console
+
+	// Panics must not unwind through the C stack, see goCallbackHandler.
+	defer func() {
+		if v := recover(); v != nil {
+			c.setErr(fmt.Errorf("Panic writing console output: %v", v))
+		}
+	}()
+	c.flush()
+}
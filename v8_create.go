@@ -74,11 +74,30 @@ var timeType = reflect.TypeOf(time.Time{})
 //    {
 //       Buf: new Uint8Array([1,2,3]).buffer
 //    }
+//
+// Numeric slices tagged as 'v8:"typedarray"' will be converted into the
+// matching typed array, e.g. a []float64 into a Float64Array, see
+// CreateTypedArray.
+//
+// Integers, and slices of integers, tagged as 'v8:"bigint"' will be converted
+// into BigInts, which keep all 64 bits. ReadInto reads BigInts into integer
+// fields regardless of tags.
 func (ctx *Context) Create(val interface{}) (*Value, error) {
 	v, _, err := ctx.create(reflect.ValueOf(val))
 	return v, err
 }
 
+// CreateBigInt creates a BigInt. Unlike numbers, these represent all int64
+// values exactly.
+func (ctx *Context) CreateBigInt(i int64) *Value {
+	return ctx.createVal(C.ImmediateValue{Type: C.tBIGINT, Int64: C.int64_t(i)}, mask(KindBigInt))
+}
+
+// CreateBigUint64 creates a BigInt from a uint64.
+func (ctx *Context) CreateBigUint64(u uint64) *Value {
+	return ctx.createVal(C.ImmediateValue{Type: C.tBIGUINT, Int64: C.int64_t(u)}, mask(KindBigInt))
+}
+
 func (ctx *Context) createVal(v C.ImmediateValue, kinds kindMask) *Value {
 	return ctx.newValue(C.v8_Context_Create(ctx.ptr, v), C.KindMask(kinds))
 }
@@ -112,6 +131,8 @@ func (ctx *Context) createWithTags(val reflect.Value, tags []string) (v *Value,
 		return ctx.createVal(C.ImmediateValue{Type: C.tDATE, Float64: msec}, unionKindDate), true, nil
 	}
 
+	bigInt := hasTag(tags, "bigint")
+
 	switch val.Kind() {
 	case reflect.Bool:
 		bval := C.int(0)
@@ -122,6 +143,14 @@ func (ctx *Context) createWithTags(val reflect.Value, tags []string) (v *Value,
 	case reflect.Int, reflect.Int8, reflect.Int16, reflect.Int32, reflect.Int64,
 		reflect.Uint, reflect.Uint8, reflect.Uint16, reflect.Uint32, reflect.Uint64,
 		reflect.Float32, reflect.Float64:
+		if bigInt {
+			switch val.Kind() {
+			case reflect.Int, reflect.Int8, reflect.Int16, reflect.Int32, reflect.Int64:
+				return ctx.CreateBigInt(val.Int()), true, nil
+			case reflect.Uint, reflect.Uint8, reflect.Uint16, reflect.Uint32, reflect.Uint64:
+				return ctx.CreateBigUint64(val.Uint()), true, nil
+			}
+		}
 		num := C.double(val.Convert(float64Type).Float())
 		return ctx.createVal(C.ImmediateValue{Type: C.tFLOAT64, Float64: num}, mask(KindNumber)), true, nil
 	case reflect.String:
@@ -153,27 +182,43 @@ func (ctx *Context) createWithTags(val reflect.Value, tags []string) (v *Value,
 		for _, key := range keys {
 			v, wasAllocated, err := ctx.create(val.MapIndex(key))
 			if err != nil {
+				ob.release()
 				return nil, false, fmt.Errorf("map key %q: %v", key.String(), err)
 			}
-			if err := ob.Set(key.String(), v); err != nil {
-				return nil, false, err
-			}
+			err = ob.Set(key.String(), v)
 			if wasAllocated {
 				v.release()
 			}
+			if err != nil {
+				ob.release()
+				return nil, false, err
+			}
 		}
 		return ob, true, nil
 	case reflect.Struct:
 		ob := ctx.createVal(C.ImmediateValue{Type: C.tOBJECT}, mask(KindObject))
-		return ob, true, ctx.writeStructFields(ob, val)
+		if err := ctx.writeStructFields(ob, val); err != nil {
+			ob.release()
+			return nil, false, err
+		}
+		return ob, true, nil
 	case reflect.Array, reflect.Slice:
 		arrayBuffer := false
+		typedArray := false
 		for _, tag := range tags {
-			if strings.TrimSpace(tag) == "arraybuffer" {
+			switch strings.TrimSpace(tag) {
+			case "arraybuffer":
 				arrayBuffer = true
+			case "typedarray":
+				typedArray = true
 			}
 		}
 
+		if typedArray && val.Kind() == reflect.Slice {
+			ob, err := ctx.createTypedArray(val)
+			return ob, err == nil, err
+		}
+
 		if arrayBuffer && val.Kind() == reflect.Slice && val.Type().Elem().Kind() == reflect.Uint8 {
 			// Special case for byte array -> arraybuffer
 			bytes := val.Bytes()
@@ -197,17 +242,38 @@ func (ctx *Context) createWithTags(val reflect.Value, tags []string) (v *Value,
 				},
 				unionKindArray,
 			)
-			for i := 0; i < val.Len(); i++ {
-				v, wasAllocated, err := ctx.create(val.Index(i))
+			var elemTags []string
+			if bigInt {
+				elemTags = []string{"bigint"}
+			} else if ok, err := ob.writePrimitiveRange(val); ok {
 				if err != nil {
-					return nil, false, fmt.Errorf("index %d: %v", i, err)
-				}
-				if err := ob.SetIndex(i, v); err != nil {
+					ob.release()
 					return nil, false, err
 				}
-				if wasAllocated {
-					v.release()
+				return ob, true, nil
+			}
+
+			// Create the elements one by one, but set them all at once.
+			elems := make([]*Value, val.Len())
+			allocated := make([]bool, val.Len())
+			defer func() {
+				for i, v := range elems {
+					if allocated[i] {
+						v.release()
+					}
 				}
+			}()
+			for i := range elems {
+				v, wasAllocated, err := ctx.createWithTags(val.Index(i), elemTags)
+				if err != nil {
+					ob.release()
+					return nil, false, fmt.Errorf("index %d: %v", i, err)
+				}
+				elems[i], allocated[i] = v, wasAllocated
+			}
+			if err := ob.SetRange(0, elems); err != nil {
+				ob.release()
+				return nil, false, err
 			}
 			return ob, true, nil
 		}
@@ -282,6 +348,15 @@ func (ctx *Context) writeStructFields(ob *Value, val reflect.Value) error {
 	return nil
 }
 
+func hasTag(tags []string, name string) bool {
+	for _, tag := range tags {
+		if strings.TrimSpace(tag) == name {
+			return true
+		}
+	}
+	return false
+}
+
 type stringKeys []reflect.Value
 
 func (s stringKeys) Len() int           { return len(s) }
@@ -0,0 +1,96 @@
+package v8
+
+// #include <stdlib.h>
+// #include "v8_c_bridge.h"
+import "C"
+
+import (
+	"fmt"
+	"strings"
+	"unsafe"
+)
+
+// JSError is the error returned when a script throws an exception, e.g. from
+// Eval, Value.Call or Value.New. Its fields are filled in when the exception
+// is caught, but the error message is only formatted when Error is called, so
+// scripts that throw as a matter of course, e.g. to reject invalid input, are
+// cheap to call.
+type JSError struct {
+	// Value is the thrown value, which holds the properties of custom errors.
+	// It belongs to the context that the script ran in and, if the script ran
+	// in a Scope, to that scope: pass it to Scope.Escape to use it after the
+	// scope's function has returned.
+	Value *Value
+	// Message is the thrown value converted to a string, e.g. "Error: oops".
+	Message string
+	// Filename, Line (starting at 1) and the columns locate the statement
+	// that threw in SourceLine. They are empty if V8 doesn't know the script.
+	Filename                     string
+	Line, StartColumn, EndColumn int
+	SourceLine                   string
+	// Stack is the stack trace of a thrown Error, innermost frame first.
+	Stack []Loc
+
+	hasLocation, hasStack bool
+}
+
+// Error formats the exception like V8's message for uncaught exceptions,
+// followed by the source line and the stack trace.
+func (e *JSError) Error() string {
+	var b strings.Builder
+	b.WriteString("Uncaught exception: ")
+	b.WriteString(e.Message)
+
+	if e.hasLocation {
+		fmt.Fprintf(&b, "\nat %s:%d:%d", e.Filename, e.Line, e.StartColumn)
+		b.WriteString("\n  ")
+		b.WriteString(e.SourceLine)
+		b.WriteString("\n  ")
+		b.WriteString(strings.Repeat(" ", e.StartColumn))
+		if e.EndColumn > e.StartColumn {
+			b.WriteString(strings.Repeat("^", e.EndColumn-e.StartColumn))
+		}
+	}
+
+	if e.hasStack {
+		b.WriteString("\nStack trace: ")
+		b.WriteString(e.Message)
+		for _, frame := range e.Stack {
+			if frame.Funcname != "" {
+				fmt.Fprintf(&b, "\n    at %s (%s:%d:%d)", frame.Funcname, frame.Filename, frame.Line, frame.Column)
+			} else {
+				fmt.Fprintf(&b, "\n    at %s:%d:%d", frame.Filename, frame.Line, frame.Column)
+			}
+		}
+	}
+	return b.String()
+}
+
+func (ctx *Context) newJSError(ex *C.Exception) *JSError {
+	defer C.v8_Exception_Release(ex)
+
+	e := &JSError{
+		Value:       ctx.newValue(ex.Value, ex.Kinds),
+		Message:     C.GoStringN(ex.Text.ptr, ex.Text.len),
+		Filename:    C.GoStringN(ex.Filename.ptr, ex.Filename.len),
+		Line:        int(ex.Line),
+		StartColumn: int(ex.StartColumn),
+		EndColumn:   int(ex.EndColumn),
+		SourceLine:  C.GoStringN(ex.SourceLine.ptr, ex.SourceLine.len),
+		hasLocation: ex.HasLocation != 0,
+		hasStack:    ex.HasStack != 0,
+	}
+	if ex.FrameCount > 0 {
+		frames := (*[1 << 20]C.CallerInfo)(unsafe.Pointer(ex.Frames))[:ex.FrameCount:ex.FrameCount]
+		e.Stack = make([]Loc, len(frames))
+		for i, frame := range frames {
+			e.Stack[i] = Loc{
+				Funcname: C.GoStringN(frame.Funcname.ptr, frame.Funcname.len),
+				Filename: C.GoStringN(frame.Filename.ptr, frame.Filename.len),
+				Line:     int(frame.Line),
+				Column:   int(frame.Column),
+			}
+		}
+	}
+	return e
+}
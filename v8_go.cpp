@@ -5,8 +5,18 @@
 #include "v8_go.h"
 
 extern "C" ValueTuple goCallbackHandler(String id, CallerInfo info, int argc, ValueTuple* argv);
+extern "C" ResolvedModule goResolveModuleHandler(int go_context_id, String specifier, String referrer);
+extern "C" ValueTuple goAccessorHandler(int go_context_id, int handle, int field, ValueTuple* value);
+extern "C" ValueTuple goInterceptorHandler(int go_context_id, int handle, InterceptOp op, String name,
+     uint32_t index, ValueTuple* value, int* intercepted);
+extern "C" void goReleaseHandle(int handle);
+extern "C" void goConsoleFlushHandler(int go_context_id);
 
-extern "C" void initWithGoCallbackHanlder(const char* icu_data_file) {
-     v8_Init(goCallbackHandler, icu_data_file);
+extern "C" Error initWithGoCallbackHanlder(const char* icu_data_file, int thread_pool_size, int idle_task_support, const char* snapshot_file) {
+     Error err = v8_Init(goCallbackHandler, icu_data_file, thread_pool_size, idle_task_support, snapshot_file);
+     v8_SetModuleResolveHandler(goResolveModuleHandler);
+     v8_SetWrapHandlers(goAccessorHandler, goInterceptorHandler, goReleaseHandle);
+     v8_SetConsoleFlushHandler(goConsoleFlushHandler);
+     return err;
 }
 #endif
\ No newline at end of file
@@ -7,7 +7,7 @@
 extern "C" {
 #endif
 
-extern void initWithGoCallbackHanlder(const char* icu_data_file);
+extern Error initWithGoCallbackHanlder(const char* icu_data_file, int thread_pool_size, int idle_task_support, const char* snapshot_file);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,306 @@
+package v8
+
+// #include <stdlib.h>
+// #include "v8_c_bridge.h"
+import "C"
+
+import (
+	"fmt"
+	"reflect"
+	"sort"
+	"strconv"
+)
+
+// PropertyHandler handles the named properties of an object created with
+// NewInterceptedObject. Only Get is required. Properties that aren't handled
+// behave like properties of an ordinary object.
+type PropertyHandler struct {
+	// Get returns the value of the property, or nil if there is none.
+	Get func(ctx *Context, name string) (*Value, error)
+	// Has reports whether there is a property with the given name, e.g. for
+	// the in operator. If it is nil, Get is used.
+	Has func(name string) bool
+	// Keys returns the names of the properties, e.g. for Object.keys().
+	Keys func() []string
+	// Set handles assignments. If it is nil, assigned properties are created
+	// on the object itself.
+	Set func(ctx *Context, name string, value *Value) error
+}
+
+// IndexedPropertyHandler handles the indexed properties of an object created
+// with NewInterceptedObject, which are the indexes from 0 to Len()-1. Only
+// Get and Len are required.
+type IndexedPropertyHandler struct {
+	Get func(ctx *Context, index int) (*Value, error)
+	Len func() int
+	// Set handles assignments to indexes below Len().
+	Set func(ctx *Context, index int, value *Value) error
+}
+
+type interceptedObject struct {
+	named   *PropertyHandler
+	indexed *IndexedPropertyHandler
+	// indexesAsNames passes indexed properties to named under their decimal
+	// names instead, since V8 looks up names such as "0" as indexes.
+	indexesAsNames bool
+}
+
+// NewInterceptedObject creates an object whose named and/or indexed
+// properties are looked up with Go functions when a script accesses them,
+// so that large or computed collections can be exposed without copying them
+// into V8. Either handler may be nil. The handlers are referenced until the
+// object is garbage collected by V8 or the isolate is released.
+func (ctx *Context) NewInterceptedObject(named *PropertyHandler, indexed *IndexedPropertyHandler) (*Value, error) {
+	if ctx.ptr == nil {
+		return nil, errContextReleased
+	}
+	var flags C.int
+	if named != nil {
+		if named.Get == nil {
+			return nil, fmt.Errorf("PropertyHandler.Get is required")
+		}
+		flags |= C.kInterceptNamed
+	}
+	if indexed != nil {
+		if indexed.Get == nil || indexed.Len == nil {
+			return nil, fmt.Errorf("IndexedPropertyHandler.Get and Len are required")
+		}
+		flags |= C.kInterceptIndexed
+	}
+	return ctx.newInterceptedObject(flags, &interceptedObject{named: named, indexed: indexed})
+}
+
+func (ctx *Context) newInterceptedObject(flags C.int, obj *interceptedObject) (*Value, error) {
+	h := newHandle(obj)
+	v := ctx.newValue(C.v8_Context_NewInterceptedObject(ctx.ptr, flags, C.int(h)), C.KindMask(KindObject))
+	if v == nil {
+		goReleaseHandle(C.int(h))
+		return nil, fmt.Errorf("Cannot create intercepted object")
+	}
+	return v, nil
+}
+
+// CreateView is like Create for maps with string keys and slices, except that
+// the elements aren't copied: the returned object looks them up in the map
+// or slice when a script accesses them. Assignments write map entries and
+// existing slice elements with ReadInto. Slice views also have a length
+// property. Structs in slices are wrapped like Wrap does.
+//
+// The view is a plain object, not an array, so array methods such as map or
+// forEach aren't available; use Array.from(view) for those.
+func (ctx *Context) CreateView(v interface{}) (*Value, error) {
+	if ctx.ptr == nil {
+		return nil, errContextReleased
+	}
+	val := reflect.ValueOf(v)
+	for val.Kind() == reflect.Ptr && !val.IsNil() {
+		val = val.Elem()
+	}
+
+	switch {
+	case val.Kind() == reflect.Map && val.Type().Key() == stringType:
+		// Keys such as "0" are looked up as indexes.
+		return ctx.newInterceptedObject(C.kInterceptNamed|C.kInterceptIndexed,
+			&interceptedObject{named: mapHandler(val), indexesAsNames: true})
+	case val.Kind() == reflect.Slice || val.Kind() == reflect.Array && val.CanAddr():
+		length := &PropertyHandler{
+			Get: func(ctx *Context, name string) (*Value, error) {
+				if name != "length" {
+					return nil, nil
+				}
+				return ctx.Create(val.Len())
+			},
+		}
+		return ctx.NewInterceptedObject(length, sliceHandler(val))
+	}
+	return nil, fmt.Errorf("Cannot create a view of %T", v)
+}
+
+func mapHandler(m reflect.Value) *PropertyHandler {
+	elemType := m.Type().Elem()
+	return &PropertyHandler{
+		Get: func(ctx *Context, name string) (*Value, error) {
+			elem := m.MapIndex(reflect.ValueOf(name))
+			if !elem.IsValid() {
+				return nil, nil
+			}
+			return ctx.createLazy(elem, nil)
+		},
+		Has: func(name string) bool {
+			return m.MapIndex(reflect.ValueOf(name)).IsValid()
+		},
+		Keys: func() []string {
+			keys := m.MapKeys()
+			sort.Sort(stringKeys(keys))
+			names := make([]string, len(keys))
+			for i, key := range keys {
+				names[i] = key.String()
+			}
+			return names
+		},
+		Set: func(ctx *Context, name string, value *Value) error {
+			elem := reflect.New(elemType)
+			if err := readInto(elem.Interface(), value, []string{name}, wrapMaxDepth); err != nil {
+				return err
+			}
+			m.SetMapIndex(reflect.ValueOf(name), elem.Elem())
+			return nil
+		},
+	}
+}
+
+func sliceHandler(s reflect.Value) *IndexedPropertyHandler {
+	return &IndexedPropertyHandler{
+		Get: func(ctx *Context, index int) (*Value, error) {
+			return ctx.createLazy(s.Index(index), nil)
+		},
+		Len: s.Len,
+		Set: func(ctx *Context, index int, value *Value) error {
+			return readInto(s.Index(index).Addr().Interface(), value,
+				[]string{fmt.Sprint(index)}, wrapMaxDepth)
+		},
+	}
+}
+
+//export goInterceptorHandler
+func goInterceptorHandler(ctxId, handle C.int, op C.InterceptOp, name C.String, index C.uint32_t,
+	value *C.ValueTuple, intercepted *C.int) (ret C.ValueTuple) {
+	ctx := callbackContext(ctxId)
+	if ctx == nil {
+		return errorTuple(fmt.Sprintf("Missing context pointer during property access for context #%d", ctxId))
+	}
+
+	var newValue *Value
+	if value != nil {
+		newValue = ctx.newValue(value.Value, value.Kinds)
+	}
+
+	obj, _ := lookupHandle(int(handle)).(*interceptedObject)
+	if obj == nil {
+		return errorTuple(fmt.Sprintf("No such intercepted object: %d", handle))
+	}
+
+	// Panics must not unwind through the C stack, see goCallbackHandler.
+	defer func() {
+		if v := recover(); v != nil {
+			ret = errorTuple(fmt.Sprintf("Panic in property interceptor: %v", v))
+		}
+	}()
+
+	var res *Value
+	var handled bool
+	var err error
+	if name.ptr != nil {
+		res, handled, err = obj.named.intercept(ctx, op, C.GoStringN(name.ptr, name.len), newValue, obj.indexesAsNames)
+	} else if obj.indexesAsNames {
+		res, handled, err = obj.named.interceptIndex(ctx, op, uint32(index), newValue)
+	} else {
+		res, handled, err = obj.indexed.intercept(ctx, op, int(index), newValue)
+	}
+
+	if err != nil {
+		return errorTuple(err.Error())
+	} else if !handled {
+		return C.ValueTuple{}
+	}
+	*intercepted = 1
+	if res == nil {
+		return C.ValueTuple{}
+	}
+	return C.ValueTuple{Value: res.ptr}
+}
+
+// intercept handles the named property name. If indexesAsNames is set, the
+// names of indexes are left out of the enumeration, see interceptIndex.
+func (h *PropertyHandler) intercept(ctx *Context, op C.InterceptOp, name string, value *Value,
+	indexesAsNames bool) (*Value, bool, error) {
+	switch op {
+	case C.kInterceptGet:
+		v, err := h.Get(ctx, name)
+		return v, v != nil, err
+	case C.kInterceptSet:
+		if h.Set == nil {
+			return nil, false, nil
+		}
+		return nil, true, h.Set(ctx, name, value)
+	case C.kInterceptQuery:
+		if h.Has != nil {
+			return nil, h.Has(name), nil
+		}
+		v, err := h.Get(ctx, name)
+		return nil, v != nil, err
+	case C.kInterceptEnumerate:
+		if h.Keys == nil {
+			return nil, false, nil
+		}
+		keys := h.Keys()
+		if indexesAsNames {
+			names := make([]string, 0, len(keys))
+			for _, key := range keys {
+				if _, ok := arrayIndex(key); !ok {
+					names = append(names, key)
+				}
+			}
+			keys = names
+		}
+		v, err := ctx.Create(keys)
+		return v, true, err
+	}
+	return nil, false, nil
+}
+
+// interceptIndex handles the indexed property index as the named property of
+// the same name. The enumeration returns the names of h that are indexes.
+func (h *PropertyHandler) interceptIndex(ctx *Context, op C.InterceptOp, index uint32, value *Value) (*Value, bool, error) {
+	if op != C.kInterceptEnumerate {
+		return h.intercept(ctx, op, strconv.FormatUint(uint64(index), 10), value, false)
+	} else if h.Keys == nil {
+		return nil, false, nil
+	}
+	indexes := []uint32{}
+	for _, key := range h.Keys() {
+		if i, ok := arrayIndex(key); ok {
+			indexes = append(indexes, i)
+		}
+	}
+	sort.Slice(indexes, func(i, j int) bool { return indexes[i] < indexes[j] })
+	v, err := ctx.Create(indexes)
+	return v, true, err
+}
+
+// arrayIndex returns the index that V8 looks name up as, if any: names of
+// the numbers below 2^32-1 in canonical decimal form.
+func arrayIndex(name string) (uint32, bool) {
+	i, err := strconv.ParseUint(name, 10, 32)
+	if err != nil || i == 1<<32-1 || strconv.FormatUint(i, 10) != name {
+		return 0, false
+	}
+	return uint32(i), true
+}
+
+func (h *IndexedPropertyHandler) intercept(ctx *Context, op C.InterceptOp, index int, value *Value) (*Value, bool, error) {
+	if op == C.kInterceptEnumerate {
+		indexes := make([]int, h.Len())
+		for i := range indexes {
+			indexes[i] = i
+		}
+		v, err := ctx.Create(indexes)
+		return v, true, err
+	} else if index >= h.Len() {
+		return nil, false, nil
+	}
+
+	switch op {
+	case C.kInterceptGet:
+		v, err := h.Get(ctx, index)
+		return v, true, err
+	case C.kInterceptSet:
+		if h.Set == nil {
+			return nil, false, nil
+		}
+		return nil, true, h.Set(ctx, index, value)
+	case C.kInterceptQuery:
+		return nil, true, nil
+	}
+	return nil, false, nil
+}
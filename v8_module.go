@@ -0,0 +1,112 @@
+package v8
+
+// #include <stdlib.h>
+// #include "v8_c_bridge.h"
+import "C"
+
+import (
+	"fmt"
+	"unsafe"
+)
+
+// ModuleResolver resolves the specifier of an import in the module named
+// referrer. It returns the name of the imported module, which identifies it
+// within the context and in the isolate's module cache, and its source. The
+// source is not used if a module with that name was already loaded in the
+// context, so resolvers should return canonical names (e.g. absolute paths).
+type ModuleResolver func(specifier, referrer string) (name, source string, err error)
+
+// ModuleCacheStats describe the isolate's cache of compiled module code. There
+// is one entry per module name, for the source the module was last compiled
+// from, so a module is only compiled from scratch again once its source
+// changes.
+type ModuleCacheStats struct {
+	Entries  int
+	Hits     int
+	Misses   int
+	Rejected int // cache entries V8 refused, e.g. after a flags change
+}
+
+// SetModuleResolver sets the function resolving the imports of the modules
+// evaluated in this context with EvalModule. Without a resolver, imports
+// fail.
+func (ctx *Context) SetModuleResolver(resolver ModuleResolver) {
+	ctx.moduleResolver = resolver
+}
+
+// EvalModule compiles, links and evaluates the ES module source and returns
+// its namespace object, whose properties are the module's exports. Imports are
+// resolved with the context's ModuleResolver. If a module with the same name
+// has been evaluated in this context before, its namespace is returned and
+// source is ignored.
+//
+// Modules are compiled using the code cache of a previous compilation of the
+// same name and source in the isolate, which makes loading the same modules
+// into many contexts cheaper.
+func (ctx *Context) EvalModule(name, source string) (*Value, error) {
+	nameCstr := C.CString(name)
+	defer C.free(unsafe.Pointer(nameCstr))
+	sourceCstr := C.CString(source)
+	defer C.free(unsafe.Pointer(sourceCstr))
+
+	addRef(ctx)
+	ret := C.v8_Context_EvalModule(ctx.ptr, nameCstr, sourceCstr)
+	decRef(ctx)
+	ctx.flushConsole()
+	return ctx.split(ret)
+}
+
+// ModuleCacheStats returns statistics about the isolate's module cache.
+func (i *Isolate) ModuleCacheStats() ModuleCacheStats {
+	s := C.v8_Isolate_GetModuleCacheStats(i.ptr)
+	return ModuleCacheStats{
+		Entries:  int(s.entries),
+		Hits:     int(s.hits),
+		Misses:   int(s.misses),
+		Rejected: int(s.rejected),
+	}
+}
+
+// ClearModuleCache drops the isolate's cached module code, e.g. after a
+// deploy replaced most modules.
+func (i *Isolate) ClearModuleCache() {
+	C.v8_Isolate_ClearModuleCache(i.ptr)
+}
+
+func resolvedModuleError(msg string) C.ResolvedModule {
+	return C.ResolvedModule{error_msg: C.Error{ptr: C.CString(msg), len: C.int(len(msg))}}
+}
+
+//export goResolveModuleHandler
+func goResolveModuleHandler(ctxId C.int, specifierStr, referrerStr C.String) (ret C.ResolvedModule) {
+	specifier := C.GoStringN(specifierStr.ptr, specifierStr.len)
+	referrer := C.GoStringN(referrerStr.ptr, referrerStr.len)
+
+	contextsMutex.RLock()
+	ref := contexts[int(ctxId)]
+	contextsMutex.RUnlock()
+	if ref == nil {
+		return resolvedModuleError(fmt.Sprintf(
+			"Missing context pointer while resolving %q for context #%d", specifier, ctxId))
+	}
+	resolver := ref.ptr.moduleResolver
+	if resolver == nil {
+		return resolvedModuleError(fmt.Sprintf("Cannot resolve module %q: no module resolver set", specifier))
+	}
+
+	// Panics must not unwind through the C stack, see goCallbackHandler.
+	defer func() {
+		if v := recover(); v != nil {
+			ret = resolvedModuleError(fmt.Sprintf("Panic resolving module %q: %v", specifier, v))
+		}
+	}()
+
+	name, source, err := resolver(specifier, referrer)
+	if err != nil {
+		return resolvedModuleError(err.Error())
+	}
+	return C.ResolvedModule{
+		name:   C.String{ptr: C.CString(name), len: C.int(len(name))},
+		source: C.String{ptr: C.CString(source), len: C.int(len(source))},
+	}
+}
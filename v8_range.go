@@ -0,0 +1,266 @@
+package v8
+
+// #include <stdlib.h>
+// #include "v8_c_bridge.h"
+import "C"
+
+import (
+	"encoding/json"
+	"fmt"
+	"math"
+	"reflect"
+	"unsafe"
+)
+
+// The range accessors move a contiguous span of array elements in a single
+// call instead of one GetIndex or SetIndex call per element. Numbers,
+// booleans and strings are transferred packed, without creating a handle per
+// element. Reading a packed range fails if any element in it is of another
+// type.
+
+func (v *Value) getRange(start, count int, typ C.ImmediateValueType) (C.ArrayRange, error) {
+	if start < 0 || count < 0 || int64(start)+int64(count) > math.MaxUint32 {
+		return C.ArrayRange{}, fmt.Errorf("Invalid range of %d elements at %d", count, start)
+	}
+	// Element getters and toString may call back into Go.
+	addRef(v.ctx)
+	r := C.v8_Value_GetRange(v.ctx.ptr, v.ptr, C.int(start), C.int(count), typ)
+	decRef(v.ctx)
+	return r, v.ctx.iso.convertErrorMsg(r.error_msg)
+}
+
+// GetFloat64Range returns count numbers starting at index start.
+func (v *Value) GetFloat64Range(start, count int) ([]float64, error) {
+	r, err := v.getRange(start, count, C.tFLOAT64)
+	if err != nil {
+		return nil, err
+	}
+	defer C.free(unsafe.Pointer(r.Float64s))
+	res := make([]float64, count)
+	if count > 0 {
+		copy(res, (*[1 << 30]float64)(unsafe.Pointer(r.Float64s))[:count:count])
+	}
+	return res, nil
+}
+
+// GetBoolRange returns count booleans starting at index start.
+func (v *Value) GetBoolRange(start, count int) ([]bool, error) {
+	r, err := v.getRange(start, count, C.tBOOL)
+	if err != nil {
+		return nil, err
+	}
+	defer C.free(unsafe.Pointer(r.Bools))
+	res := make([]bool, count)
+	if count > 0 {
+		bools := (*[1 << 30]C.char)(unsafe.Pointer(r.Bools))[:count:count]
+		for i, b := range bools {
+			res[i] = b != 0
+		}
+	}
+	return res, nil
+}
+
+// GetStringRange returns count strings starting at index start.
+func (v *Value) GetStringRange(start, count int) ([]string, error) {
+	r, err := v.getRange(start, count, C.tSTRING)
+	if err != nil {
+		return nil, err
+	}
+	defer C.free(unsafe.Pointer(r.Strings))
+	defer C.free(unsafe.Pointer(r.Offsets))
+	offsets := (*[1 << 30]C.int)(unsafe.Pointer(r.Offsets))[: count+1 : count+1]
+	// Copy all strings at once and slice them up, rather than allocating
+	// each one separately.
+	all := C.GoStringN(r.Strings, offsets[count])
+	res := make([]string, count)
+	for i := range res {
+		res[i] = all[offsets[i]:offsets[i+1]]
+	}
+	return res, nil
+}
+
+// GetRange returns count elements starting at index start as values.
+func (v *Value) GetRange(start, count int) ([]*Value, error) {
+	r, err := v.getRange(start, count, C.tUNDEFINED)
+	if err != nil {
+		return nil, err
+	}
+	defer C.free(unsafe.Pointer(r.Values))
+	res := make([]*Value, count)
+	if count > 0 {
+		values := (*[1 << 30]C.ValueTuple)(unsafe.Pointer(r.Values))[:count:count]
+		for i, val := range values {
+			res[i] = v.ctx.newValue(val.Value, val.Kinds)
+		}
+	}
+	return res, nil
+}
+
+func (v *Value) setRange(start int, r C.ArrayRange) error {
+	if start < 0 || int64(start)+int64(r.Length) > math.MaxUint32 {
+		return fmt.Errorf("Invalid range of %d elements at %d", r.Length, start)
+	}
+	// Element setters may call back into Go.
+	addRef(v.ctx)
+	errmsg := C.v8_Value_SetRange(v.ctx.ptr, v.ptr, C.int(start), r)
+	decRef(v.ctx)
+	return v.ctx.iso.convertErrorMsg(errmsg)
+}
+
+// SetFloat64Range sets the elements starting at index start to values.
+func (v *Value) SetFloat64Range(start int, values []float64) error {
+	if len(values) == 0 {
+		return nil
+	}
+	return v.setRange(start, C.ArrayRange{
+		Type:     C.tFLOAT64,
+		Length:   C.int(len(values)),
+		Float64s: (*C.double)(unsafe.Pointer(&values[0])),
+	})
+}
+
+// SetBoolRange sets the elements starting at index start to values.
+func (v *Value) SetBoolRange(start int, values []bool) error {
+	if len(values) == 0 {
+		return nil
+	}
+	bools := make([]C.char, len(values))
+	for i, b := range values {
+		if b {
+			bools[i] = 1
+		}
+	}
+	return v.setRange(start, C.ArrayRange{
+		Type:   C.tBOOL,
+		Length: C.int(len(values)),
+		Bools:  &bools[0],
+	})
+}
+
+// SetStringRange sets the elements starting at index start to values.
+func (v *Value) SetStringRange(start int, values []string) error {
+	if len(values) == 0 {
+		return nil
+	}
+	size := 0
+	for _, s := range values {
+		size += len(s)
+	}
+	buf := make([]byte, 0, size+1) // +1 so that &buf[0] is valid
+	offsets := make([]C.int, 1, len(values)+1)
+	for _, s := range values {
+		buf = append(buf, s...)
+		offsets = append(offsets, C.int(len(buf)))
+	}
+	buf = append(buf, 0)
+	return v.setRange(start, C.ArrayRange{
+		Type:    C.tSTRING,
+		Length:  C.int(len(values)),
+		Strings: (*C.char)(unsafe.Pointer(&buf[0])),
+		Offsets: &offsets[0],
+	})
+}
+
+// SetRange sets the elements starting at index start to values.
+func (v *Value) SetRange(start int, values []*Value) error {
+	if len(values) == 0 {
+		return nil
+	}
+	if err := checkReleased(values...); err != nil {
+		return err
+	}
+	tuples := make([]C.ValueTuple, len(values))
+	for i, val := range values {
+		tuples[i].Value = val.ptr
+	}
+	return v.setRange(start, C.ArrayRange{
+		Type:   C.tUNDEFINED,
+		Length: C.int(len(values)),
+		Values: &tuples[0],
+	})
+}
+
+var jsonUnmarshalerType = reflect.TypeOf((*json.Unmarshaler)(nil)).Elem()
+
+// readPrimitiveRange reads the first length elements of the array v into a
+// new slice of type sliceType if its elements are numbers, bools or strings,
+// and reports whether it did. Elements that implement json.Unmarshaler are
+// left to readInto, which unmarshals them one by one.
+func (v *Value) readPrimitiveRange(sliceType reflect.Type, length int) (reflect.Value, bool) {
+	elem := sliceType.Elem()
+	if reflect.PtrTo(elem).Implements(jsonUnmarshalerType) {
+		return reflect.Value{}, false
+	}
+	slice := reflect.MakeSlice(sliceType, length, length)
+	switch elem.Kind() {
+	case reflect.Int, reflect.Int8, reflect.Int16, reflect.Int32, reflect.Int64,
+		reflect.Uint, reflect.Uint8, reflect.Uint16, reflect.Uint32, reflect.Uint64:
+		nums, err := v.GetFloat64Range(0, length)
+		if err != nil {
+			return reflect.Value{}, false
+		}
+		for i, num := range nums {
+			// Truncate like Value.Int64, which maps NaN to 0.
+			if math.IsNaN(num) {
+				num = 0
+			}
+			slice.Index(i).Set(reflect.ValueOf(int64(num)).Convert(elem))
+		}
+	case reflect.Float32, reflect.Float64:
+		nums, err := v.GetFloat64Range(0, length)
+		if err != nil {
+			return reflect.Value{}, false
+		}
+		for i, num := range nums {
+			slice.Index(i).SetFloat(num)
+		}
+	case reflect.Bool:
+		bools, err := v.GetBoolRange(0, length)
+		if err != nil {
+			return reflect.Value{}, false
+		}
+		for i, b := range bools {
+			slice.Index(i).SetBool(b)
+		}
+	case reflect.String:
+		strs, err := v.GetStringRange(0, length)
+		if err != nil {
+			return reflect.Value{}, false
+		}
+		for i, s := range strs {
+			slice.Index(i).SetString(s)
+		}
+	default:
+		return reflect.Value{}, false
+	}
+	return slice, true
+}
+
+// writePrimitiveRange writes the elements of val, a slice or array of
+// numbers, bools or strings, to the array ob, and reports whether it did.
+func (ob *Value) writePrimitiveRange(val reflect.Value) (bool, error) {
+	n := val.Len()
+	switch val.Type().Elem().Kind() {
+	case reflect.Int, reflect.Int8, reflect.Int16, reflect.Int32, reflect.Int64,
+		reflect.Uint, reflect.Uint8, reflect.Uint16, reflect.Uint32, reflect.Uint64,
+		reflect.Float32, reflect.Float64:
+		nums := make([]float64, n)
+		for i := range nums {
+			nums[i] = val.Index(i).Convert(float64Type).Float()
+		}
+		return true, ob.SetFloat64Range(0, nums)
+	case reflect.Bool:
+		bools := make([]bool, n)
+		for i := range bools {
+			bools[i] = val.Index(i).Bool()
+		}
+		return true, ob.SetBoolRange(0, bools)
+	case reflect.String:
+		strs := make([]string, n)
+		for i := range strs {
+			strs[i] = val.Index(i).String()
+		}
+		return true, ob.SetStringRange(0, strs)
+	}
+	return false, nil
+}
@@ -73,6 +73,10 @@ func readInto(dst interface{}, value *Value, path []string, maxDepth int) (err e
 		}
 	}
 
+	if value.IsKind(KindBigInt) {
+		return readBigInt(dstValue, value, path)
+	}
+
 	switch dstType.Kind() {
 	case reflect.Invalid:
 		return getReadIntoError("invalid variable kind", path)
@@ -122,16 +126,14 @@ func readInto(dst interface{}, value *Value, path []string, maxDepth int) (err e
 		if dstType.Key().Kind() != reflect.String {
 			return getReadIntoError("only string type keys are supported for maps", path)
 		}
-		objKeys, err := value.GetObjKeys()
+		// Keys and values are read in one call, like Object.entries().
+		objKeys, objVals, err := value.GetOwnProperties(PropertiesEnumerableOnly)
 		if err != nil {
 			return err
 		}
 		newMap := reflect.MakeMapWithSize(reflect.MapOf(dstType.Key(), dstType.Elem()), len(objKeys))
 		for i := 0; i < len(objKeys); i++ {
-			objVal, err := value.Get(objKeys[i])
-			if err != nil {
-				return err
-			}
+			objVal := objVals[i]
 			entryVal := reflect.New(dstType.Elem())
 			err = readInto(entryVal.Interface(), objVal, append(path, objKeys[i]), maxDepth)
 			if err != nil {
@@ -161,6 +163,14 @@ func readInto(dst interface{}, value *Value, path []string, maxDepth int) (err e
 			return getReadIntoError("value to be read into a slice is not an array or object", path)
 		}
 
+		// Numeric typed arrays are copied in one go.
+		if value.IsKind(KindTypedArray) {
+			if slice, ok := value.readTypedArray(dstType); ok {
+				dstValue.Set(slice)
+				break
+			}
+		}
+
 		// get the length of the V8 Array
 		lengthVal, err := value.Get("length")
 		if err != nil {
@@ -168,6 +178,16 @@ func readInto(dst interface{}, value *Value, path []string, maxDepth int) (err e
 		}
 		length := int(lengthVal.Int64())
 
+		// Arrays of primitives are read in one go. If that fails, e.g.
+		// because of a hole, read element by element to get the same
+		// conversions and errors as for single values.
+		if value.IsKind(KindArray) {
+			if slice, ok := value.readPrimitiveRange(dstType, length); ok {
+				dstValue.Set(slice)
+				break
+			}
+		}
+
 		// Make Go slice
 		newSlice := reflect.MakeSlice(reflect.SliceOf(dstType.Elem()), length, length)
 		for i := 0; i < length; i++ {
@@ -229,6 +249,42 @@ func readInto(dst interface{}, value *Value, path []string, maxDepth int) (err e
 	return nil
 }
 
+// readBigInt reads a BigInt into an integer, float or string. Unlike numbers,
+// BigInts that don't fit into the destination are an error.
+func readBigInt(dst reflect.Value, value *Value, path []string) error {
+	switch dst.Kind() {
+	case reflect.Int, reflect.Int8, reflect.Int16, reflect.Int32, reflect.Int64:
+		i, lossless := value.BigInt64()
+		if !lossless || dst.OverflowInt(i) {
+			return getReadIntoError(fmt.Sprintf("BigInt %s overflows %s", value, dst.Type()), path)
+		}
+		dst.SetInt(i)
+	case reflect.Uint, reflect.Uint8, reflect.Uint16, reflect.Uint32, reflect.Uint64:
+		u, lossless := value.BigUint64()
+		if !lossless || dst.OverflowUint(u) {
+			return getReadIntoError(fmt.Sprintf("BigInt %s overflows %s", value, dst.Type()), path)
+		}
+		dst.SetUint(u)
+	case reflect.Float32, reflect.Float64:
+		i, lossless := value.BigInt64()
+		if !lossless {
+			return getReadIntoError(fmt.Sprintf("BigInt %s overflows int64", value), path)
+		}
+		dst.SetFloat(float64(i))
+	case reflect.String:
+		dst.SetString(value.String())
+	case reflect.Interface:
+		i, lossless := value.BigInt64()
+		if !lossless {
+			return getReadIntoError(fmt.Sprintf("BigInt %s overflows int64", value), path)
+		}
+		dst.Set(reflect.ValueOf(i))
+	default:
+		return getReadIntoError(fmt.Sprintf("cannot read BigInt into %s", dst.Type()), path)
+	}
+	return nil
+}
+
 func getReadIntoError(msg string, path []string) error {
 	if len(path) == 0 {
 		return errors.New(msg)
@@ -0,0 +1,328 @@
+package v8
+
+import (
+	"errors"
+	"fmt"
+	"log"
+	"math/rand"
+	"runtime"
+	"runtime/debug"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// ErrRuntimeClosed is returned by Runtime.Submit after Close has been called.
+var ErrRuntimeClosed = errors.New("Runtime is closed")
+
+// RuntimeOptions configure NewRuntime.
+type RuntimeOptions struct {
+	// Isolates is the number of isolates, and threads, of the runtime.
+	// Defaults to runtime.GOMAXPROCS(0).
+	Isolates int
+	// Snapshot, if not nil, is used to create the isolates.
+	Snapshot *Snapshot
+	// Setup, if not nil, is called with the context of each isolate before it
+	// runs any jobs, e.g. to load scripts. If it fails, NewRuntime fails.
+	Setup func(*Context) error
+	// RecycleContexts recycles the context of an isolate after every job (see
+	// Context.Recycle), so that jobs can't see each other's globals. Setup
+	// should then only set up the isolate, e.g. with Isolate.SetGlobal.
+	RecycleContexts bool
+	// PanicHandler, if not nil, is called with the value and the stack trace
+	// of a job that panicked, on the job's isolate. Otherwise the panic is
+	// logged with the standard logger. Either way the isolate goes on to run
+	// the next job.
+	PanicHandler func(recovered interface{}, stack []byte)
+}
+
+// Runtime runs jobs on a fixed set of isolates, each of which is owned by a
+// goroutine that is locked to its own OS thread. This keeps V8's per-thread
+// state warm and avoids handing the isolate locks between threads, which is
+// what happens when goroutines share isolates.
+//
+// Every isolate has its own queue of jobs. Submit spreads jobs across the
+// queues, and isolates whose queue is empty steal jobs from the others, so a
+// job may run on any isolate: jobs must not depend on state left behind by
+// earlier jobs in a particular isolate.
+type Runtime struct {
+	workers []*runtimeWorker
+	opts    RuntimeOptions
+	started time.Time
+
+	// closeMutex is held for reading by Submit from checking closed until
+	// the job is queued, so that Close, which sets closed with it held for
+	// writing, can't let the isolates stop in between.
+	closeMutex sync.RWMutex
+	closeOnce  sync.Once
+	closed     int32
+	done       sync.WaitGroup
+}
+
+// RuntimeStats are the statistics of one isolate of a Runtime.
+type RuntimeStats struct {
+	// Queued is the number of jobs waiting in the isolate's queue.
+	Queued int
+	// Executed is the number of jobs run by the isolate, Stolen the number of
+	// those that were taken from other isolates' queues, and Panics the number
+	// of those that panicked.
+	Executed, Stolen, Panics uint64
+	// Busy is the time spent running jobs, and Utilization the fraction of
+	// the runtime's lifetime that this amounts to. An isolate with a
+	// utilization close to 1 and a growing queue is saturated.
+	Busy        time.Duration
+	Utilization float64
+}
+
+type runtimeWorker struct {
+	rt  *Runtime
+	idx int
+	ctx *Context
+
+	mu    sync.Mutex
+	queue []func(*Context)
+	wake  chan struct{}
+	idle  int32
+
+	executed, stolen, panics, busy uint64
+}
+
+// NewRuntime starts the isolates of a runtime.
+func NewRuntime(opts RuntimeOptions) (*Runtime, error) {
+	if !IsInit() {
+		return nil, fmt.Errorf("V8 not init")
+	}
+	if opts.Isolates <= 0 {
+		opts.Isolates = runtime.GOMAXPROCS(0)
+	}
+
+	r := &Runtime{opts: opts, started: time.Now()}
+	r.workers = make([]*runtimeWorker, opts.Isolates)
+	for i := range r.workers {
+		r.workers[i] = &runtimeWorker{rt: r, idx: i, wake: make(chan struct{}, 1)}
+	}
+
+	errs := make(chan error, len(r.workers))
+	r.done.Add(len(r.workers))
+	for _, w := range r.workers {
+		go w.run(errs)
+	}
+	var err error
+	for range r.workers {
+		if e := <-errs; e != nil && err == nil {
+			err = e
+		}
+	}
+	if err != nil {
+		r.Close()
+		return nil, err
+	}
+	return r, nil
+}
+
+// Submit queues job to run on one of the isolates. The job gets the context of
+// the isolate it runs on, which must not be used after the job returns.
+func (r *Runtime) Submit(job func(*Context)) error {
+	r.closeMutex.RLock()
+	defer r.closeMutex.RUnlock()
+	if atomic.LoadInt32(&r.closed) != 0 {
+		return ErrRuntimeClosed
+	}
+
+	// Picking the shorter of two random queues balances nearly as well as
+	// scanning all of them, without contending on every queue.
+	w := r.workers[rand.Intn(len(r.workers))]
+	if len(r.workers) > 1 {
+		if other := r.workers[rand.Intn(len(r.workers))]; other.queueLen() < w.queueLen() {
+			w = other
+		}
+	}
+
+	w.mu.Lock()
+	w.queue = append(w.queue, job)
+	backlog := len(w.queue)
+	w.mu.Unlock()
+	w.notify()
+
+	// A backlog means the isolate is busy, so wake an idle one to steal.
+	if backlog > 1 {
+		r.wakeIdle(w)
+	}
+	return nil
+}
+
+// Stats returns the statistics of each isolate.
+func (r *Runtime) Stats() []RuntimeStats {
+	lifetime := time.Since(r.started)
+	stats := make([]RuntimeStats, len(r.workers))
+	for i, w := range r.workers {
+		busy := time.Duration(atomic.LoadUint64(&w.busy))
+		stats[i] = RuntimeStats{
+			Queued:      w.queueLen(),
+			Executed:    atomic.LoadUint64(&w.executed),
+			Stolen:      atomic.LoadUint64(&w.stolen),
+			Panics:      atomic.LoadUint64(&w.panics),
+			Busy:        busy,
+			Utilization: float64(busy) / float64(lifetime),
+		}
+	}
+	return stats
+}
+
+// Close runs the jobs that are still queued, then releases the isolates. It
+// waits until they are released, so it must not be called from a job, which
+// would wait for itself; a job can start Close in a new goroutine instead.
+func (r *Runtime) Close() {
+	r.closeOnce.Do(func() {
+		r.closeMutex.Lock()
+		atomic.StoreInt32(&r.closed, 1)
+		r.closeMutex.Unlock()
+		for _, w := range r.workers {
+			w.notify()
+		}
+	})
+	r.done.Wait()
+}
+
+func (r *Runtime) wakeIdle(busy *runtimeWorker) {
+	start := rand.Intn(len(r.workers))
+	for i := range r.workers {
+		w := r.workers[(start+i)%len(r.workers)]
+		if w != busy && atomic.LoadInt32(&w.idle) != 0 {
+			w.notify()
+			return
+		}
+	}
+}
+
+func (w *runtimeWorker) notify() {
+	select {
+	case w.wake <- struct{}{}:
+	default: // already pending
+	}
+}
+
+func (w *runtimeWorker) queueLen() int {
+	w.mu.Lock()
+	n := len(w.queue)
+	w.mu.Unlock()
+	return n
+}
+
+// pop takes the oldest job of the worker's own queue.
+func (w *runtimeWorker) pop() func(*Context) {
+	w.mu.Lock()
+	defer w.mu.Unlock()
+	if len(w.queue) == 0 {
+		return nil
+	}
+	job := w.queue[0]
+	w.queue[0] = nil
+	w.queue = w.queue[1:]
+	return job
+}
+
+// steal takes the newest job of another worker's queue.
+func (w *runtimeWorker) steal() func(*Context) {
+	workers := w.rt.workers
+	for i := 1; i < len(workers); i++ {
+		victim := workers[(w.idx+i)%len(workers)]
+		victim.mu.Lock()
+		if n := len(victim.queue); n > 0 {
+			job := victim.queue[n-1]
+			victim.queue[n-1] = nil
+			victim.queue = victim.queue[:n-1]
+			victim.mu.Unlock()
+			atomic.AddUint64(&w.stolen, 1)
+			return job
+		}
+		victim.mu.Unlock()
+	}
+	return nil
+}
+
+func (w *runtimeWorker) next() func(*Context) {
+	if job := w.pop(); job != nil {
+		return job
+	}
+	return w.steal()
+}
+
+func (w *runtimeWorker) run(started chan<- error) {
+	defer w.rt.done.Done()
+	// The isolate is only ever used from this thread.
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+
+	var iso *Isolate
+	var err error
+	if w.rt.opts.Snapshot != nil {
+		iso, err = NewIsolateWithSnapshot(w.rt.opts.Snapshot)
+	} else {
+		iso, err = NewIsolate()
+	}
+	if err != nil {
+		started <- err
+		return
+	}
+	defer iso.release()
+	w.ctx = iso.NewContext()
+	defer w.ctx.release()
+
+	if setup := w.rt.opts.Setup; setup != nil {
+		if err := setup(w.ctx); err != nil {
+			started <- fmt.Errorf("Setting up isolate %d: %v", w.idx, err)
+			return
+		}
+	}
+	started <- nil
+
+	for {
+		if job := w.next(); job != nil {
+			w.execute(job)
+			continue
+		}
+
+		// Flag the worker as idle before checking the queues once more, so
+		// that a job submitted in between isn't missed.
+		atomic.StoreInt32(&w.idle, 1)
+		if job := w.next(); job != nil {
+			atomic.StoreInt32(&w.idle, 0)
+			w.execute(job)
+			continue
+		}
+		if atomic.LoadInt32(&w.rt.closed) != 0 {
+			// Jobs submitted before Close are queued by now.
+			if job := w.next(); job != nil {
+				atomic.StoreInt32(&w.idle, 0)
+				w.execute(job)
+				continue
+			}
+			return
+		}
+		<-w.wake
+		atomic.StoreInt32(&w.idle, 0)
+	}
+}
+
+func (w *runtimeWorker) execute(job func(*Context)) {
+	start := time.Now()
+	defer func() {
+		if v := recover(); v != nil {
+			atomic.AddUint64(&w.panics, 1)
+			if handler := w.rt.opts.PanicHandler; handler != nil {
+				handler(v, debug.Stack())
+			} else {
+				log.Printf("v8: job panicked on isolate %d: %v\n%s", w.idx, v, debug.Stack())
+			}
+		}
+		atomic.AddUint64(&w.busy, uint64(time.Since(start)))
+		atomic.AddUint64(&w.executed, 1)
+		if w.rt.opts.RecycleContexts {
+			if err := w.ctx.Recycle(); err != nil {
+				log.Printf("v8: recycling the context of isolate %d: %v", w.idx, err)
+			}
+		}
+	}()
+	job(w.ctx)
+}
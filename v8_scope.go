@@ -0,0 +1,103 @@
+package v8
+
+// #include <stdlib.h>
+// #include "v8_c_bridge.h"
+import "C"
+
+import "runtime"
+
+// Scope owns the values created in a context while a function passed to
+// Context.Scope runs, and releases all of them at once when the function
+// returns.
+//
+// Values normally have a finalizer that releases them one by one after they
+// have been garbage collected, which takes a call into V8, and the isolate
+// lock, per value. Values of a scope have no finalizers; they are released
+// with a single call, which makes a difference for code that creates many
+// short-lived values, e.g. when reading large objects with ReadInto.
+type Scope struct {
+	ctx    *Context
+	parent *Scope
+	// values and handles are parallel; released and escaped values leave
+	// a nil entry behind so that the slots of the others stay valid.
+	values  []*Value
+	handles []C.PersistentValuePtr
+}
+
+// Scope calls fn with a new scope of the context. Every value created in the
+// context until fn returns, including the arguments of callbacks, belongs to
+// the scope and must not be used after fn returns, unless it has been passed
+// to Escape; methods of such values fail with the same error as those of
+// a released context. Scopes can be nested.
+//
+// The context must not be used by other goroutines while fn runs, or their
+// values will end up in the scope as well.
+func (ctx *Context) Scope(fn func(s *Scope)) {
+	s := &Scope{ctx: ctx, parent: ctx.scope}
+	ctx.scope = s
+	defer s.close()
+	fn(s)
+}
+
+// Escape takes v out of the scope, so that it stays valid after the scope
+// ends: it moves to the enclosing scope, or gets a finalizer like values
+// created outside of scopes. Values that don't belong to s are returned as
+// they are.
+func (s *Scope) Escape(v *Value) *Value {
+	if v == nil || v.scope != s {
+		return v
+	}
+	s.forget(v)
+	if s.parent != nil {
+		s.parent.add(v)
+	} else if s.ctx.inSnapshotCreator {
+		s.ctx.snapshotHandles = append(s.ctx.snapshotHandles, v.release)
+	} else {
+		runtime.SetFinalizer(v, (*Value).release)
+	}
+	return v
+}
+
+// Len returns the number of values that belong to the scope.
+func (s *Scope) Len() int {
+	n := 0
+	for _, v := range s.values {
+		if v != nil {
+			n++
+		}
+	}
+	return n
+}
+
+func (s *Scope) add(v *Value) {
+	v.scope = s
+	v.slot = len(s.values)
+	s.values = append(s.values, v)
+	s.handles = append(s.handles, v.ptr)
+}
+
+func (s *Scope) forget(v *Value) {
+	s.values[v.slot] = nil
+	s.handles[v.slot] = nil
+	v.scope = nil
+}
+
+func (s *Scope) close() {
+	s.ctx.scope = s.parent
+	if len(s.handles) > 0 {
+		s.ctx.releaseMutex.RLock()
+		if s.ctx.ptr != nil {
+			C.v8_Value_ReleaseAll(s.ctx.ptr, &s.handles[0], C.int(len(s.handles)))
+		}
+		s.ctx.releaseMutex.RUnlock()
+	}
+	for _, v := range s.values {
+		if v != nil {
+			v.ctx = releasedContext
+			v.ptr = nil
+			v.scope = nil
+		}
+	}
+	s.values = nil
+	s.handles = nil
+}
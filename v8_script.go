@@ -0,0 +1,118 @@
+package v8
+
+// #include <stdlib.h>
+// #include "v8_c_bridge.h"
+import "C"
+
+import (
+	"errors"
+	"io"
+	"runtime"
+	"unsafe"
+)
+
+// streamingChunkSize is the size of the reads from the io.Reader passed to
+// CompileStreaming.
+const streamingChunkSize = 64 * 1024
+
+// Script is a compiled script that is bound to the Context it was compiled
+// in. It can be run any number of times.
+type Script struct {
+	ctx *Context
+	// iso releases the script, which may happen after the context's release.
+	iso *Isolate
+	ptr C.ScriptPtr
+}
+
+var errScriptReleased = errors.New("Script has been released")
+
+func (ctx *Context) newScript(ret C.ScriptTuple) (*Script, error) {
+	if err := ctx.iso.convertErrorMsg(ret.error_msg); err != nil {
+		return nil, err
+	}
+	s := &Script{ctx, ctx.iso, ret.Script}
+	if ctx.inSnapshotCreator {
+		ctx.snapshotHandles = append(ctx.snapshotHandles, s.release)
+	} else {
+		runtime.SetFinalizer(s, (*Script).release)
+	}
+	return s, nil
+}
+
+// Run runs the script in its Context and returns the result of the last
+// statement, just like Eval.
+func (s *Script) Run() (*Value, error) {
+	if s.ptr == nil {
+		return nil, errScriptReleased
+	}
+	addRef(s.ctx)
+	ret := C.v8_Script_Run(s.ctx.ptr, s.ptr)
+	decRef(s.ctx)
+	s.ctx.flushConsole()
+	return s.ctx.split(ret)
+}
+
+// Release frees the script immediately instead of waiting for the garbage
+// collector. Run fails afterwards.
+func (s *Script) Release() {
+	s.release()
+}
+
+func (s *Script) release() {
+	if s.ptr != nil {
+		C.v8_Script_Release(s.iso.ptr, s.ptr)
+	}
+	s.ctx = releasedContext
+	s.iso = nil
+	s.ptr = nil
+	runtime.SetFinalizer(s, nil)
+}
+
+// CompileStreaming compiles the UTF-8 encoded javascript read from r. V8
+// parses the source on a background thread while it is still being read, and
+// the isolate is only locked to set up the stream and for the final compile
+// step, so other operations on the isolate can proceed in the meantime. This
+// is mostly useful for large scripts. The filename parameter is informational
+// only -- it is shown in javascript stack traces.
+func (ctx *Context) CompileStreaming(r io.Reader, filename string) (*Script, error) {
+	// The bridge returns no stream for a released context.
+	stream := C.v8_Context_StartStreaming(ctx.ptr)
+	if stream == nil {
+		return nil, errContextReleased
+	}
+
+	parsed := make(chan struct{})
+	go func() {
+		C.v8_ScriptStream_Run(stream)
+		close(parsed)
+	}()
+
+	var readErr error
+	buf := make([]byte, streamingChunkSize)
+	for {
+		n, err := r.Read(buf)
+		if n > 0 {
+			C.v8_ScriptStream_Push(stream, (*C.char)(unsafe.Pointer(&buf[0])), C.int(n))
+		}
+		if err == io.EOF {
+			break
+		} else if err != nil {
+			readErr = err
+			break
+		}
+	}
+
+	// Closing the stream tells the parser that there is no more data, which
+	// also cancels the parse if reading failed.
+	C.v8_ScriptStream_Close(stream)
+	<-parsed
+
+	if readErr != nil {
+		C.v8_ScriptStream_Release(stream)
+		return nil, readErr
+	}
+
+	filenameCstr := C.CString(filename)
+	defer C.free(unsafe.Pointer(filenameCstr))
+	return ctx.newScript(C.v8_ScriptStream_Compile(ctx.ptr, stream, filenameCstr))
+}
@@ -0,0 +1,65 @@
+package v8
+
+// #include <stdlib.h>
+// #include "v8_c_bridge.h"
+import "C"
+
+import (
+	"errors"
+	"reflect"
+	"runtime"
+	"unsafe"
+)
+
+// ExternalString is text that V8 strings can reference instead of holding a
+// copy in the V8 heap. Creating one converts the text once, to Latin-1 if
+// every character fits into a byte (a plain copy for ASCII) and to UTF-16
+// otherwise; after that, CreateExternalString is cheap regardless of the
+// length of the text, in any context of any isolate. This is worthwhile for
+// large texts, such as templates, that are passed to scripts repeatedly.
+//
+// The text lives in C memory, which is freed once the ExternalString has been
+// released (or garbage collected) and every string created from it has been
+// collected by V8.
+type ExternalString struct {
+	ptr C.ExternalStringPtr
+}
+
+// NewExternalString copies s, which is assumed to be UTF-8, into C memory.
+// Invalid UTF-8 sequences are replaced with U+FFFD.
+func NewExternalString(s string) *ExternalString {
+	var ptr *C.char
+	if len(s) > 0 {
+		// s is only read during the call, so it doesn't need to be copied.
+		ptr = (*C.char)(unsafe.Pointer((*reflect.StringHeader)(unsafe.Pointer(&s)).Data))
+	}
+	es := &ExternalString{C.v8_ExternalString_New(ptr, C.int(len(s)))}
+	runtime.KeepAlive(s)
+	runtime.SetFinalizer(es, (*ExternalString).Release)
+	return es
+}
+
+// OneByte reports whether the text is stored as Latin-1.
+func (s *ExternalString) OneByte() bool {
+	return C.v8_ExternalString_IsOneByte(s.ptr) == 1
+}
+
+// Release drops the reference to the text. Strings that have been created
+// from it stay valid.
+func (s *ExternalString) Release() {
+	if s.ptr != nil {
+		C.v8_ExternalString_Release(s.ptr)
+	}
+	s.ptr = nil
+	runtime.SetFinalizer(s, nil)
+}
+
+// CreateExternalString creates a JS string that references the text of s.
+func (ctx *Context) CreateExternalString(s *ExternalString) (*Value, error) {
+	if s.ptr == nil {
+		return nil, errors.New("ExternalString has been released")
+	}
+	ret := C.v8_Context_CreateExternalString(ctx.ptr, s.ptr)
+	runtime.KeepAlive(s)
+	return ctx.split(ret)
+}
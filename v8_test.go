@@ -6,12 +6,17 @@ import (
 	"fmt"
 	"math"
 	"math/big"
+	"os"
+	"path"
+	"path/filepath"
 	"reflect"
 	"regexp"
 	"runtime"
 	"strings"
 	"sync"
+	"sync/atomic"
 	"testing"
+	"testing/iotest"
 	"time"
 )
 
@@ -311,6 +316,55 @@ func TestJsThrowError(t *testing.T) {
 	}
 }
 
+func TestJSError(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso.NewContext()
+	validate, err := ctx.Eval(`
+		(function validate(obj) {
+			if (!obj.name) throw Object.assign(new Error("name is required"), {field: "name"});
+		})`, "validate.js")
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	empty, _ := ctx.Create(map[string]interface{}{})
+	_, err = validate.Call(nil, empty)
+	var jsErr *JSError
+	if !errors.As(err, &jsErr) {
+		t.Fatalf("Expected a *JSError, got %T: %v", err, err)
+	}
+	if jsErr.Message != "Error: name is required" || jsErr.Filename != "validate.js" || jsErr.Line != 3 {
+		t.Errorf("Wrong exception: %q at %s:%d", jsErr.Message, jsErr.Filename, jsErr.Line)
+	}
+	if len(jsErr.Stack) != 1 || jsErr.Stack[0].Funcname != "validate" || jsErr.Stack[0].Line != 3 {
+		t.Errorf("Wrong stack trace: %+v", jsErr.Stack)
+	}
+	if field, err := jsErr.Value.Get("field"); err != nil || field.String() != "name" {
+		t.Errorf("Expected the thrown value to keep its properties, got %v, %v", field, err)
+	}
+	if msg := err.Error(); !strings.HasPrefix(msg, "Uncaught exception: Error: name is required\nat validate.js:3:") ||
+		!strings.Contains(msg, "\nStack trace: Error: name is required\n    at validate (validate.js:3:") {
+		t.Errorf("Wrong error message: %s", msg)
+	}
+
+	// Thrown values other than Errors have no stack trace.
+	_, err = ctx.Eval(`throw {code: 42}`, "throw.js")
+	if !errors.As(err, &jsErr) || jsErr.Stack != nil || !jsErr.Value.IsKind(KindObject) {
+		t.Fatalf("Expected the thrown object without a stack trace, got %v", err)
+	}
+	if code, _ := jsErr.Value.Get("code"); code.Int64() != 42 {
+		t.Errorf("Expected code 42, got %v", code)
+	}
+	if strings.Contains(err.Error(), "Stack trace") {
+		t.Errorf("Expected no stack trace in %q", err.Error())
+	}
+}
+
 func TestReadFieldFromObject(t *testing.T) {
 	t.Parallel()
 	Init("")
@@ -319,132 +373,996 @@ func TestReadFieldFromObject(t *testing.T) {
 		t.Fatal(err)
 	}
 	ctx := iso.NewContext()
-	res, err := ctx.Eval(`({foo:"bar"})`, "my_file.js")
-	if err != nil {
-		t.Fatalf("Error evaluating javascript, err: %v", err)
+	res, err := ctx.Eval(`({foo:"bar"})`, "my_file.js")
+	if err != nil {
+		t.Fatalf("Error evaluating javascript, err: %v", err)
+	}
+	val, err := res.Get("foo")
+	if err != nil {
+		t.Fatalf("Error trying to get field: %v", err)
+	}
+	if str := val.String(); str != "bar" {
+		t.Errorf("Expected 'bar', got %q", str)
+	}
+}
+
+func TestReadAndWriteIndexFromArrayBuffer(t *testing.T) {
+	t.Parallel()
+
+	Init("")
+
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso.NewContext()
+	val, err := ctx.Create(struct {
+		Data []byte `v8:"arraybuffer"`
+	}{[]byte{1, 2, 3}})
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	data, err := val.Get("Data")
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	v, err := data.GetIndex(1)
+	if err != nil {
+		t.Fatal(err)
+	} else if num := v.Int64(); num != 2 {
+		t.Errorf("Wrong value, expected 2, got %v (%v)", num, v)
+	}
+
+	v2, err := data.GetIndex(17)
+	if err != nil {
+		t.Fatal(err)
+	} else if str := v2.String(); str != "undefined" {
+		t.Errorf("Expected undefined, got %s", str)
+	}
+
+	v3, err := data.GetIndex(2)
+	if err != nil {
+		t.Fatal(err)
+	} else if num := v3.Int64(); num != 3 {
+		t.Errorf("Expected undefined, got %v (%v)", num, v3)
+	}
+
+	data.SetIndex(2, v)
+	v2, err = data.GetIndex(2)
+	if err != nil {
+		t.Fatal(err)
+	} else if num := v2.Int64(); num != 2 {
+		t.Errorf("Expected 2, got %v (%v)", num, v2)
+	}
+
+	largeValue, err := ctx.Create(int(500))
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	// 500 truncates to 500 % 256 == 244
+	data.SetIndex(2, largeValue)
+	v4, err := data.GetIndex(2)
+	if err != nil {
+		t.Fatal(err)
+	} else if num := v4.Int64(); num != 244 {
+		t.Errorf("Expected 244, got %v (%v)", num, v4)
+	}
+
+	negativeValue, err := ctx.Create(int(-55))
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	// -55 "truncates" to -55 % 256 == 201
+	data.SetIndex(2, negativeValue)
+	v5, err := data.GetIndex(2)
+	if err != nil {
+		t.Fatal(err)
+	} else if num := v5.Int64(); num != 201 {
+		t.Errorf("Expected 201, got %v (%v)", num, v5)
+	}
+}
+
+func TestReadAndWriteIndexFromArray(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso.NewContext()
+	val, err := ctx.Create([]int{1, 2, 3})
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	v, err := val.GetIndex(1)
+	if err != nil {
+		t.Fatal(err)
+	} else if num := v.Int64(); num != 2 {
+		t.Errorf("Wrong value, expected 2, got %v (%v)", num, v)
+	}
+
+	v2, err := val.GetIndex(17)
+	if err != nil {
+		t.Fatal(err)
+	} else if str := v2.String(); str != "undefined" {
+		t.Errorf("Expected undefined, got %s", str)
+	}
+
+	val.SetIndex(17, v)
+	v2, err = val.GetIndex(17)
+	if err != nil {
+		t.Fatal(err)
+	} else if num := v2.Int64(); num != 2 {
+		t.Errorf("Expected 2, got %v (%v)", num, v2)
+	}
+}
+
+// upperString unmarshals JSON strings in upper case.
+type upperString string
+
+func (s *upperString) UnmarshalJSON(b []byte) error {
+	var str string
+	if err := json.Unmarshal(b, &str); err != nil {
+		return err
+	}
+	*s = upperString(strings.ToUpper(str))
+	return nil
+}
+
+func TestArrayRanges(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	arr, err := ctx.Eval(`[1.5, 2, 3, "four", true, {five: 5}]`, "test.js")
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	if nums, err := arr.GetFloat64Range(0, 3); err != nil {
+		t.Fatal(err)
+	} else if !reflect.DeepEqual(nums, []float64{1.5, 2, 3}) {
+		t.Errorf("Expected [1.5 2 3], got %v", nums)
+	}
+	if _, err := arr.GetFloat64Range(2, 2); err == nil || !strings.Contains(err.Error(), "Element 3") {
+		t.Errorf("Expected an error for the string at index 3, got %v", err)
+	}
+	if vals, err := arr.GetRange(3, 3); err != nil {
+		t.Fatal(err)
+	} else if vals[0].String() != "four" || !vals[1].Bool() || !vals[2].IsKind(KindObject) {
+		t.Errorf("Unexpected values %v", vals)
+	}
+	if _, err := arr.GetFloat64Range(0, -1); err == nil {
+		t.Error("Expected an error for a negative count")
+	}
+	if _, err := arr.GetRange(-1, 2); err == nil {
+		t.Error("Expected an error for a negative start")
+	}
+	if err := arr.SetBoolRange(-1, []bool{true}); err == nil {
+		t.Error("Expected an error for a negative start")
+	}
+
+	// Objects whose elements can't be created are released.
+	live := ctx.LiveValues()
+	if _, err := ctx.Create(map[string]interface{}{"a": 1, "b": make(chan int)}); err == nil {
+		t.Error("Expected an error creating a channel")
+	}
+	if _, err := ctx.Create([]interface{}{1, make(chan int)}); err == nil {
+		t.Error("Expected an error creating a channel")
+	}
+	if ctx.LiveValues() != live {
+		t.Errorf("Expected %d live values after failed creates, got %d", live, ctx.LiveValues())
+	}
+
+	if err := arr.SetStringRange(0, []string{"a", "", "\u00e9"}); err != nil {
+		t.Fatal(err)
+	}
+	if err := arr.SetBoolRange(3, []bool{false, true}); err != nil {
+		t.Fatal(err)
+	}
+	if strs, err := arr.GetStringRange(0, 3); err != nil {
+		t.Fatal(err)
+	} else if !reflect.DeepEqual(strs, []string{"a", "", "\u00e9"}) {
+		t.Errorf("Expected [a  \u00e9], got %q", strs)
+	}
+	if bools, err := arr.GetBoolRange(3, 2); err != nil {
+		t.Fatal(err)
+	} else if !reflect.DeepEqual(bools, []bool{false, true}) {
+		t.Errorf("Expected [false true], got %v", bools)
+	}
+
+	// Create and ReadInto use ranges for slices of primitives.
+	created, err := ctx.Create([]int{3, 1, 2})
+	if err != nil {
+		t.Fatal(err)
+	}
+	var ints []int
+	if err := ReadInto(&ints, created, 1); err != nil {
+		t.Fatal(err)
+	}
+	if !reflect.DeepEqual(ints, []int{3, 1, 2}) {
+		t.Errorf("Expected [3 1 2], got %v", ints)
+	}
+
+	// Arrays with holes fall back to reading element by element.
+	holes, err := ctx.Eval(`[1, , 3]`, "test.js")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := ReadInto(&ints, holes, 1); err != nil {
+		t.Fatal(err)
+	}
+	if !reflect.DeepEqual(ints, []int{1, 0, 3}) {
+		t.Errorf("Expected [1 0 3], got %v", ints)
+	}
+
+	// Element getters and setters may call back into Go.
+	ctx.Global().Set("cb", ctx.Bind("cb", func(in CallbackArgs) (*Value, error) {
+		return in.Context.Create("from go")
+	}))
+	accessors, err := ctx.Eval(`const acc = ["a", "b"];
+		Object.defineProperty(acc, 1, {get: () => cb(), set: v => cb(v)});
+		acc`, "test.js")
+	if err != nil {
+		t.Fatal(err)
+	}
+	var strs []string
+	if err := ReadInto(&strs, accessors, 1); err != nil {
+		t.Fatal(err)
+	}
+	if !reflect.DeepEqual(strs, []string{"a", "from go"}) {
+		t.Errorf("Expected [a from go], got %q", strs)
+	}
+	if err := accessors.SetStringRange(0, []string{"c", "d"}); err != nil {
+		t.Fatal(err)
+	}
+
+	// Elements implementing json.Unmarshaler are still unmarshaled.
+	var uppers []upperString
+	words, err := ctx.Eval(`["x", "y"]`, "test.js")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := ReadInto(&uppers, words, 1); err != nil {
+		t.Fatal(err)
+	}
+	if !reflect.DeepEqual(uppers, []upperString{"X", "Y"}) {
+		t.Errorf("Expected [X Y], got %q", uppers)
+	}
+}
+
+func TestGetOwnProperties(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	obj, err := ctx.Eval(`
+		const obj = {b: "two", 1: 1, a: true};
+		Object.defineProperty(obj, "hidden", {value: 3, enumerable: false});
+		obj[Symbol("sym")] = 4;
+		obj`, "test.js")
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	if keys, err := obj.GetObjKeys(); err != nil {
+		t.Fatal(err)
+	} else if !reflect.DeepEqual(keys, []string{"1", "b", "a"}) {
+		t.Errorf("Expected [1 b a], got %q", keys)
+	}
+	if keys, err := obj.GetOwnPropertyNames(PropertiesIncludeSymbols); err != nil {
+		t.Fatal(err)
+	} else if !reflect.DeepEqual(keys, []string{"1", "b", "a", "hidden", "Symbol(sym)"}) {
+		t.Errorf("Expected [1 b a hidden Symbol(sym)], got %q", keys)
+	}
+
+	keys, vals, err := obj.GetOwnProperties(PropertiesEnumerableOnly)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(keys) != 3 || len(vals) != 3 {
+		t.Fatalf("Expected 3 keys and values, got %q and %v", keys, vals)
+	}
+	if vals[0].Int64() != 1 || vals[1].String() != "two" || !vals[2].Bool() {
+		t.Errorf("Unexpected values %v", vals)
+	}
+
+	var m map[string]interface{}
+	if err := ReadInto(&m, obj, 1); err != nil {
+		t.Fatal(err)
+	}
+	if !reflect.DeepEqual(m, map[string]interface{}{"1": 1.0, "b": "two", "a": true}) {
+		t.Errorf("Unexpected map %v", m)
+	}
+
+	num, err := ctx.Create(1)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, err := num.GetOwnPropertyNames(0); err == nil {
+		t.Error("Expected an error for a non-object")
+	}
+}
+
+type wrapInner struct {
+	Count int
+}
+
+type wrapOuter struct {
+	Name    string `json:"name"`
+	Skipped string `json:"-"`
+	Tags    []string
+	Inner   wrapInner
+	*wrapInner
+	hidden int
+}
+
+func (w *wrapOuter) Greet(in CallbackArgs) (*Value, error) {
+	return in.Context.Create("hello " + w.Name)
+}
+
+type wrapSelf struct {
+	*wrapSelf
+	Name string
+}
+
+func TestWrap(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	outer := &wrapOuter{Name: "a", Skipped: "x", Tags: []string{"t"}, Inner: wrapInner{1}}
+	obj, err := ctx.Wrap(outer)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := ctx.Global().Set("obj", obj); err != nil {
+		t.Fatal(err)
+	}
+
+	res, err := ctx.Eval(`JSON.stringify(Object.keys(obj)) + " " + obj.name + " " + obj.Tags[0] + " " + obj.Greet()`, "test.js")
+	if err != nil {
+		t.Fatal(err)
+	} else if res.String() != `["name","Tags","Inner","Count","Greet"] a t hello a` {
+		t.Errorf("Unexpected result %q", res.String())
+	}
+
+	// Fields are read when they are accessed, and assignments write them.
+	outer.Name = "b"
+	if _, err := ctx.Eval(`obj.Inner.Count += 1; obj.Tags = ["u", "v"]`, "test.js"); err != nil {
+		t.Fatal(err)
+	}
+	if res, err := ctx.Eval(`obj.name`, "test.js"); err != nil {
+		t.Fatal(err)
+	} else if res.String() != "b" {
+		t.Errorf("Expected b, got %q", res.String())
+	}
+	if outer.Inner.Count != 2 || !reflect.DeepEqual(outer.Tags, []string{"u", "v"}) {
+		t.Errorf("Unexpected struct after assignments: %+v", outer)
+	}
+
+	// The nil embedded struct reads as undefined and can't be written.
+	if res, err := ctx.Eval(`obj.Count`, "test.js"); err != nil {
+		t.Fatal(err)
+	} else if !res.IsKind(KindUndefined) {
+		t.Errorf("Expected undefined, got %q", res.String())
+	}
+	if _, err := ctx.Eval(`obj.Count = 1`, "test.js"); err == nil {
+		t.Error("Expected an error setting a field of a nil embedded struct")
+	}
+	if _, err := ctx.Eval(`obj.name = {}`, "test.js"); err == nil {
+		t.Error("Expected an error setting a string field to an object")
+	}
+
+	// Properties of wrapped structs can be accessed from Go too.
+	c, err := ctx.Create("c")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := obj.Set("name", c); err != nil {
+		t.Fatal(err)
+	} else if name, err := obj.Get("name"); err != nil {
+		t.Fatal(err)
+	} else if name.String() != "c" || outer.Name != "c" {
+		t.Errorf("Expected name c, got %q and %q", name.String(), outer.Name)
+	}
+
+	// Methods are shared by all objects of a struct type rather than bound
+	// on every access.
+	other, err := ctx.Wrap(&wrapOuter{Name: "d"})
+	if err != nil {
+		t.Fatal(err)
+	} else if err := ctx.Global().Set("other", other); err != nil {
+		t.Fatal(err)
+	}
+	callbacks := len(ctx.callbacks)
+	if res, err := ctx.Eval(`
+		var greetings = [];
+		for (var i = 0; i < 100; i++) greetings.push(obj.Greet(), other.Greet());
+		(obj.Greet === other.Greet) + " " + greetings.slice(0, 2).join()`, "test.js"); err != nil {
+		t.Fatal(err)
+	} else if res.String() != "true hello c,hello d" {
+		t.Errorf("Unexpected result %q", res.String())
+	}
+	if len(ctx.callbacks) != callbacks {
+		t.Errorf("Expected no new callbacks, got %d", len(ctx.callbacks)-callbacks)
+	}
+	if _, err := ctx.Eval(`var greet = obj.Greet; greet()`, "test.js"); err == nil {
+		t.Error("Expected an error calling a method without its object")
+	}
+
+	if self, err := ctx.Wrap(&wrapSelf{Name: "self"}); err != nil {
+		t.Fatal(err)
+	} else if name, err := self.Get("Name"); err != nil {
+		t.Fatal(err)
+	} else if name.String() != "self" {
+		t.Errorf("Expected self, got %q", name.String())
+	}
+
+	if _, err := ctx.Wrap(wrapInner{}); err == nil {
+		t.Error("Expected an error wrapping a struct that is not a pointer")
+	}
+}
+
+func TestInterceptors(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	m := map[string]int{"a": 1, "b": 2}
+	mapView, err := ctx.CreateView(m)
+	if err != nil {
+		t.Fatal(err)
+	}
+	s := []wrapInner{{1}, {2}, {3}}
+	sliceView, err := ctx.CreateView(s)
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx.Global().Set("m", mapView)
+	ctx.Global().Set("s", sliceView)
+
+	res, err := ctx.Eval(`
+		m.c = m.a + m.b;
+		s[1].Count = 20;
+		s[2] = {Count: 30};
+		[JSON.stringify(Object.keys(m)), "a" in m, "z" in m, m.z, s.length, 5 in s, Object.keys(s).length].join(" ")`, "test.js")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if res.String() != `["a","b","c"] true false  3 false 3` {
+		t.Errorf("Unexpected result %q", res.String())
+	}
+	if m["c"] != 3 {
+		t.Errorf("Expected m.c = 3, got %v", m)
+	}
+	if !reflect.DeepEqual(s, []wrapInner{{1}, {20}, {30}}) {
+		t.Errorf("Unexpected slice %v", s)
+	}
+
+	// Views can be indexed and read from Go as well.
+	nums := []int{4, 5, 6}
+	numsView, err := ctx.CreateView(nums)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if elem, err := numsView.GetIndex(1); err != nil {
+		t.Fatal(err)
+	} else if elem.Int64() != 5 {
+		t.Errorf("Expected 5, got %v", elem)
+	}
+	seven, _ := ctx.Create(7)
+	if err := numsView.SetIndex(2, seven); err != nil {
+		t.Fatal(err)
+	}
+	var read []int
+	if err := ReadInto(&read, numsView, 1); err != nil {
+		t.Fatal(err)
+	}
+	if !reflect.DeepEqual(read, []int{4, 5, 7}) || nums[2] != 7 {
+		t.Errorf("Expected [4 5 7], got %v and %v", read, nums)
+	}
+
+	// Map keys that look like numbers are properties like any other.
+	numeric := map[string]int{"123": 1, "x": 2, "01": 3}
+	numericView, err := ctx.CreateView(numeric)
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx.Global().Set("n", numericView)
+	if res, err := ctx.Eval(`
+		n[0] = n[123] + n["01"];
+		[JSON.stringify(Object.keys(n)), n["123"], 123 in n, 7 in n, n[7]].join(" ")`, "test.js"); err != nil {
+		t.Fatal(err)
+	} else if res.String() != `["0","123","01","x"] 1 true false ` {
+		t.Errorf("Unexpected result %q", res.String())
+	}
+	if numeric["0"] != 4 {
+		t.Errorf("Expected n[0] = 4, got %v", numeric)
+	}
+
+	// Handlers without Set leave assignments to the object.
+	var looked []string
+	obj, err := ctx.NewInterceptedObject(&PropertyHandler{
+		Get: func(ctx *Context, name string) (*Value, error) {
+			looked = append(looked, name)
+			if name == "fail" {
+				return nil, errors.New("lookup failed")
+			}
+			return nil, nil
+		},
+	}, nil)
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx.Global().Set("obj", obj)
+	if res, err := ctx.Eval(`obj.x = 1; obj.x + obj.y`, "test.js"); err != nil {
+		t.Fatal(err)
+	} else if !math.IsNaN(res.Float64()) {
+		t.Errorf("Expected NaN, got %v", res)
+	}
+	if _, err := ctx.Eval(`obj.fail`, "test.js"); err == nil || !strings.Contains(err.Error(), "lookup failed") {
+		t.Errorf("Expected the lookup error, got %v", err)
+	}
+	if len(looked) == 0 || looked[len(looked)-1] != "fail" {
+		t.Errorf("Unexpected lookups %v", looked)
+	}
+}
+
+func TestBigInt(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	bigint := ctx.CreateBigInt(math.MinInt64 + 1)
+	if !bigint.IsKind(KindBigInt) {
+		t.Errorf("Expected a BigInt, got %q", bigint.String())
+	} else if i, lossless := bigint.BigInt64(); !lossless || i != math.MinInt64+1 {
+		t.Errorf("Expected %d, got %d (lossless %v)", int64(math.MinInt64+1), i, lossless)
+	}
+	if u, lossless := ctx.CreateBigUint64(math.MaxUint64).BigUint64(); !lossless || u != math.MaxUint64 {
+		t.Errorf("Expected %d, got %d (lossless %v)", uint64(math.MaxUint64), u, lossless)
+	}
+
+	res, err := ctx.Eval(`2n ** 64n`, "test.js")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, lossless := res.BigUint64(); lossless {
+		t.Error("Expected 2^64 not to fit into a uint64")
+	}
+	var u uint64
+	if err := ReadInto(&u, res, 1); err == nil {
+		t.Error("Expected ReadInto to fail for 2^64")
+	}
+
+	// Create and ReadInto map tagged integers to BigInts.
+	type ids struct {
+		ID    int64   `v8:"bigint"`
+		Count uint64  `v8:"bigint"`
+		Refs  []int64 `v8:"bigint"`
+		Plain int64
+	}
+	in := ids{1<<62 + 1, math.MaxUint64, []int64{1<<53 + 1, -1}, 1<<53 + 1}
+	created, err := ctx.Create(in)
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx.Global().Set("ids", created)
+	if res, err := ctx.Eval(`[typeof ids.ID, typeof ids.Refs[0], typeof ids.Plain, ids.ID + 1n].join(" ")`, "test.js"); err != nil {
+		t.Fatal(err)
+	} else if res.String() != "bigint bigint number 4611686018427387906" {
+		t.Errorf("Unexpected result %q", res.String())
+	}
+	var out ids
+	if err := ReadInto(&out, created, 2); err != nil {
+		t.Fatal(err)
+	}
+	if out.ID != in.ID || out.Count != in.Count || !reflect.DeepEqual(out.Refs, in.Refs) {
+		t.Errorf("Expected %v, got %v", in, out)
+	}
+}
+
+func TestExternalString(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	testcases := []struct {
+		text    string
+		oneByte bool
+		length  int
+	}{
+		{"", true, 0},
+		{"plain ascii", true, 11},
+		{"caf\u00e9 \u00ff", true, 6},
+		{"\u65e5\u672c \U0001F600", false, 5}, // the emoji is a surrogate pair
+		{"bad \xff utf-8", false, 11},
+	}
+	for _, test := range testcases {
+		es := NewExternalString(test.text)
+		if es.OneByte() != test.oneByte {
+			t.Errorf("%q: expected one byte %v", test.text, test.oneByte)
+		}
+		str, err := ctx.CreateExternalString(es)
+		if err != nil {
+			t.Fatal(err)
+		}
+		es.Release()
+
+		want := strings.ToValidUTF8(test.text, "\uFFFD")
+		if str.String() != want {
+			t.Errorf("Expected %q, got %q", want, str.String())
+		}
+		ctx.Global().Set("str", str)
+		if res, err := ctx.Eval(`str.length`, "test.js"); err != nil {
+			t.Fatal(err)
+		} else if res.Int64() != int64(test.length) {
+			t.Errorf("%q: expected length %d, got %d", test.text, test.length, res.Int64())
+		}
 	}
-	val, err := res.Get("foo")
-	if err != nil {
-		t.Fatalf("Error trying to get field: %v", err)
+
+	// Strings stay valid after the text has been released.
+	runtime.GC()
+	if res, err := ctx.Eval(`str + "!"`, "test.js"); err != nil {
+		t.Fatal(err)
+	} else if res.String() != "bad \uFFFD utf-8!" {
+		t.Errorf("Unexpected result %q", res.String())
 	}
-	if str := val.String(); str != "bar" {
-		t.Errorf("Expected 'bar', got %q", str)
+	if _, err := ctx.CreateExternalString(&ExternalString{}); err == nil {
+		t.Error("Expected an error for a released string")
 	}
 }
 
-func TestReadAndWriteIndexFromArrayBuffer(t *testing.T) {
+func TestBridgeStats(t *testing.T) {
 	t.Parallel()
-
 	Init("")
-
 	iso, err := NewIsolate()
 	if err != nil {
 		t.Fatal(err)
 	}
 	ctx := iso.NewContext()
-	val, err := ctx.Create(struct {
-		Data []byte `v8:"arraybuffer"`
-	}{[]byte{1, 2, 3}})
-	if err != nil {
+	ctx.Global().Set("cb", ctx.Bind("cb", func(in CallbackArgs) (*Value, error) {
+		return nil, nil
+	}))
+
+	if _, err := ctx.Eval(`cb()`, "before.js"); err != nil {
 		t.Fatal(err)
 	}
+	if stats := iso.BridgeStats(); stats.Enabled || len(stats.Calls) != 0 {
+		t.Errorf("Expected no statistics by default, got %+v", stats)
+	}
 
-	data, err := val.Get("Data")
+	iso.EnableBridgeStats(true)
+	const script = `cb(1, 2); cb(3); "some text"`
+	res, err := ctx.Eval(script, "stats.js")
 	if err != nil {
 		t.Fatal(err)
 	}
-
-	v, err := data.GetIndex(1)
-	if err != nil {
+	_ = res.String()
+	res.release()
+	iso.EnableBridgeStats(false)
+	if _, err := ctx.Eval(`cb()`, "after.js"); err != nil {
 		t.Fatal(err)
-	} else if num := v.Int64(); num != 2 {
-		t.Errorf("Wrong value, expected 2, got %v (%v)", num, v)
 	}
 
-	v2, err := data.GetIndex(17)
-	if err != nil {
-		t.Fatal(err)
-	} else if str := v2.String(); str != "undefined" {
-		t.Errorf("Expected undefined, got %s", str)
+	stats := iso.BridgeStats()
+	if stats.Enabled {
+		t.Error("Expected statistics to be disabled")
+	}
+	run := stats.Calls["v8_Context_Run"]
+	if run.Calls != 1 || run.Bytes != uint64(len(script)) || run.Total <= 0 {
+		t.Errorf("Unexpected v8_Context_Run statistics: %+v", run)
+	}
+	if cb := stats.Calls["go_callback"]; cb.Calls != 2 || cb.Total > run.Total {
+		t.Errorf("Unexpected go_callback statistics: %+v", cb)
+	}
+	if str := stats.Calls["v8_Value_String"]; str.Calls != 1 || str.Bytes != uint64(len("some text")) {
+		t.Errorf("Unexpected v8_Value_String statistics: %+v", str)
+	}
+	// The result and the three arguments of cb, which may have been released
+	// by finalizers already.
+	if stats.HandlesCreated != 4 || stats.HandlesReleased < 1 || stats.HandlesReleased > 4 {
+		t.Errorf("Expected 4 handles created and 1-4 released, got %d and %d",
+			stats.HandlesCreated, stats.HandlesReleased)
 	}
 
-	v3, err := data.GetIndex(2)
-	if err != nil {
-		t.Fatal(err)
-	} else if num := v3.Int64(); num != 3 {
-		t.Errorf("Expected undefined, got %v (%v)", num, v3)
+	var buckets uint64
+	for _, n := range run.Histogram {
+		buckets += n
+	}
+	if buckets != run.Calls {
+		t.Errorf("Expected the histogram to count %d calls, got %d", run.Calls, buckets)
+	}
+	if p := run.Percentile(50); p < run.Mean() || p > 2*run.Mean() {
+		t.Errorf("Expected the median of a single call to bound its duration %v, got %v", run.Mean(), p)
 	}
 
-	data.SetIndex(2, v)
-	v2, err = data.GetIndex(2)
-	if err != nil {
-		t.Fatal(err)
-	} else if num := v2.Int64(); num != 2 {
-		t.Errorf("Expected 2, got %v (%v)", num, v2)
+	// Every entry point of the enum has a name of its own.
+	names := map[string]bool{}
+	for i, name := range bridgeEntryNames {
+		if name == "" || names[name] {
+			t.Errorf("Expected a unique name for bridge entry %d, got %q", i, name)
+		}
+		names[name] = true
 	}
+}
 
-	largeValue, err := ctx.Create(int(500))
+func TestScope(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
 	if err != nil {
 		t.Fatal(err)
 	}
-
-	// 500 truncates to 500 % 256 == 244
-	data.SetIndex(2, largeValue)
-	v4, err := data.GetIndex(2)
+	ctx := iso.NewContext()
+	// Values that could be finalized while the statistics are collected are
+	// released right away.
+	global, cb := ctx.Global(), ctx.Bind("cb", func(in CallbackArgs) (*Value, error) {
+		return nil, nil
+	})
+	global.Set("cb", cb)
+	global.release()
+	cb.release()
+	arr, err := ctx.Eval(`["a", "b", "c", "d"]`, "scope.js")
 	if err != nil {
 		t.Fatal(err)
-	} else if num := v4.Int64(); num != 244 {
-		t.Errorf("Expected 244, got %v (%v)", num, v4)
 	}
 
-	negativeValue, err := ctx.Create(int(-55))
-	if err != nil {
-		t.Fatal(err)
+	iso.EnableBridgeStats(true)
+	var scoped, kept, outer *Value
+	ctx.Scope(func(s *Scope) {
+		for i := 0; i < 4; i++ {
+			if scoped, err = arr.GetIndex(i); err != nil {
+				t.Fatal(err)
+			}
+		}
+		if _, err := ctx.Eval(`cb(1, 2)`, "scope.js"); err != nil {
+			t.Fatal(err)
+		}
+		// The elements, the two arguments of cb and the result of Eval.
+		if s.Len() != 7 {
+			t.Errorf("Expected 7 values in the scope, got %d", s.Len())
+		}
+		kept = s.Escape(scoped)
+		if s.Escape(arr) != arr {
+			t.Error("Expected values from outside to be returned as they are")
+		}
+
+		ctx.Scope(func(inner *Scope) {
+			if outer, err = ctx.Create("inner"); err != nil {
+				t.Fatal(err)
+			}
+			inner.Escape(outer)
+			if inner.Len() != 0 || s.Len() != 7 {
+				t.Errorf("Expected the escaped value to move to the outer scope, got %d and %d",
+					inner.Len(), s.Len())
+			}
+		})
+		if outer.String() != "inner" {
+			t.Errorf("Expected the escaped value to stay valid, got %q", outer.String())
+		}
+		s.Escape(outer)
+	})
+	iso.EnableBridgeStats(false)
+
+	if scoped != kept || kept.String() != "d" || outer.String() != "inner" {
+		t.Errorf("Expected escaped values to stay valid, got %q and %q", kept.String(), outer.String())
+	}
+	if stats := iso.BridgeStats(); stats.Calls["v8_Value_ReleaseAll"].Calls != 2 ||
+		stats.Calls["v8_Value_Release"].Calls != 0 || stats.HandlesReleased != 6 {
+		t.Errorf("Expected the scoped values to be released in bulk, got %+v", stats)
 	}
 
-	// -55 "truncates" to -55 % 256 == 201
-	data.SetIndex(2, negativeValue)
-	v5, err := data.GetIndex(2)
-	if err != nil {
-		t.Fatal(err)
-	} else if num := v5.Int64(); num != 201 {
-		t.Errorf("Expected 201, got %v (%v)", num, v5)
+	// Values are released and the scope is closed on panics too.
+	var leaked *Value
+	func() {
+		defer func() { recover() }()
+		ctx.Scope(func(s *Scope) {
+			leaked, _ = ctx.Create(1)
+			panic("oops")
+		})
+	}()
+	if leaked.ptr != nil || ctx.scope != nil {
+		t.Error("Expected the scope to be closed after a panic")
+	}
+	// Values used after their scope has ended fail instead of panicking.
+	if _, err := leaked.Get("x"); err == nil || err.Error() != errContextReleased.Error() {
+		t.Errorf("Expected the released context error, got %v", err)
+	}
+	if leaked.String() != "" {
+		t.Errorf("Expected no string from a released value, got %q", leaked.String())
 	}
 }
 
-func TestReadAndWriteIndexFromArray(t *testing.T) {
+func TestReleaseContextValues(t *testing.T) {
 	t.Parallel()
 	Init("")
 	iso, err := NewIsolate()
 	if err != nil {
 		t.Fatal(err)
 	}
-	ctx := iso.NewContext()
-	val, err := ctx.Create([]int{1, 2, 3})
+	ctx, other := iso.NewContext(), iso.NewContext()
+	defer other.Release()
+
+	obj, err := ctx.Eval(`({a: 1, b: "b"})`, "release.js")
 	if err != nil {
 		t.Fatal(err)
 	}
-
-	v, err := val.GetIndex(1)
+	a, err := obj.Get("a")
 	if err != nil {
 		t.Fatal(err)
-	} else if num := v.Int64(); num != 2 {
-		t.Errorf("Wrong value, expected 2, got %v (%v)", num, v)
+	}
+	kept, err := other.Create("kept")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if ctx.LiveValues() != 2 || iso.LiveValues() != 3 {
+		t.Errorf("Expected 2 and 3 live values, got %d and %d", ctx.LiveValues(), iso.LiveValues())
+	}
+	a.release()
+	if ctx.LiveValues() != 1 {
+		t.Errorf("Expected 1 live value after releasing one, got %d", ctx.LiveValues())
 	}
 
-	v2, err := val.GetIndex(17)
+	ctx.Release()
+	if iso.LiveValues() != 1 || other.LiveValues() != 1 {
+		t.Errorf("Expected only the value of the other context to be live, got %d", iso.LiveValues())
+	}
+	// Values of the released context fail instead of using freed handles.
+	if _, err := obj.Get("b"); err == nil {
+		t.Error("Expected an error from a value of a released context")
+	}
+	if obj.String() != "" || obj.Bool() {
+		t.Error("Expected zero values from a value of a released context")
+	}
+	if _, err := ctx.Eval(`1`, "release.js"); err == nil {
+		t.Error("Expected an error from a released context")
+	}
+	if _, err := ctx.Wrap(&struct{ A int }{}); err == nil {
+		t.Error("Expected an error wrapping into a released context")
+	}
+	if _, err := ctx.CreateView(map[string]int{"a": 1}); err == nil {
+		t.Error("Expected an error creating a view in a released context")
+	}
+	obj.release()
+	if kept.String() != "kept" {
+		t.Errorf("Expected values of other contexts to stay valid, got %q", kept.String())
+	}
+}
+
+func TestRuntime(t *testing.T) {
+	t.Parallel()
+	Init("")
+	var mu sync.Mutex
+	var handled int
+	rt, err := NewRuntime(RuntimeOptions{
+		Isolates: 3,
+		Setup: func(ctx *Context) error {
+			_, err := ctx.Eval(`function square(x) { return x * x }`, "setup.js")
+			return err
+		},
+		PanicHandler: func(v interface{}, stack []byte) {
+			if v != "job panicked" || len(stack) == 0 {
+				t.Errorf("Unexpected panic %v with stack %q", v, stack)
+			}
+			mu.Lock()
+			handled++
+			mu.Unlock()
+		},
+	})
 	if err != nil {
 		t.Fatal(err)
-	} else if str := v2.String(); str != "undefined" {
-		t.Errorf("Expected undefined, got %s", str)
 	}
 
-	val.SetIndex(17, v)
-	v2, err = val.GetIndex(17)
+	const jobs = 200
+	sum := 0
+	for n := 0; n < jobs; n++ {
+		n := n
+		err := rt.Submit(func(ctx *Context) {
+			if n%50 == 0 {
+				panic("job panicked")
+			}
+			res, err := ctx.Eval(fmt.Sprintf("square(%d)", n), "job.js")
+			if err != nil {
+				t.Error(err)
+				return
+			}
+			mu.Lock()
+			sum += int(res.Int64())
+			mu.Unlock()
+		})
+		if err != nil {
+			t.Fatal(err)
+		}
+	}
+	rt.Close()
+
+	want := 0
+	for n := 0; n < jobs; n++ {
+		if n%50 != 0 {
+			want += n * n
+		}
+	}
+	if sum != want {
+		t.Errorf("Expected a sum of %d, got %d", want, sum)
+	}
+
+	var executed, panics uint64
+	for _, s := range rt.Stats() {
+		executed += s.Executed
+		panics += s.Panics
+		if s.Queued != 0 {
+			t.Errorf("Expected empty queues after Close, got %+v", s)
+		}
+	}
+	if executed != jobs || panics != jobs/50 || handled != jobs/50 {
+		t.Errorf("Expected %d jobs and %d panics, got %d and %d (%d handled)",
+			jobs, jobs/50, executed, panics, handled)
+	}
+	if err := rt.Submit(func(*Context) {}); err != ErrRuntimeClosed {
+		t.Errorf("Expected ErrRuntimeClosed, got %v", err)
+	}
+
+	// Jobs submitted concurrently with Close either run or are rejected.
+	rt, err = NewRuntime(RuntimeOptions{Isolates: 2})
 	if err != nil {
 		t.Fatal(err)
-	} else if num := v2.Int64(); num != 2 {
-		t.Errorf("Expected 2, got %v (%v)", num, v2)
+	}
+	var ran, accepted int32
+	var wg sync.WaitGroup
+	for g := 0; g < 4; g++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for rt.Submit(func(*Context) { atomic.AddInt32(&ran, 1) }) == nil {
+				atomic.AddInt32(&accepted, 1)
+			}
+		}()
+	}
+	time.Sleep(10 * time.Millisecond)
+	rt.Close()
+	wg.Wait()
+	if ran != accepted {
+		t.Errorf("Expected all %d accepted jobs to run, %d did", accepted, ran)
+	}
+
+	// Setup errors are returned by NewRuntime.
+	_, err = NewRuntime(RuntimeOptions{
+		Isolates: 2,
+		Setup:    func(*Context) error { return errors.New("no setup") },
+	})
+	if err == nil || !strings.Contains(err.Error(), "no setup") {
+		t.Errorf("Expected the setup error, got %v", err)
 	}
 }
 
@@ -781,11 +1699,222 @@ func TestBind(t *testing.T) {
 	res, err = getLast.Call(nil, res, abc, xyz)
 	if err != nil {
 		t.Fatal(err)
-	} else if str := res.String(); str != "xyz" {
-		t.Errorf("Expected xyz, got %q", str)
+	} else if str := res.String(); str != "xyz" {
+		t.Errorf("Expected xyz, got %q", str)
+	}
+}
+
+func TestBindWithOptions(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	var fast, lazy Loc
+	ctx.Global().Set("fast", ctx.BindWithOptions("fast", func(in CallbackArgs) (*Value, error) {
+		fast = in.CallerLoc()
+		return nil, nil
+	}, BindOptions{}))
+	ctx.Global().Set("lazy", ctx.BindWithOptions("lazy", func(in CallbackArgs) (*Value, error) {
+		if in.Caller != (Loc{}) {
+			t.Errorf("Expected the caller not to be looked up eagerly, got %#v", in.Caller)
+		}
+		lazy = in.CallerLoc()
+		return nil, nil
+	}, BindOptions{CaptureCaller: true}))
+
+	iso.EnableBridgeStats(true)
+	if _, err := ctx.Eval(`
+		function doit() {
+			fast();
+			lazy();
+		}
+		doit()
+	`, "somefile.js"); err != nil {
+		t.Fatal(err)
+	}
+	iso.EnableBridgeStats(false)
+	// Only the lazy callback looks the caller up.
+	if stats := iso.BridgeStats(); stats.Calls["v8_Isolate_CurrentCaller"].Calls != 1 {
+		t.Errorf("Expected one caller lookup, got %+v", stats.Calls["v8_Isolate_CurrentCaller"])
+	}
+	if fast != (Loc{}) {
+		t.Errorf("Expected no caller without CaptureCaller, got %#v", fast)
+	}
+	if expected := (Loc{"doit", "somefile.js", 4, 4}); lazy != expected {
+		t.Errorf("Wrong source location: %#v", lazy)
+	}
+}
+
+func TestPreparedCall(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso.NewContext()
+	fn, err := ctx.Eval(`(function(...args) {
+		if (args[0] === "throw") throw new Error("thrown");
+		return this.prefix + JSON.stringify(args);
+	})`, "prepared.js")
+	if err != nil {
+		t.Fatal(err)
+	}
+	this, _ := ctx.Create(map[string]string{"prefix": "args: "})
+	obj, _ := ctx.Eval(`({a: 1})`, "prepared.js")
+
+	call, err := fn.Prepare(this, 6)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer call.Release()
+	call.SetString(0, "short")
+	call.SetFloat64(1, 1.5)
+	call.SetInt64(2, 42)
+	call.SetBool(3, true)
+	call.SetValue(4, obj)
+	res, err := call.Call()
+	if err != nil {
+		t.Fatal(err)
+	} else if s := res.String(); s != `args: ["short",1.5,42,true,{"a":1},null]` {
+		t.Errorf("Wrong result: %s", s)
+	}
+
+	// Arguments keep their values between calls, and string buffers grow.
+	call.SetString(0, "a longer string")
+	call.SetUndefined(4)
+	if res, err = call.Call(); err != nil {
+		t.Fatal(err)
+	} else if s := res.String(); s != `args: ["a longer string",1.5,42,true,null,null]` {
+		t.Errorf("Wrong result: %s", s)
+	}
+
+	call.SetString(0, "throw")
+	if err := call.Invoke(); err == nil || !strings.Contains(err.Error(), "thrown") {
+		t.Errorf("Expected the exception to be returned, got %v", err)
+	}
+
+	// Arguments must be in range and values must belong to the context.
+	other := iso.NewContext()
+	defer other.Release()
+	foreign, _ := other.Create("foreign")
+	if err := call.SetValue(4, foreign); err == nil {
+		t.Error("Expected an error setting a value of another context")
+	}
+	if err := call.SetInt64(6, 1); err == nil {
+		t.Error("Expected an error setting an argument out of range")
+	}
+	if _, err := fn.Prepare(foreign, 0); err == nil {
+		t.Error("Expected an error binding a receiver of another context")
+	}
+	if _, err := fn.Prepare(nil, -1); err == nil {
+		t.Error("Expected an error preparing a negative number of arguments")
+	}
+
+	notFn, err := obj.Prepare(nil, 1)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, err := notFn.Call(); err == nil || err.Error() != "Not a function" {
+		t.Errorf("Expected an error calling a non-function, got %v", err)
+	}
+	notFn.Release()
+	if _, err := notFn.Call(); err == nil {
+		t.Error("Expected an error calling a released call")
+	}
+	if err := notFn.SetString(0, "released"); err == nil {
+		t.Error("Expected an error setting an argument of a released call")
+	}
+}
+
+func TestInjectConsole(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	var stdout, stderr strings.Builder
+	console, err := ctx.InjectConsole(ConsoleOptions{Stdout: &stdout, Stderr: &stderr, Prefix: "> "})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, err := ctx.Eval(`
+		console.log('hi', 1, true, {});
+		console.info('info');
+		console.warn('warn');
+		console.error('error', Symbol('sym'));
+	`, "console.js"); err != nil {
+		t.Fatal(err)
+	}
+	if expected := "> hi 1 true [object Object]\n> info\n"; stdout.String() != expected {
+		t.Errorf("Wrong stdout: %q", stdout.String())
+	}
+	if expected := "> [console.js:4] warn\n> [console.js:5] error \n"; stderr.String() != expected {
+		t.Errorf("Wrong stderr: %q", stderr.String())
+	}
+
+	// Both streams are written out in order, and arguments whose conversion
+	// logs don't garble the line.
+	var both strings.Builder
+	if _, err := ctx.InjectConsole(ConsoleOptions{Stdout: &both, Stderr: &both}); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := ctx.Eval(`
+		console.log('1');
+		console.warn('2');
+		console.log('3', { toString() { console.log('4'); return 'x' } });
+	`, "console.js"); err != nil {
+		t.Fatal(err)
+	}
+	if expected := "1\n[console.js:3] 2\n4\n3 x\n"; both.String() != expected {
+		t.Errorf("Wrong output: %q", both.String())
+	}
+
+	// Lines are flushed while the script runs once the buffer is full enough,
+	// and dropped if they don't fit at all.
+	stdout.Reset()
+	console, err = ctx.InjectConsole(ConsoleOptions{Stdout: &stdout, BufferSize: 32, FlushSize: 8})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, err := ctx.Eval(`
+		for (let i = 0; i < 10; i++) console.log('line', i);
+		console.log('a line that is much too long for the buffer');
+	`, "console.js"); err != nil {
+		t.Fatal(err)
+	}
+	if expected := strings.Repeat("line %d\n", 10); stdout.String() != fmt.Sprintf(expected,
+		0, 1, 2, 3, 4, 5, 6, 7, 8, 9) {
+		t.Errorf("Wrong stdout: %q", stdout.String())
+	}
+	if stats := console.Stats(); stats.Lines != 10 || stats.Dropped != 1 || stats.Flushes < 5 {
+		t.Errorf("Wrong stats: %+v", stats)
+	}
+
+	// Write errors are kept until Flush returns them.
+	console, _ = ctx.InjectConsole(ConsoleOptions{Stdout: timeoutWriter{}})
+	if _, err := ctx.Eval(`console.log('lost')`, "console.js"); err != nil {
+		t.Fatal(err)
+	}
+	if err := console.Flush(); err != iotest.ErrTimeout {
+		t.Errorf("Expected the write error, got %v", err)
+	}
+	if err := console.Flush(); err != nil {
+		t.Errorf("Expected the error to be returned once, got %v", err)
 	}
 }
 
+type timeoutWriter struct{}
+
+func (timeoutWriter) Write(p []byte) (int, error) { return 0, iotest.ErrTimeout }
+
 func TestBindReturnsError(t *testing.T) {
 	t.Parallel()
 	Init("")
@@ -902,6 +2031,253 @@ func TestTerminate(t *testing.T) {
 	}
 }
 
+func TestPumpMessageLoop(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	iso.StartMessagePump(time.Millisecond, 0)
+	for i := 0; i < 10; i++ {
+		res, err := ctx.Eval(`new Array(10000).fill(1).reduce((a, b) => a + b)`, "pump.js")
+		if err != nil {
+			t.Fatal(err)
+		}
+		if num := res.Int64(); num != 10000 {
+			t.Errorf("Expected 10000, got %v", res)
+		}
+	}
+	iso.StopMessagePump()
+	iso.StopMessagePump() // stopping twice is fine
+
+	// Concurrent restarts leave a single pump, and a zero interval is
+	// replaced by the default rather than making the ticker panic.
+	var wg sync.WaitGroup
+	for n := 0; n < 8; n++ {
+		wg.Add(1)
+		go func(n int) {
+			defer wg.Done()
+			iso.StartMessagePump(time.Duration(n)*time.Millisecond, 0)
+		}(n)
+	}
+	wg.Wait()
+	iso.StopMessagePump()
+	iso.pumpMutex.Lock()
+	if iso.pump != nil {
+		t.Error("Expected no pump after StopMessagePump")
+	}
+	iso.pumpMutex.Unlock()
+
+	// Pumping manually with nothing queued is a no-op.
+	iso.PumpMessageLoop(time.Millisecond)
+}
+
+func TestCompileStreaming(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	// Feed the source one byte at a time so that multi-byte characters get
+	// split across chunks.
+	src := "var greeting = \"h\u00e9llo w\u00f6rld \U0001F600\"; greeting.length"
+	script, err := ctx.CompileStreaming(iotest.OneByteReader(strings.NewReader(src)), "stream.js")
+	if err != nil {
+		t.Fatal(err)
+	}
+	for i := 0; i < 2; i++ {
+		res, err := script.Run()
+		if err != nil {
+			t.Fatal(err)
+		}
+		if num := res.Int64(); num != 14 {
+			t.Errorf("Expected 14, got %v", res)
+		}
+	}
+	if res, err := ctx.Eval(`greeting`, "check.js"); err != nil {
+		t.Fatal(err)
+	} else if str := res.String(); str != "h\u00e9llo w\u00f6rld \U0001F600" {
+		t.Errorf("Wrong string after streaming: %q", str)
+	}
+
+	if _, err := ctx.CompileStreaming(strings.NewReader(`var x = ;`), "bad.js"); err == nil {
+		t.Error("Expected a syntax error")
+	}
+
+	// TimeoutReader fails on the second read.
+	_, err = ctx.CompileStreaming(iotest.TimeoutReader(strings.NewReader(`1 + 2`)), "timeout.js")
+	if err != iotest.ErrTimeout {
+		t.Errorf("Expected the read error to be returned, got %v", err)
+	}
+
+	// Scripts can be released after their context.
+	ctx.Release()
+	if _, err := ctx.CompileStreaming(strings.NewReader(`1`), "released.js"); err != errContextReleased {
+		t.Errorf("Expected the released context error, got %v", err)
+	}
+	if _, err := script.Run(); err == nil {
+		t.Error("Expected an error running a script of a released context")
+	}
+	script.Release()
+	if _, err := script.Run(); err != errScriptReleased {
+		t.Errorf("Expected the released script error, got %v", err)
+	}
+}
+
+func TestEvalModule(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	sources := map[string]string{
+		"/lib/math.js": `export function square(x) { return x * x; }`,
+		"/lib/util.js": `import { square } from "./math.js"; export const four = square(2);`,
+	}
+	resolver := func(specifier, referrer string) (string, string, error) {
+		name := path.Join(path.Dir(referrer), specifier)
+		if src, ok := sources[name]; ok {
+			return name, src, nil
+		}
+		return "", "", fmt.Errorf("module %q imported by %q not found", specifier, referrer)
+	}
+
+	main := `import { four } from "./lib/util.js"; import { square } from "./lib/math.js"; export const answer = square(four) + 26;`
+	for i := 0; i < 2; i++ {
+		ctx := iso.NewContext()
+		ctx.SetModuleResolver(resolver)
+		ns, err := ctx.EvalModule("/main.js", main)
+		if err != nil {
+			t.Fatal(err)
+		}
+		answer, err := ns.Get("answer")
+		if err != nil {
+			t.Fatal(err)
+		}
+		if num := answer.Int64(); num != 42 {
+			t.Errorf("Expected 42, got %v", answer)
+		}
+	}
+
+	// The second context is compiled from the code cache.
+	if stats := iso.ModuleCacheStats(); stats.Entries != 3 || stats.Misses != 3 || stats.Hits != 3 {
+		t.Errorf("Unexpected module cache stats %+v", stats)
+	}
+
+	ctx := iso.NewContext()
+	ctx.SetModuleResolver(resolver)
+	if _, err := ctx.EvalModule("/broken.js", `import "./missing.js";`); err == nil {
+		t.Error("Expected an error importing a missing module")
+	} else if !strings.Contains(err.Error(), "missing.js") {
+		t.Errorf("Expected the resolver's error, got %v", err)
+	}
+
+	// Dependencies resolved by a failed instantiation are resolved again by
+	// the next attempt, which sees the new source.
+	sources["/lib/dep.js"] = `import "./missing.js"; export const v = 1;`
+	if _, err := ctx.EvalModule("/uses-dep.js", `import { v } from "./lib/dep.js";`); err == nil {
+		t.Error("Expected an error importing a missing module")
+	}
+	sources["/lib/dep.js"] = `export const v = 2;`
+	if ns, err := ctx.EvalModule("/uses-dep2.js", `export { v } from "./lib/dep.js";`); err != nil {
+		t.Fatal(err)
+	} else if v, err := ns.Get("v"); err != nil {
+		t.Fatal(err)
+	} else if v.Int64() != 2 {
+		t.Errorf("Expected the new source of the dependency, got %v", v)
+	}
+
+	// A module compiled from another source replaces its cache entry.
+	entries := iso.ModuleCacheStats().Entries
+	for i := 0; i < 3; i++ {
+		c := iso.NewContext()
+		if _, err := c.EvalModule("/changing.js", fmt.Sprintf("export const i = %d;", i)); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if stats := iso.ModuleCacheStats(); stats.Entries != entries+1 {
+		t.Errorf("Expected one cache entry for the changing module, got %d", stats.Entries-entries)
+	}
+}
+
+func TestWasm(t *testing.T) {
+	t.Parallel()
+	Init("")
+
+	// The module imports env.double and exports quad(x) = double(double(x)):
+	//   (module
+	//      (import "env" "double" (func $double (param i32) (result i32)))
+	//      (func (export "quad") (param i32) (result i32)
+	//          (call $double (call $double (local.get 0)))))
+	wasm := []byte{0, 97, 115, 109, 1, 0, 0, 0, 1, 6, 1, 96, 1, 127, 1, 127, 2, 14, 1, 3, 101, 110,
+		118, 6, 100, 111, 117, 98, 108, 101, 0, 0, 3, 2, 1, 0, 7, 8, 1, 4, 113, 117, 97, 100, 0, 1,
+		10, 10, 1, 8, 0, 32, 0, 16, 0, 16, 0, 11}
+
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	module, err := iso.NewContext().CompileWasm(wasm)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !reflect.DeepEqual(module.WireBytes(), wasm) {
+		t.Error("Wire bytes differ from the compiled binary")
+	}
+
+	// The module can be instantiated in another isolate.
+	iso2, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso2.NewContext()
+	double := ctx.Bind("double", func(in CallbackArgs) (*Value, error) {
+		return in.Context.Create(in.Arg(0).Int64() * 2)
+	})
+	imports, err := ctx.Create(map[string]interface{}{
+		"env": map[string]interface{}{"double": double},
+	})
+	if err != nil {
+		t.Fatal(err)
+	}
+	instance, err := ctx.InstantiateWasm(module, imports)
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx.Global().Set("instance", instance)
+	if res, err := ctx.Eval(`instance.exports.quad(5)`, "wasm.js"); err != nil {
+		t.Fatal(err)
+	} else if num := res.Int64(); num != 20 {
+		t.Errorf("Expected 20, got %v", res)
+	}
+
+	if _, err := ctx.InstantiateWasm(module, nil); err == nil {
+		t.Error("Expected an error instantiating without imports")
+	}
+
+	// Invalid serialized data falls back to compiling the wire bytes.
+	if _, err := ctx.DeserializeWasm([]byte("stale"), module.WireBytes()); err != nil {
+		t.Error(err)
+	}
+	if serialized, err := module.Serialize(); err == nil {
+		if _, err := ctx.DeserializeWasm(serialized, wasm); err != nil {
+			t.Error(err)
+		}
+	}
+
+	if _, err := ctx.CompileWasm([]byte("not wasm")); err == nil {
+		t.Error("Expected an error compiling an invalid module")
+	}
+}
+
 func TestSnapshot(t *testing.T) {
 	t.Parallel()
 	Init("")
@@ -925,6 +2301,121 @@ func TestSnapshot(t *testing.T) {
 	}
 }
 
+func TestSnapshotFile(t *testing.T) {
+	t.Parallel()
+	Init("")
+	snapshot, err := CreateSnapshot("zzz='from file';", true, nil)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	dir, err := os.MkdirTemp("", "v8snapshot")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer os.RemoveAll(dir)
+	path := filepath.Join(dir, "snapshot.bin")
+	if err := snapshot.WriteFile(path); err != nil {
+		t.Fatal(err)
+	}
+
+	// Both isolates share the same mapping of the file.
+	for i := 0; i < 2; i++ {
+		loaded, err := LoadSnapshotFile(path)
+		if err != nil {
+			t.Fatal(err)
+		}
+		iso, err := NewIsolateWithSnapshot(loaded)
+		if err != nil {
+			t.Fatal(err)
+		}
+		res, err := iso.NewContext().Eval(`zzz`, "script.js")
+		if err != nil {
+			t.Fatal(err)
+		}
+		if str := res.String(); str != "from file" {
+			t.Errorf("Expected 'from file' got %s", str)
+		}
+	}
+
+	bad := filepath.Join(dir, "bad.bin")
+	if err := os.WriteFile(bad, []byte("not a snapshot"), 0644); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := LoadSnapshotFile(bad); err == nil {
+		t.Error("Expected an error loading an invalid snapshot file")
+	}
+}
+
+func TestSnapshotWithContexts(t *testing.T) {
+	t.Parallel()
+	Init("")
+	RegisterCallback("test.double", func(in CallbackArgs) (*Value, error) {
+		return in.Context.Create(in.Arg(0).Float64() * 2)
+	})
+
+	var setupValue *Value
+	snapshot, err := CreateSnapshotWithContexts(true, nil,
+		func(ctx *Context) error {
+			double, err := ctx.BindRegistered("test.double")
+			if err != nil {
+				return err
+			}
+			if err := ctx.Global().Set("double", double); err != nil {
+				return err
+			}
+			setupValue, err = ctx.Eval(`var base = 21; base`, "setup0.js")
+			return err
+		},
+		func(ctx *Context) error {
+			// Scripts hold handles too, which must not trip the creator.
+			script, err := ctx.CompileStreaming(strings.NewReader(`var name = "second";`), "setup1.js")
+			if err != nil {
+				return err
+			}
+			_, err = script.Run()
+			return err
+		},
+	)
+	if err != nil {
+		t.Fatal(err)
+	}
+	// The handles of the setup values were released before the snapshot was
+	// created.
+	if setupValue.ptr != nil {
+		t.Error("Expected the setup value to be released")
+	}
+
+	iso, err := NewIsolateWithSnapshot(snapshot)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	first, err := iso.NewContextFromSnapshot(0)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if res, err := first.Eval(`double(base)`, "first.js"); err != nil {
+		t.Fatal(err)
+	} else if num := res.Int64(); num != 42 {
+		t.Errorf("Expected 42, got %v", res)
+	}
+
+	second, err := iso.NewContextFromSnapshot(1)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if res, err := second.Eval(`typeof double + " " + name`, "second.js"); err != nil {
+		t.Fatal(err)
+	} else if str := res.String(); str != "undefined second" {
+		t.Errorf("Expected 'undefined second', got %q", str)
+	}
+
+	if _, err := iso.NewContextFromSnapshot(2); err == nil {
+		t.Error("Expected an error for a context that isn't in the snapshot")
+	}
+}
+
 func TestSnapshotBadJs(t *testing.T) {
 	t.Parallel()
 	Init("")
@@ -1304,6 +2795,77 @@ func TestTypedArrayBuffers(t *testing.T) {
 	}
 }
 
+func TestTypedArrayViews(t *testing.T) {
+	t.Parallel()
+	Init("")
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx := iso.NewContext()
+
+	arr, err := ctx.CreateTypedArray([]float64{1.5, 2.5, 3.5, 4.5})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !arr.IsKind(KindFloat64Array) {
+		t.Fatalf("Expected a Float64Array, got %v", arr)
+	}
+	ctx.Global().Set("arr", arr)
+
+	sub, err := ctx.Eval(`arr.subarray(1, 3)`, "test.js")
+	if err != nil {
+		t.Fatal(err)
+	}
+	view, err := sub.Float64s()
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !reflect.DeepEqual(view, []float64{2.5, 3.5}) {
+		t.Errorf("Expected the subarray's range [2.5 3.5], got %v", view)
+	}
+	if bytes := sub.Bytes(); len(bytes) != 16 {
+		t.Errorf("Expected 16 bytes for the subarray, got %d", len(bytes))
+	}
+
+	// The view aliases the array's memory.
+	view[0] = 42
+	if res, err := ctx.Eval(`arr[1]`, "test.js"); err != nil {
+		t.Fatal(err)
+	} else if res.Float64() != 42 {
+		t.Errorf("Expected the write through the view to be visible, got %v", res)
+	}
+	runtime.KeepAlive(sub)
+
+	if _, err := sub.Int32s(); err == nil {
+		t.Error("Expected an error reading a Float64Array as int32s")
+	}
+
+	var ints []int32
+	int32Array, err := ctx.Eval(`new Int32Array([-1, 0, 7])`, "test.js")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := ReadInto(&ints, int32Array, 1); err != nil {
+		t.Fatal(err)
+	}
+	if !reflect.DeepEqual(ints, []int32{-1, 0, 7}) {
+		t.Errorf("Expected [-1 0 7], got %v", ints)
+	}
+
+	tagged, err := ctx.Create(struct {
+		Samples []float32 `v8:"typedarray"`
+	}{[]float32{0.5, 0.25}})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if res, err := tagged.Get("Samples"); err != nil {
+		t.Fatal(err)
+	} else if !res.IsKind(KindFloat32Array) {
+		t.Errorf("Expected a Float32Array, got %v", res)
+	}
+}
+
 func TestCreateJsonTags(t *testing.T) {
 	t.Parallel()
 	iso, err := NewIsolate()
@@ -1549,6 +3111,69 @@ func TestContextFinalizerWithValues(t *testing.T) {
 	}
 }
 
+func TestContextRecycle(t *testing.T) {
+	t.Parallel()
+	Init("")
+	RegisterCallback("test.greet", func(in CallbackArgs) (*Value, error) {
+		return in.Context.Create("Hello " + in.Arg(0).String())
+	})
+
+	iso, err := NewIsolate()
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := iso.SetGlobal("answer", 42); err != nil {
+		t.Fatal(err)
+	}
+	if err := iso.BindGlobal("greet", "test.greet"); err != nil {
+		t.Fatal(err)
+	}
+	if err := iso.SetGlobal("obj", map[string]int{}); err == nil {
+		t.Error("Expected an error setting a non-primitive global")
+	}
+
+	ctx := iso.NewContext()
+	ctx.Global().Set("bound", ctx.Bind("bound", func(in CallbackArgs) (*Value, error) {
+		return nil, nil
+	}))
+	stale, err := ctx.Eval(`var leftover = 1; bound`, "before.js")
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	if err := ctx.Recycle(); err != nil {
+		t.Fatal(err)
+	}
+
+	res, err := ctx.Eval(`typeof leftover + " " + answer + " " + greet("bob")`, "after.js")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if str := res.String(); str != "undefined 42 Hello bob" {
+		t.Errorf("Expected a fresh global, got %q", str)
+	}
+
+	// Functions bound before recycling fail instead of calling new callbacks.
+	if _, err := stale.Call(nil); err == nil {
+		t.Error("Expected an error calling a callback bound before recycling")
+	}
+
+	// Values of a released context can't be passed to another one.
+	other := iso.NewContext()
+	defer other.Release()
+	ctx.Release()
+	if err := ctx.Recycle(); err == nil || err.Error() != errContextReleased.Error() {
+		t.Errorf("Expected the released context error recycling, got %v", err)
+	}
+	if err := other.Global().Set("stale", res); err == nil {
+		t.Error("Expected an error setting a value of a released context")
+	}
+	fn, _ := other.Eval(`(x => x)`, "other.js")
+	if _, err := fn.Call(nil, res); err == nil {
+		t.Error("Expected an error passing a value of a released context")
+	}
+}
+
 func TestIsolateGetHeapStatistics(t *testing.T) {
 	Init("")
 	iso, err := NewIsolate()
@@ -0,0 +1,206 @@
+package v8
+
+// #include "v8_c_bridge.h"
+import "C"
+
+import (
+	"fmt"
+	"reflect"
+	"unsafe"
+)
+
+type typedArrayType struct {
+	kind  Kind
+	kinds kindMask
+}
+
+// typedArrayTypes maps Go element kinds to the typed array holding them.
+var typedArrayTypes = map[reflect.Kind]typedArrayType{
+	reflect.Uint8:   {KindUint8Array, unionKindUint8Array},
+	reflect.Int8:    {KindInt8Array, unionKindInt8Array},
+	reflect.Uint16:  {KindUint16Array, unionKindUint16Array},
+	reflect.Int16:   {KindInt16Array, unionKindInt16Array},
+	reflect.Uint32:  {KindUint32Array, unionKindUint32Array},
+	reflect.Int32:   {KindInt32Array, unionKindInt32Array},
+	reflect.Float32: {KindFloat32Array, unionKindFloat32Array},
+	reflect.Float64: {KindFloat64Array, unionKindFloat64Array},
+}
+
+// CreateTypedArray creates a typed array holding a copy of the elements of
+// slice in a single call, e.g. a Float64Array from a []float64. Slices of
+// uint8, int8, uint16, int16, uint32, int32, float32 and float64 (or types
+// based on them) are supported.
+func (ctx *Context) CreateTypedArray(slice interface{}) (*Value, error) {
+	val := reflect.ValueOf(slice)
+	if val.Kind() != reflect.Slice {
+		return nil, fmt.Errorf("CreateTypedArray needs a slice, got %T", slice)
+	}
+	return ctx.createTypedArray(val)
+}
+
+func (ctx *Context) createTypedArray(val reflect.Value) (*Value, error) {
+	elem := val.Type().Elem()
+	t, ok := typedArrayTypes[elem.Kind()]
+	if !ok {
+		return nil, fmt.Errorf("No typed array for elements of type %s", elem)
+	}
+	var ptr *C.char
+	if val.Len() > 0 {
+		ptr = (*C.char)(unsafe.Pointer(val.Index(0).UnsafeAddr()))
+	}
+	byteLength := uintptr(val.Len()) * elem.Size()
+	return ctx.newValue(
+		C.v8_Context_CreateTypedArray(ctx.ptr, C.Kind(t.kind), ptr, C.size_t(byteLength)),
+		C.KindMask(t.kinds),
+	), nil
+}
+
+// typedArrayView returns the memory of the typed array's view and its size in
+// bytes if v is one of the given kinds.
+func (v *Value) typedArrayView(kinds ...Kind) (unsafe.Pointer, int, error) {
+	for _, k := range kinds {
+		if v.IsKind(k) {
+			var n C.size_t
+			p := C.v8_Value_ByteView(v.ctx.ptr, v.ptr, &n)
+			if uint64(n) > uint64(maxInt) {
+				return nil, 0, fmt.Errorf("%s of %d bytes is too large", k, n)
+			}
+			return unsafe.Pointer(p), int(n), nil
+		}
+	}
+	return nil, 0, fmt.Errorf("Not a %s", kinds[0])
+}
+
+const maxInt = int(^uint(0) >> 1)
+
+// setSlice makes the slice that slicePtr points to alias the n elements at p,
+// like unsafe.Slice, which needs a newer Go than go.mod asks for. Unlike
+// converting p to a pointer to a large array, it works for any n and on
+// 32-bit platforms.
+func setSlice(slicePtr, p unsafe.Pointer, n int) {
+	h := (*reflect.SliceHeader)(slicePtr)
+	h.Data = uintptr(p)
+	h.Len = n
+	h.Cap = n
+}
+
+// The typed accessors below return slices that alias the typed array's view
+// without copying: writes on either side are visible to the other. The slice
+// is only valid while v is reachable (see runtime.KeepAlive) and the array's
+// buffer is not detached, e.g. by transferring it; copy the slice to keep the
+// data longer. Views created with subarray() only cover their own range.
+
+// Uint8s returns the elements of a Uint8Array or Uint8ClampedArray.
+func (v *Value) Uint8s() ([]uint8, error) {
+	p, n, err := v.typedArrayView(KindUint8Array, KindUint8ClampedArray)
+	if err != nil || p == nil {
+		return nil, err
+	}
+	var s []uint8
+	setSlice(unsafe.Pointer(&s), p, n)
+	return s, nil
+}
+
+// Int8s returns the elements of an Int8Array.
+func (v *Value) Int8s() ([]int8, error) {
+	p, n, err := v.typedArrayView(KindInt8Array)
+	if err != nil || p == nil {
+		return nil, err
+	}
+	var s []int8
+	setSlice(unsafe.Pointer(&s), p, n)
+	return s, nil
+}
+
+// Uint16s returns the elements of a Uint16Array.
+func (v *Value) Uint16s() ([]uint16, error) {
+	p, n, err := v.typedArrayView(KindUint16Array)
+	if err != nil || p == nil {
+		return nil, err
+	}
+	var s []uint16
+	setSlice(unsafe.Pointer(&s), p, n/2)
+	return s, nil
+}
+
+// Int16s returns the elements of an Int16Array.
+func (v *Value) Int16s() ([]int16, error) {
+	p, n, err := v.typedArrayView(KindInt16Array)
+	if err != nil || p == nil {
+		return nil, err
+	}
+	var s []int16
+	setSlice(unsafe.Pointer(&s), p, n/2)
+	return s, nil
+}
+
+// Uint32s returns the elements of a Uint32Array.
+func (v *Value) Uint32s() ([]uint32, error) {
+	p, n, err := v.typedArrayView(KindUint32Array)
+	if err != nil || p == nil {
+		return nil, err
+	}
+	var s []uint32
+	setSlice(unsafe.Pointer(&s), p, n/4)
+	return s, nil
+}
+
+// Int32s returns the elements of an Int32Array.
+func (v *Value) Int32s() ([]int32, error) {
+	p, n, err := v.typedArrayView(KindInt32Array)
+	if err != nil || p == nil {
+		return nil, err
+	}
+	var s []int32
+	setSlice(unsafe.Pointer(&s), p, n/4)
+	return s, nil
+}
+
+// Float32s returns the elements of a Float32Array.
+func (v *Value) Float32s() ([]float32, error) {
+	p, n, err := v.typedArrayView(KindFloat32Array)
+	if err != nil || p == nil {
+		return nil, err
+	}
+	var s []float32
+	setSlice(unsafe.Pointer(&s), p, n/4)
+	return s, nil
+}
+
+// Float64s returns the elements of a Float64Array.
+func (v *Value) Float64s() ([]float64, error) {
+	p, n, err := v.typedArrayView(KindFloat64Array)
+	if err != nil || p == nil {
+		return nil, err
+	}
+	var s []float64
+	setSlice(unsafe.Pointer(&s), p, n/8)
+	return s, nil
+}
+
+// readTypedArray copies the typed array v into a new slice of type sliceType
+// if v's kind matches the slice elements, and reports whether it did.
+func (v *Value) readTypedArray(sliceType reflect.Type) (reflect.Value, bool) {
+	t, ok := typedArrayTypes[sliceType.Elem().Kind()]
+	if !ok {
+		return reflect.Value{}, false
+	}
+	kinds := []Kind{t.kind}
+	if t.kind == KindUint8Array {
+		kinds = append(kinds, KindUint8ClampedArray)
+	}
+	p, n, err := v.typedArrayView(kinds...)
+	if err != nil {
+		return reflect.Value{}, false
+	}
+
+	length := n / int(sliceType.Elem().Size())
+	slice := reflect.MakeSlice(sliceType, length, length)
+	if length > 0 {
+		var dst, src []byte
+		setSlice(unsafe.Pointer(&dst), unsafe.Pointer(slice.Index(0).UnsafeAddr()), n)
+		setSlice(unsafe.Pointer(&src), p, n)
+		copy(dst, src)
+	}
+	return slice, true
+}
@@ -0,0 +1,107 @@
+package v8
+
+// #include <stdlib.h>
+// #include "v8_c_bridge.h"
+import "C"
+
+import (
+	"errors"
+	"runtime"
+	"unsafe"
+)
+
+// WasmModule is a compiled WebAssembly module. It is not bound to the context
+// or isolate it was compiled in: instantiating it in other isolates reuses the
+// compiled code, including code that has been tiered up since.
+type WasmModule struct {
+	ptr C.WasmModulePtr
+}
+
+// CompileWasm compiles the WebAssembly binary wasm.
+func (ctx *Context) CompileWasm(wasm []byte) (*WasmModule, error) {
+	return ctx.DeserializeWasm(nil, wasm)
+}
+
+// DeserializeWasm restores a module from data returned by
+// WasmModule.Serialize, skipping compilation. If serialized was produced by a
+// different V8 version or with different flags, or is empty, the module is
+// compiled from wireBytes (see WasmModule.WireBytes) instead.
+func (ctx *Context) DeserializeWasm(serialized, wireBytes []byte) (*WasmModule, error) {
+	addRef(ctx)
+	ret := C.v8_Context_CompileWasm(ctx.ptr,
+		bytesPtr(serialized), C.int(len(serialized)),
+		bytesPtr(wireBytes), C.int(len(wireBytes)))
+	decRef(ctx)
+	if err := ctx.iso.convertErrorMsg(ret.error_msg); err != nil {
+		return nil, err
+	}
+	m := &WasmModule{ret.Module}
+	runtime.SetFinalizer(m, (*WasmModule).release)
+	return m, nil
+}
+
+// InstantiateWasm instantiates the module in this context and returns the
+// WebAssembly.Instance, whose "exports" property holds the exported functions
+// and memories. imports may be nil if the module doesn't import anything;
+// otherwise it is the usual import object, e.g. created with Create from a
+// map of maps whose functions are bound Go callbacks:
+//
+//	log := ctx.Bind("log", logCallback)
+//	imports, _ := ctx.Create(map[string]interface{}{
+//		"env": map[string]interface{}{"log": log},
+//	})
+//	instance, err := ctx.InstantiateWasm(module, imports)
+func (ctx *Context) InstantiateWasm(m *WasmModule, imports *Value) (*Value, error) {
+	if err := checkReleased(imports); err != nil {
+		return nil, err
+	}
+	var importsPtr C.PersistentValuePtr
+	if imports != nil {
+		importsPtr = imports.ptr
+	}
+	addRef(ctx)
+	ret := C.v8_Context_InstantiateWasm(ctx.ptr, m.ptr, importsPtr)
+	decRef(ctx)
+	runtime.KeepAlive(m)
+	runtime.KeepAlive(imports)
+	return ctx.split(ret)
+}
+
+// Serialize returns the compiled code of the module, which DeserializeWasm can
+// load in another process running the same V8 version and flags. It fails if
+// the code can't be serialized yet, e.g. while V8 is still tiering up the
+// module's functions.
+func (m *WasmModule) Serialize() ([]byte, error) {
+	data := C.v8_WasmModule_Serialize(m.ptr)
+	runtime.KeepAlive(m)
+	if data.ptr == nil {
+		return nil, errors.New("wasm module can't be serialized")
+	}
+	defer C.free(unsafe.Pointer(data.ptr))
+	return C.GoBytes(unsafe.Pointer(data.ptr), data.len), nil
+}
+
+// WireBytes returns the WebAssembly binary the module was compiled from.
+func (m *WasmModule) WireBytes() []byte {
+	data := C.v8_WasmModule_WireBytes(m.ptr)
+	runtime.KeepAlive(m)
+	defer C.free(unsafe.Pointer(data.ptr))
+	return C.GoBytes(unsafe.Pointer(data.ptr), data.len)
+}
+
+func (m *WasmModule) release() {
+	if m.ptr != nil {
+		C.v8_WasmModule_Release(m.ptr)
+	}
+	m.ptr = nil
+	runtime.SetFinalizer(m, nil)
+}
+
+// bytesPtr returns a pointer to the first byte of b, or nil if b is empty.
+// The memory must not be retained by C.
+func bytesPtr(b []byte) *C.char {
+	if len(b) == 0 {
+		return nil
+	}
+	return (*C.char)(unsafe.Pointer(&b[0]))
+}
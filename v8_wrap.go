@@ -0,0 +1,347 @@
+package v8
+
+// #include <stdlib.h>
+// #include "v8_c_bridge.h"
+import "C"
+
+import (
+	"fmt"
+	"math"
+	"reflect"
+	"strconv"
+	"strings"
+	"sync"
+	"unicode"
+	"unsafe"
+)
+
+// Go values that are referenced from JS objects are kept in a registry, since
+// Go pointers can't be stored in V8 (see the callback magic in v8.go). The
+// objects hold the handle of their value, which is released by V8 once the
+// object has been garbage collected.
+var handles = map[int]interface{}{}
+var handlesMutex sync.RWMutex
+var nextHandle int
+
+func newHandle(v interface{}) int {
+	handlesMutex.Lock()
+	// Handles are stored in V8 as int32s, so they wrap around, skipping those
+	// that are still in use.
+	for {
+		if nextHandle == math.MaxInt32 {
+			nextHandle = 0
+		}
+		nextHandle++
+		if _, ok := handles[nextHandle]; !ok {
+			break
+		}
+	}
+	h := nextHandle
+	handles[h] = v
+	handlesMutex.Unlock()
+	return h
+}
+
+func lookupHandle(h int) interface{} {
+	handlesMutex.RLock()
+	v := handles[h]
+	handlesMutex.RUnlock()
+	return v
+}
+
+//export goReleaseHandle
+func goReleaseHandle(h C.int) {
+	handlesMutex.Lock()
+	delete(handles, int(h))
+	handlesMutex.Unlock()
+}
+
+// structTemplate is the V8 object template of a Go struct type, with one
+// accessor property per field and one function per callback method. The
+// functions are shared by all objects of the template and call the method of
+// the object they are called on, see wrappedMethod.
+type structTemplate struct {
+	id     C.int
+	fields []structField
+}
+
+type structField struct {
+	name   string
+	index  []int // for reflect.Value.FieldByIndex, unless this is a method
+	method int   // index of the method of the pointer type, or -1
+	tags   []string
+}
+
+// wrapMaxDepth is the maxDepth of ReadInto when a property of a wrapped
+// struct is set.
+const wrapMaxDepth = 16
+
+var callbackArgsType = reflect.TypeOf(CallbackArgs{})
+var errorType = reflect.TypeOf((*error)(nil)).Elem()
+
+type wrappedStruct struct {
+	ptr  reflect.Value // pointer to the struct
+	tmpl *structTemplate
+}
+
+// Wrap creates a JS object that is a live view of the struct ptr points to.
+// Unlike Create, which copies every field, the properties of the object are
+// accessors that read a field from the Go struct only when the script
+// accesses it, and assigning to a property writes the field with ReadInto.
+// Fields holding structs or pointers to structs are wrapped in turn, with a
+// new view on every access.
+//
+// Properties are named like Create names them and also include the methods
+// that match the Callback type. The accessors are built once per isolate and
+// struct type and refer to fields by index, so wrapping is cheap regardless
+// of the number of fields.
+//
+// Methods are called on the struct wrapped by the object they are called on,
+// so they must be called as methods of a wrapped object: a method taken off
+// the object has to be bound to it, as in obj.Method.bind(obj).
+//
+// The struct is referenced until the object is garbage collected by V8 or the
+// isolate is released. Access from JS is not synchronized with Go code using
+// the struct.
+func (ctx *Context) Wrap(ptr interface{}) (*Value, error) {
+	val := reflect.ValueOf(ptr)
+	if val.Kind() != reflect.Ptr || val.Type().Elem().Kind() != reflect.Struct {
+		return nil, fmt.Errorf("Wrap requires a pointer to a struct, got %T", ptr)
+	} else if val.IsNil() {
+		return nil, fmt.Errorf("Wrap requires a non-nil pointer")
+	}
+	return ctx.wrap(val)
+}
+
+func (ctx *Context) wrap(ptr reflect.Value) (*Value, error) {
+	if ctx.ptr == nil {
+		return nil, errContextReleased
+	}
+	tmpl := ctx.iso.structTemplate(ptr.Type().Elem())
+	h := newHandle(&wrappedStruct{ptr, tmpl})
+	v := ctx.newValue(C.v8_Context_Wrap(ctx.ptr, tmpl.id, C.int(h)), C.KindMask(KindObject))
+	if v == nil {
+		goReleaseHandle(C.int(h))
+		return nil, fmt.Errorf("Cannot wrap %s", ptr.Type())
+	}
+	return v, nil
+}
+
+// structTemplate returns the template of the struct type t, creating it on
+// first use.
+func (i *Isolate) structTemplate(t reflect.Type) *structTemplate {
+	i.structTemplatesMutex.Lock()
+	defer i.structTemplatesMutex.Unlock()
+	if tmpl := i.structTemplates[t]; tmpl != nil {
+		return tmpl
+	}
+
+	byName := map[string]int{}
+	fields := appendStructFields(nil, byName, t, nil, map[reflect.Type]bool{})
+	pt := reflect.PtrTo(t)
+	for m := 0; m < pt.NumMethod(); m++ {
+		// Methods are exported like writeStructFields exports them, except
+		// that pointer receivers are fine since the struct is addressable.
+		mt := pt.Method(m).Type
+		if mt.NumIn() == 2 && mt.In(1) == callbackArgsType &&
+			mt.NumOut() == 2 && mt.Out(0) == valuePtrType && mt.Out(1) == errorType {
+			fields = addStructField(fields, byName, structField{name: pt.Method(m).Name, method: m})
+		}
+	}
+
+	var names strings.Builder
+	offsets := make([]C.int, len(fields)+1)
+	methods := make([]byte, len(fields)+1)
+	for n, f := range fields {
+		names.WriteString(f.name)
+		offsets[n+1] = C.int(names.Len())
+		if f.method >= 0 {
+			methods[n] = 1
+		}
+	}
+	namesStr := C.CString(names.String())
+	defer C.free(unsafe.Pointer(namesStr))
+
+	tmpl := &structTemplate{
+		id: C.v8_Isolate_NewStructTemplate(i.ptr, namesStr, &offsets[0],
+			(*C.char)(unsafe.Pointer(&methods[0])), C.int(len(fields))),
+		fields: fields,
+	}
+	if i.structTemplates == nil {
+		i.structTemplates = map[reflect.Type]*structTemplate{}
+	}
+	i.structTemplates[t] = tmpl
+	return tmpl
+}
+
+// appendStructFields collects the fields of t the way writeStructFields
+// writes them: fields of embedded structs are inlined and a later field
+// replaces an earlier one with the same name. Structs that embed themselves,
+// directly or not, are inlined once; visiting holds the structs being
+// inlined.
+func appendStructFields(fields []structField, byName map[string]int, t reflect.Type, index []int,
+	visiting map[reflect.Type]bool) []structField {
+	visiting[t] = true
+	defer delete(visiting, t)
+	for i := 0; i < t.NumField(); i++ {
+		f := t.Field(i)
+		name := getJsName(f.Name, f.Tag.Get("json"))
+		if name == "" {
+			continue // skip field with tag `json:"-"`
+		}
+		fieldIndex := append(append([]int{}, index...), i)
+
+		if f.Anonymous {
+			sub := f.Type
+			for sub.Kind() == reflect.Ptr {
+				sub = sub.Elem()
+			}
+			if sub.Kind() == reflect.Struct {
+				if !visiting[sub] {
+					fields = appendStructFields(fields, byName, sub, fieldIndex, visiting)
+				}
+				continue
+			}
+		}
+
+		if !unicode.IsUpper(rune(f.Name[0])) {
+			continue // skip unexported fields
+		}
+
+		fields = addStructField(fields, byName,
+			structField{name, fieldIndex, -1, strings.Split(f.Tag.Get("v8"), ",")})
+	}
+	return fields
+}
+
+func addStructField(fields []structField, byName map[string]int, f structField) []structField {
+	if n, ok := byName[f.name]; ok {
+		fields[n] = f
+		return fields
+	}
+	byName[f.name] = len(fields)
+	return append(fields, f)
+}
+
+// field returns the field f of the wrapped struct, or false if it is in an
+// embedded struct that is nil.
+func (w *wrappedStruct) field(f *structField) (reflect.Value, bool) {
+	v := w.ptr.Elem()
+	for n, i := range f.index {
+		if n > 0 {
+			for v.Kind() == reflect.Ptr {
+				if v.IsNil() {
+					return reflect.Value{}, false
+				}
+				v = v.Elem()
+			}
+		}
+		v = v.Field(i)
+	}
+	return v, true
+}
+
+// wrappedMethod returns the callback of the method of a wrapped struct that
+// is called by the id "<handle>.<field index>".
+func wrappedMethod(id string) callbackInfo {
+	parts := strings.SplitN(id, ".", 2)
+	h, _ := strconv.Atoi(parts[0])
+	w, _ := lookupHandle(h).(*wrappedStruct)
+	if w == nil || len(parts) != 2 {
+		return callbackInfo{}
+	}
+	field, _ := strconv.Atoi(parts[1])
+	if field < 0 || field >= len(w.tmpl.fields) || w.tmpl.fields[field].method < 0 {
+		return callbackInfo{}
+	}
+	f := &w.tmpl.fields[field]
+	cb := w.ptr.Method(f.method).Convert(callbackType).Interface().(Callback)
+	return callbackInfo{Callback: cb, name: f.name}
+}
+
+func (ctx *Context) get(w *wrappedStruct, f *structField) (*Value, error) {
+	val, ok := w.field(f)
+	if !ok {
+		return nil, nil
+	}
+	return ctx.createLazy(val, f.tags)
+}
+
+// createLazy is like createWithTags, except that addressable structs and
+// pointers to structs are wrapped instead of copied.
+func (ctx *Context) createLazy(val reflect.Value, tags []string) (*Value, error) {
+	switch {
+	case val.Kind() == reflect.Struct && val.Type() != timeType && val.CanAddr():
+		return ctx.wrap(val.Addr())
+	case val.Kind() == reflect.Ptr && !val.IsNil() &&
+		val.Elem().Kind() == reflect.Struct && val.Type().Elem() != timeType:
+		return ctx.wrap(val)
+	}
+	v, _, err := ctx.createWithTags(val, tags)
+	return v, err
+}
+
+func (ctx *Context) set(w *wrappedStruct, f *structField, value *Value) error {
+	val, ok := w.field(f)
+	if !ok {
+		return fmt.Errorf("Cannot set %q: embedded struct is nil", f.name)
+	}
+	return readInto(val.Addr().Interface(), value, []string{f.name}, wrapMaxDepth)
+}
+
+//export goAccessorHandler
+func goAccessorHandler(ctxId, handle, field C.int, value *C.ValueTuple) (ret C.ValueTuple) {
+	ctx := callbackContext(ctxId)
+	if ctx == nil {
+		return errorTuple(fmt.Sprintf("Missing context pointer during property access for context #%d", ctxId))
+	}
+
+	var newValue *Value
+	if value != nil {
+		newValue = ctx.newValue(value.Value, value.Kinds)
+	}
+
+	w, _ := lookupHandle(int(handle)).(*wrappedStruct)
+	if w == nil || int(field) >= len(w.tmpl.fields) {
+		return errorTuple(fmt.Sprintf("No such wrapped value: %d", handle))
+	}
+	f := &w.tmpl.fields[field]
+
+	// Panics must not unwind through the C stack, see goCallbackHandler.
+	defer func() {
+		if v := recover(); v != nil {
+			ret = errorTuple(fmt.Sprintf("Panic accessing %q: %v", f.name, v))
+		}
+	}()
+
+	if newValue != nil {
+		if err := ctx.set(w, f, newValue); err != nil {
+			return errorTuple(err.Error())
+		}
+		return C.ValueTuple{}
+	}
+
+	res, err := ctx.get(w, f)
+	if err != nil {
+		return errorTuple(err.Error())
+	} else if res == nil {
+		return C.ValueTuple{}
+	}
+	return C.ValueTuple{Value: res.ptr}
+}
+
+// callbackContext returns the context with the given id, which is
+// registered while Go calls into it.
+func callbackContext(ctxId C.int) *Context {
+	contextsMutex.RLock()
+	ref := contexts[int(ctxId)]
+	contextsMutex.RUnlock()
+	if ref == nil {
+		return nil
+	}
+	return ref.ptr
+}
+
+func errorTuple(msg string) C.ValueTuple {
+	return C.ValueTuple{error_msg: C.Error{ptr: C.CString(msg), len: C.int(len(msg))}}
+}
@@ -10,6 +10,7 @@ package v8console
 import (
 	"fmt"
 	"io"
+	"time"
 
 	v8 "github.com/jviksne/v8go"
 )
@@ -79,6 +80,43 @@ func (c Config) Inject(ctx *v8.Context) {
 	}
 }
 
+// BufferOptions configures the buffer of a console injected with
+// InjectBuffered. Zero values select the defaults of v8.ConsoleOptions.
+type BufferOptions struct {
+	// Size in bytes of the buffer of each of Stdout and Stderr. Messages
+	// that don't fit are dropped and counted in the console's Stats.
+	Size int
+	// Number of buffered bytes at which messages are written out while a
+	// script runs.
+	FlushSize int
+	// If not 0, messages are also written out when one is logged this long
+	// after the last flush.
+	FlushInterval time.Duration
+}
+
+// InjectBuffered is like Inject, but binds .log, .info, .warn, and .error to
+// native functions that format the messages inside V8 and buffer them, rather
+// than to Go callbacks that are called for every message, which is much
+// cheaper for scripts that log a lot. The messages are written to Stdout and
+// Stderr in batches, at the latest when Eval returns. Messages logged outside
+// of Eval, e.g. by promise jobs, are written out by the returned console's
+// Flush.
+func (c Config) InjectBuffered(ctx *v8.Context, opts BufferOptions) *v8.Console {
+	console, err := ctx.InjectConsole(v8.ConsoleOptions{
+		Stdout:        c.Stdout,
+		Stderr:        c.Stderr,
+		Prefix:        c.Prefix,
+		Colorize:      c.Colorize,
+		BufferSize:    opts.Size,
+		FlushSize:     opts.FlushSize,
+		FlushInterval: opts.FlushInterval,
+	})
+	if err != nil {
+		panic(fmt.Errorf("cannot inject console: %v", err))
+	}
+	return console
+}
+
 func (c Config) writeLog(w io.Writer, color string, vals ...interface{}) {
 	if color != "" && c.Colorize {
 		fmt.Fprint(w, color)
@@ -42,6 +42,29 @@ func ExampleFlushSnapshotAndInject() {
 	// console> [somefile.js:1] after snapshot
 }
 
+func ExampleConfig_InjectBuffered() {
+	v8.Init("")
+	isol, err := v8.NewIsolate()
+	if err != nil {
+		log.Fatal(err)
+	}
+	ctx := isol.NewContext()
+	console := v8console.Config{"> ", os.Stdout, os.Stdout, false}.InjectBuffered(ctx, v8console.BufferOptions{})
+	// The messages are written out when Eval returns.
+	ctx.Eval(`
+        console.log('hi there');
+        console.warn("Where's mah bucket?");
+    `, "filename.js")
+	// Flush writes out messages logged otherwise, e.g. by promise jobs.
+	if err := console.Flush(); err != nil {
+		log.Fatal(err)
+	}
+
+	// Output:
+	// > hi there
+	// > [filename.js:3] Where's mah bucket?
+}
+
 func ExampleConfig() {
 	v8.Init("")
 	isol, err := v8.NewIsolate()